@@ -0,0 +1,74 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DataAssets/PcActorDataAsset.h"
+
+#include "CustomLogging.h"
+#include "Engine/AssetManager.h"
+
+static FStreamableManager& GetStreamableManager()
+{
+	if(UAssetManager::IsInitialized())
+		return UAssetManager::GetStreamableManager();
+	static FStreamableManager StreamableManager;
+	return StreamableManager;
+}
+
+TSharedPtr<FStreamableHandle> UPcActorDataAsset::PreloadReferences(FStreamableDelegate OnLoaded)
+{
+	if(PreloadHandle.IsValid() && PreloadHandle->IsActive())
+	{
+		if(OnLoaded.IsBound())
+		{
+			if(PreloadHandle->HasLoadCompleted())
+				OnLoaded.Execute();
+			else
+				PreloadHandle->BindCompleteDelegate(OnLoaded);
+		}
+		return PreloadHandle;
+	}
+
+	TArray<FSoftObjectPath> Paths;
+	for(const FSoftObjectPath& Path : {SourceSkeletalMesh.ToSoftObjectPath(), TargetSkeletalMesh.ToSoftObjectPath(),
+	                                   SourcePhysicsAsset.ToSoftObjectPath(), TargetPhysicsAsset.ToSoftObjectPath(),
+	                                   BodyParamsDataTable.ToSoftObjectPath(), ConstraintParamsDataTable.ToSoftObjectPath()})
+	{
+		if(!Path.IsNull())
+			Paths.AddUnique(Path);
+	}
+	if(Paths.IsEmpty())
+	{
+		OnLoaded.ExecuteIfBound();
+		return nullptr;
+	}
+
+	LG("Preloading %d references of %s", Paths.Num(), *GetName())
+	PreloadHandle = GetStreamableManager().RequestAsyncLoad(Paths, OnLoaded, FStreamableManager::AsyncLoadHighPriority);
+	return PreloadHandle;
+}
+
+void UPcActorDataAsset::WaitForPreload() const
+{
+	if(PreloadHandle.IsValid() && PreloadHandle->IsLoadingInProgress())
+		PreloadHandle->WaitUntilComplete();
+}
+
+void UPcActorDataAsset::ReleasePreload()
+{
+	if(PreloadHandle.IsValid())
+		PreloadHandle->ReleaseHandle();
+	PreloadHandle.Reset();
+}
+
+UObject* UPcActorDataAsset::ResolveSlow(const FSoftObjectPath& Path) const
+{
+	// A preload in flight may already contain the path, finish it instead of issuing a second load
+	if(PreloadHandle.IsValid() && PreloadHandle->IsLoadingInProgress())
+	{
+		PreloadHandle->WaitUntilComplete();
+		if(UObject* Loaded = Path.ResolveObject())
+			return Loaded;
+	}
+	LGV("Loading %s synchronously, it wasn't preloaded", *Path.ToString())
+	return Path.TryLoad();
+}
@@ -0,0 +1,61 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Libraries/PcPhysicsLibrary.h"
+
+#include "CustomLogging.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Internationalization/Regex.h"
+#include "PhysicsEngine/ConstraintInstance.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+
+FTissueConstraintSet UPcPhysicsLibrary::FindTissueConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
+                                                              const FString& JointPatternString)
+{
+	FTissueConstraintSet Set;
+	if(!SkeletalMeshComponent)
+		return Set;
+
+	Set.Component = SkeletalMeshComponent;
+	const FRegexPattern Pattern = FRegexPattern(JointPatternString);
+	for(int32 i = 0; i < SkeletalMeshComponent->Constraints.Num(); i++)
+	{
+		const FConstraintInstance* Constraint = SkeletalMeshComponent->Constraints[i];
+		if(!Constraint)
+			continue;
+		FRegexMatcher Matcher = FRegexMatcher(Pattern, Constraint->JointName.ToString());
+		if(Matcher.FindNext())
+			Set.ConstraintIndexes.Add(i);
+	}
+	LG("Found %d tissue constraints on %s", Set.ConstraintIndexes.Num(), *SkeletalMeshComponent->GetName())
+	return Set;
+}
+
+int32 UPcPhysicsLibrary::SetTissueConstraintProfile(FTissueConstraintSet& TissueConstraints, FName ProfileName, bool bForce)
+{
+	if(!bForce && TissueConstraints.CurrentProfile == ProfileName)
+		return 0;
+
+	USkeletalMeshComponent* SkeletalMeshComponent = TissueConstraints.Component.Get();
+	UPhysicsAsset* PhysicsAsset = SkeletalMeshComponent ? SkeletalMeshComponent->GetPhysicsAsset() : nullptr;
+	if(!PhysicsAsset)
+		return 0;
+
+	int32 NumUpdated = 0;
+	for(int32 Index : TissueConstraints.ConstraintIndexes)
+	{
+		if(!SkeletalMeshComponent->Constraints.IsValidIndex(Index))
+			continue;
+		FConstraintInstance* Constraint = SkeletalMeshComponent->Constraints[Index];
+		if(!Constraint || !PhysicsAsset->ConstraintSetup.IsValidIndex(Constraint->ConstraintIndex))
+			continue;
+		if(const UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[Constraint->ConstraintIndex])
+		{
+			Constraint->CopyProfilePropertiesFrom(Template->GetConstraintProfilePropertiesOrDefault(ProfileName));
+			NumUpdated++;
+		}
+	}
+	TissueConstraints.CurrentProfile = ProfileName;
+	return NumUpdated;
+}
@@ -4,9 +4,41 @@
 
 #include "CoreMinimal.h"
 #include "Structs/FConstraintParams.h"
+#include "Engine/StreamableManager.h"
 #include "UObject/Object.h"
 #include "PcActorDataAsset.generated.h"
 
+/** Inputs hash of one character pipeline stage at its last successful run */
+USTRUCT(BlueprintType)
+struct FPcPipelineStageRecord
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FString InputHash;
+	
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FDateTime LastRun;
+
+	/** Hash of the stage's target asset when the pipeline finished, a target edited since then makes the stage rerun */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FString OutputHash;
+};
+
+/** How the CurveMap/MorphTargetMap variant of the source mesh is produced */
+UENUM(BlueprintType)
+enum class EMorphVariantMode : uint8
+{
+	/** Bakes the morphed pose into a new skeletal mesh asset, set as the TargetSkeletalMesh */
+	BakeSkeletalMesh,
+	/**
+	 * Only the morphed reference pose and the per bone vertices are evaluated and cached for the session.
+	 * No mesh asset is created; bodies and constraints are fitted against the source mesh with the cached pose.
+	 * Hull and level set bodies are fitted by the engine against the mesh's own bones, so they're skipped when the pose moves bones.
+	 */
+	RefPoseCache
+};
+
 /**
  * 
  */
@@ -49,6 +81,13 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	TMap<FName, float> MorphTargetMap;
 
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EMorphVariantMode MorphVariantMode = EMorphVariantMode::BakeSkeletalMesh;
+
+	/** Key of the variant RefPoseTransforms were last evaluated from in RefPoseCache mode */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FString MorphVariantKey;
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	UAnimBlueprint* AnimBlueprintRef;
 
@@ -60,4 +99,54 @@ public:
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	FPhatConstraintOptions PhatConstraintOptions;
+
+	/** Written by the character pipeline, stage name -> hash of the inputs its outputs were built from */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Pipeline")
+	TMap<FName, FPcPipelineStageRecord> PipelineStageRecords;
+
+	/**
+	 * Requests every soft reference in one batched async load. OnLoaded runs on the game thread once all of them
+	 * are resolved. The returned handle keeps them loaded; calling again while a preload is active returns the same handle.
+	 */
+	TSharedPtr<FStreamableHandle> PreloadReferences(FStreamableDelegate OnLoaded = FStreamableDelegate());
+
+	/** Blocks on the active preload, if any */
+	void WaitForPreload() const;
+
+	void ReleasePreload();
+
+	/** Resolved references. These are free after a preload. Otherwise they fall back to a synchronous load. */
+	UFUNCTION(BlueprintCallable, Category = "PoseControl")
+	USkeletalMesh* GetSourceSkeletalMesh() const { return Resolve(SourceSkeletalMesh); }
+	
+	UFUNCTION(BlueprintCallable, Category = "PoseControl")
+	USkeletalMesh* GetTargetSkeletalMesh() const { return Resolve(TargetSkeletalMesh); }
+	
+	UFUNCTION(BlueprintCallable, Category = "PoseControl")
+	UPhysicsAsset* GetSourcePhysicsAsset() const { return Resolve(SourcePhysicsAsset); }
+	
+	UFUNCTION(BlueprintCallable, Category = "PoseControl")
+	UPhysicsAsset* GetTargetPhysicsAsset() const { return Resolve(TargetPhysicsAsset); }
+	
+	UFUNCTION(BlueprintCallable, Category = "PoseControl")
+	UDataTable* GetBodyParamsDataTable() const { return Resolve(BodyParamsDataTable); }
+	
+	UFUNCTION(BlueprintCallable, Category = "PoseControl")
+	UDataTable* GetConstraintParamsDataTable() const { return Resolve(ConstraintParamsDataTable); }
+
+private:
+	template<typename T>
+	T* Resolve(const TSoftObjectPtr<T>& Ptr) const
+	{
+		if(Ptr.IsNull())
+			return nullptr;
+		// The soft pointer caches its resolved object, so this is a weak pointer check after the first hit
+		if(T* Loaded = Ptr.Get())
+			return Loaded;
+		return Cast<T>(ResolveSlow(Ptr.ToSoftObjectPath()));
+	}
+
+	UObject* ResolveSlow(const FSoftObjectPath& Path) const;
+
+	TSharedPtr<FStreamableHandle> PreloadHandle;
 };
@@ -0,0 +1,49 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "PcPhysicsLibrary.generated.h"
+
+class USkeletalMeshComponent;
+
+/** Cached set of tissue constraints on one component. Build once, then switch profiles without name lookups. */
+USTRUCT(BlueprintType)
+struct PCCOMMON_API FTissueConstraintSet
+{
+	GENERATED_BODY()
+public:
+	/** Indexes into the component's Constraints array */
+	UPROPERTY(BlueprintReadOnly)
+	TArray<int32> ConstraintIndexes;
+
+	/** Profile currently applied to the set, NAME_None for the default instance */
+	UPROPERTY(BlueprintReadOnly)
+	FName CurrentProfile = NAME_None;
+
+	TWeakObjectPtr<USkeletalMeshComponent> Component;
+};
+
+/**
+ * Runtime helpers for the tissue physics generated by PoseControlEditor.
+ */
+UCLASS()
+class PCCOMMON_API UPcPhysicsLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	/** Collects the constraints whose joint name matches JointPatternString. Call again after the physics state is recreated. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Find Tissue Constraints", Keywords = "PhysicsAsset"), Category = "PoseControl")
+	static FTissueConstraintSet FindTissueConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
+	                                                  const FString& JointPatternString = TEXT("(glute|breast)"));
+
+	/**
+	 * Switches every constraint in the set to the named profile in one batch. Does nothing if the set is already
+	 * on that profile, so it is safe to call every frame. Constraints without the profile fall back to their default.
+	 * Returns the number of constraints updated.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Set Tissue Constraint Profile", Keywords = "PhysicsAsset"), Category = "PoseControl")
+	static int32 SetTissueConstraintProfile(UPARAM(ref) FTissueConstraintSet& TissueConstraints, FName ProfileName, bool bForce = false);
+};
@@ -148,6 +148,15 @@ public:
 	bool bSlerp = false;
 };
 
+UENUM(BlueprintType)
+enum class EBodyFitMode : uint8
+{
+	/** Sphere between bone and parent at PositionRatio, radius RadiusRatio * bone length */
+	BoneRatio,
+	/** Sphere under the nearest skin point: its outer edge SkinDepth below the skin, filling the space down to the bone */
+	SkinSurface
+};
+
 USTRUCT(BlueprintType)
 struct FAdjustBodiesOptions
 {
@@ -159,6 +168,20 @@ public:
 	float PositionRatio = .3f;
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	float RadiusRatio = .3f;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EBodyFitMode FitMode = EBodyFitMode::BoneRatio;
+	
+	/** SkinSurface: gap between the sphere and the skin */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0, EditCondition="FitMode==EBodyFitMode::SkinSurface"))
+	float SkinDepth = .5f;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0, EditCondition="FitMode==EBodyFitMode::SkinSurface"))
+	float MinRadius = .5f;
+	
+	/** 0 doesn't limit the radius */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0, EditCondition="FitMode==EBodyFitMode::SkinSurface"))
+	float MaxRadius = 0.f;
 };
 
 USTRUCT(BlueprintType)
@@ -176,6 +199,83 @@ public:
 	float OrientationAlpha = 0.f;
 };
 
+UENUM(BlueprintType)
+enum class EPointTopology : uint8
+{
+	/** Each point is linked to its NumClosestPoints nearest points */
+	ClosestPoints,
+	/** Points are projected onto their best-fit surface and linked along a Delaunay triangulation (~3 edges per point) */
+	SurfaceTriangulation
+};
+
+UENUM(BlueprintType)
+enum class ETissueCollisionMode : uint8
+{
+	/** DisableCollision for every constrained pair, one CollisionDisableTable entry each */
+	PairwiseDisable,
+	/** All bodies of the group get an object channel that ignores itself, no table entries */
+	GroupChannel
+};
+
+/** Post-generation pass over the point-to-point constraint graph of one group */
+USTRUCT(BlueprintType)
+struct FConstraintGraphOptions
+{
+	GENERATED_BODY()
+public:
+	/** Keep a single constraint per body pair (A->B and B->A become one) */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bDeduplicate = true;
+
+	/** Remove edges that are nearly collinear with a two-edge path through a third body */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bPruneRedundant = false;
+
+	/** Edge A-B is redundant if a path A-C-B exists with |AC| + |CB| <= |AB| * (1 + RedundancyTolerance) */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bPruneRedundant", ClampMin=0))
+	float RedundancyTolerance = .05f;
+
+	/** Pruning never takes a body below this many point constraints */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=1))
+	int32 MinConstraintsPerBody = 2;
+
+	/** Max point-to-point constraints per group and side, 0 for no limit. The longest edges are removed first. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0))
+	int32 MaxConstraints = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FConstraintGraphReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBefore = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumDuplicates = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumRedundant = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumOverBudget = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumAfter = 0;
+
+	/** Estimated solver rows (constrained axes + driven axes) before and after the pass */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 SolverRowsBefore = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 SolverRowsAfter = 0;
+
+	/** 1 - SolverRowsAfter / SolverRowsBefore */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float SolverCostReduction = 0.f;
+};
+
 USTRUCT(BlueprintType)
 struct FAddPointConstraints
 {
@@ -193,6 +293,14 @@ public:
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	bool bAddMirrorConstraints = true;
+
+	/** Mirror side is copied from the generated side through the symmetry map instead of being generated again. Off keeps generating both sides, which asymmetric meshes need. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bAddMirrorConstraints"))
+	bool bMirrorByCopy = false;
+
+	/** Component space axis across which the sides are mirrored */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bAddMirrorConstraints && bMirrorByCopy"))
+	TEnumAsByte<EAxis::Type> MirrorAxis = EAxis::X;
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	bool bAddPointToParentConstraints = false;
@@ -206,6 +314,26 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	FConstraintParams PointToPointConstraintParams;
 
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bAddPointToPointConstraints"))
+	EPointTopology PointToPointTopology = EPointTopology::ClosestPoints;
+
+	/** Triangulation edges longer than this times the median edge are dropped (sliver triangles on the patch border) */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="PointToPointTopology == EPointTopology::SurfaceTriangulation", ClampMin=1))
+	float MaxTriangulationEdgeRatio = 2.5f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bAddPointToPointConstraints"))
+	FConstraintGraphOptions PointToPointGraphOptions;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	ETissueCollisionMode CollisionMode = ETissueCollisionMode::PairwiseDisable;
+
+	/**
+	 * Object channel reserved for tissue in the project's collision settings, the bodies ignore each other on it.
+	 * MAX, the default, means none: the bodies' collision and the pairwise entries are left unchanged.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="CollisionMode == ETissueCollisionMode::GroupChannel"))
+	TEnumAsByte<ECollisionChannel> TissueCollisionChannel = ECC_MAX;
+
 	/** Map of bone names -> num of points to constrain **/
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	TMap<FName, int32> ExtraBonesToClosestPoints;
@@ -225,8 +353,246 @@ public:
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	FAdjustConstraintsOptions AdjustConstraintsOptions;
+
+	/** Position solver iterations for the group's bodies, 0 keeps the body default. Written by the drive tuner. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0, ClampMax=255))
+	int32 SolverIterations = 0;
+};
+
+
+/** Named constraint profile, written next to the DefaultInstance. Values are scaled from the default profile. */
+USTRUCT(BlueprintType)
+struct FConstraintProfilePreset
+{
+	GENERATED_BODY()
+public:
+	FConstraintProfilePreset(){}
+
+	FConstraintProfilePreset(FName InProfileName, float InStrengthScale, float InDampingScale, float InLinearLimitScale)
+		: ProfileName(InProfileName), LinearStrengthScale(InStrengthScale), AngularStrengthScale(InStrengthScale),
+		  DampingScale(InDampingScale), LinearLimitScale(InLinearLimitScale) { }
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FName ProfileName = FName();
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float LinearStrengthScale = 1.f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float AngularStrengthScale = 1.f;
+
+	/** Applied on top of the strength scale, so the damping ratio of the default profile is kept at 1 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float DampingScale = 1.f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float LinearLimitScale = 1.f;
+
+	/** Turn angular drives off in this profile. Useful for distant LODs where Point-Point constraints only need linear drives. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bDisableAngularDrive = false;
+};
+
+/** Parent/child mass targets. A ratio is parent mass / child mass; children above it are made lighter. */
+USTRUCT(BlueprintType)
+struct FMassRebalanceOptions
+{
+	GENERATED_BODY()
+public:
+	/** Applies to every parent/child pair without a level ratio */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=1))
+	float MinParentChildMassRatio = 1.25f;
+
+	/** Skeleton body / Core body. 0 uses MinParentChildMassRatio. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0))
+	float CoreMassRatio = 0.f;
+
+	/** Core body / Spoke body. 0 uses MinParentChildMassRatio. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0))
+	float SpokeMassRatio = 0.f;
+
+	/** Spoke body / Point body. 0 uses MinParentChildMassRatio. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(ClampMin=0))
+	float PointMassRatio = 0.f;
+
+	/** Also fix inversions between skeleton bodies. Off by default, they are only reported. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bFixSkeletonInversions = false;
+
+	/** Scale the drives of constraints on rescaled bodies by the mass change, so strength stays proportional to mass */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bRederiveDriveStrengths = true;
+};
+
+USTRUCT(BlueprintType)
+struct FMassRebalanceReport
+{
+	GENERATED_BODY()
+public:
+	/** Children that were at or above their parent's mass before the pass */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FName> InvertedBodies;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodiesRescaled = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConstraintsRescaled = 0;
 };
 
+/** How far a physics LOD reduces the tissue groups of its source */
+UENUM(BlueprintType)
+enum class EPhysicsLodLevel : uint8
+{
+	/** Points merge into their spokes */
+	Lod1 = 1,
+	/** Points and spokes merge into their cores */
+	Lod2 = 2
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsLodOptions
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	EPhysicsLodLevel Level = EPhysicsLodLevel::Lod1;
+
+	/** Appended to the source asset name, followed by the level number */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FString AssetSuffix = TEXT("_LOD");
+
+	/** Regex patterns of bodies removed outright. Their own constraints go with them and their mass isn't kept, kept children are reattached to the closest kept ancestor. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FString> DropBodyPatterns = {TEXT("twist"), TEXT("^(thumb|index|middle|ring|pinky)_")};
+
+	/** Merged bodies add their mass to the body they merge into */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bSumMergedMass = true;
+
+	/** Merged bodies also add their shapes to the body they merge into. Off keeps the LOD at one shape per body. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bKeepMergedShapes = false;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsLodReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString AssetPath;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSourceBodies = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSourceConstraints = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodies = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConstraints = 0;
+
+	/** Removed body -> the body now simulating its bone, None for bodies dropped without a kept ancestor */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TMap<FName, FName> BodyMap;
+};
+
+USTRUCT(BlueprintType)
+struct FSolverOrderingOptions
+{
+	GENERATED_BODY()
+public:
+	/** Keeps each tissue group (connected core, spoke and point bodies) contiguous, right after the skeleton body it hangs from */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bGroupByTissueRegion = true;
+
+	/** Reverse Cuthill-McKee over the skeleton bodies, tissue groups still follow their anchor. Off keeps the forward order, root body first. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bReverse = true;
+};
+
+/** Bandwidth is the largest index distance between two constrained bodies, span the mean over all constraints */
+USTRUCT(BlueprintType)
+struct FSolverOrderingReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumRegions = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodiesMoved = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConstraintsMoved = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 BandwidthBefore = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 BandwidthAfter = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MeanSpanBefore = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MeanSpanAfter = 0.f;
+};
+
+/** Which constraints of a master asset to push to its variants, and how their bones are named there */
+USTRUCT(BlueprintType)
+struct FConstraintRetargetOptions
+{
+	GENERATED_BODY()
+public:
+	/** Source constraints to copy. Empty copies all of them. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FName> ConstraintNames;
+
+	/**
+	 * Source bone -> target bone, for bones named differently on the targets. Unlisted bones keep their name.
+	 * Joint names are looked up here too; a joint named after its child bone follows the child's remap.
+	 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TMap<FName, FName> BoneRemap;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (Bitmask, BitmaskEnum = EConstraintOverwrite))
+	EConstraintOverwrite ConstraintOverwrite = EConstraintOverwrite::DrivesLimits;
+
+	/** Create constraints a target is missing. Off only updates existing ones. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bCreateMissing = true;
+
+	/** Keep drive strength / child mass from the source rather than the absolute strength */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bScaleDrivesByMass = true;
+};
+
+USTRUCT(BlueprintType)
+struct FConstraintRetargetReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSourceConstraints = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumTargets = 0;
+
+	/** Summed over the targets */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumUpdated = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumCreated = 0;
+
+	/** Constraints skipped on some target because a bone had no body there, or the joint was missing and bCreateMissing is off */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSkipped = 0;
+};
 
 USTRUCT(BlueprintType)
 struct FPhatConstraintOptions
@@ -257,6 +623,13 @@ public:
 		BreastCores.PointPatternString = TEXT("breast_(\\d{2})_l");
 		BreastSpokes.PointPatternString = TEXT("breast_pt_(\\d{2})_l");
 		BreastPoints.PointPatternString = TEXT("breast_pt_(\\d{2})_(\\d{2})_l");
+
+		ConstraintProfiles.Add(FConstraintProfilePreset(FName("soft"), .5f, 1.5f, 1.5f));
+		ConstraintProfiles.Add(FConstraintProfilePreset(FName("default"), 1.f, 1.f, 1.f));
+		ConstraintProfiles.Add(FConstraintProfilePreset(FName("firm"), 2.f, .75f, .75f));
+		FConstraintProfilePreset LodLow = FConstraintProfilePreset(FName("lod_low"), .5f, 1.f, 1.f);
+		LodLow.bDisableAngularDrive = true;
+		ConstraintProfiles.Add(LodLow);
 	}
 	/** Please add a variable description */
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(DisplayName="ConstraintsToCopy", MakeStructureDefaultValue="None"))
@@ -320,6 +693,20 @@ public:
 	
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(DisplayName="Position to Velocity ratio", MakeStructureDefaultValue="None"))
 	float PositionVelocityRatio = 20.f;
+
+	/** Run RebalanceMassHierarchy before generating, so new drives are derived from the rebalanced masses */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bRebalanceMass = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bRebalanceMass"))
+	FMassRebalanceOptions MassRebalance;
+
+	/** Write ConstraintProfiles into every generated constraint, so stiffness presets can be switched at runtime */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bWriteConstraintProfiles = false;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta=(EditCondition="bWriteConstraintProfiles"))
+	TArray<FConstraintProfilePreset> ConstraintProfiles;
 };
 
 /** Parameters for PhysicsAsset creation */
@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "FPhysicsAssetCostReport.generated.h"
+
+/** Shape, constraint and memory totals, shared by the per-body, per-group and whole-asset rows */
+USTRUCT(BlueprintType)
+struct FPhysicsCostTotals
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSpheres = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBoxes = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumCapsules = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumTaperedCapsules = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConvex = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConvexVertices = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumLevelSets = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumLevelSetCells = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSkinnedLevelSets = 0;
+
+	/** Constraints whose child (ConstraintBone1) is the body */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConstraints = 0;
+
+	/** Estimated solver rows (constrained axes + driven axes) of those constraints */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 SolverRows = 0;
+
+	/** Estimated bytes held by the asset: body setups, shape data, cooked geometry, constraint templates */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int64 AssetBytes = 0;
+
+	/** Estimated bytes per spawned instance: body and constraint instances plus solver particles, shapes and joints */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int64 InstanceBytes = 0;
+
+	int32 GetNumShapes() const
+	{
+		return NumSpheres + NumBoxes + NumCapsules + NumTaperedCapsules + NumConvex + NumLevelSets + NumSkinnedLevelSets;
+	}
+
+	void Add(const FPhysicsCostTotals& Other)
+	{
+		NumSpheres += Other.NumSpheres;
+		NumBoxes += Other.NumBoxes;
+		NumCapsules += Other.NumCapsules;
+		NumTaperedCapsules += Other.NumTaperedCapsules;
+		NumConvex += Other.NumConvex;
+		NumConvexVertices += Other.NumConvexVertices;
+		NumLevelSets += Other.NumLevelSets;
+		NumLevelSetCells += Other.NumLevelSetCells;
+		NumSkinnedLevelSets += Other.NumSkinnedLevelSets;
+		NumConstraints += Other.NumConstraints;
+		SolverRows += Other.SolverRows;
+		AssetBytes += Other.AssetBytes;
+		InstanceBytes += Other.InstanceBytes;
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsBodyCost : public FPhysicsCostTotals
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FName BodyName;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FName Group;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsGroupCost : public FPhysicsCostTotals
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FName Group;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodies = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsAssetCostReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString AssetPath;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FPhysicsBodyCost> Bodies;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FPhysicsGroupCost> Groups;
+
+	/** Whole asset, including the collision disable table */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FPhysicsCostTotals Totals;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodies = 0;
+
+	/** Constraint counts keyed by limit/drive configuration, e.g. "lin LLL ang LLF drv PV" */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TMap<FString, int32> ConstraintConfigs;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumCollisionDisablePairs = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int64 CollisionDisableBytes = 0;
+};
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "FPhysicsAssetValidation.generated.h"
+
+UENUM(BlueprintType)
+enum class EPhysicsAssetIssueType : uint8
+{
+	/** A constraint ref frame with non-unit scale */
+	ConstraintFrameScale,
+	/** A null entry in SkeletalBodySetups */
+	NullBodySetup,
+	/** Zero or non-finite mass, or a non-positive mass or inertia scale */
+	InvalidBodyMass,
+	/** A null constraint template, or one whose bone has no body */
+	MissingConstraintBody,
+	/** A joint name used by an earlier constraint */
+	DuplicateJointName,
+	/** A BodySetupIndexMap entry that doesn't point at its body, or a body missing from the map */
+	StaleBodyIndexMap,
+	/** Two bodies that interpenetrate in the reference pose and still collide with each other */
+	OverlappingColliders
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsAssetValidationOptions
+{
+	GENERATED_BODY()
+public:
+	/** Needs a mesh for the reference pose, the asset's preview mesh if none is given */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bCheckOverlaps = true;
+
+	/** Shapes have to interpenetrate deeper than this (cm) to count as overlapping */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 0))
+	float OverlapTolerance = 0.1f;
+
+	/** Fixes made by FixPhysicsAsset, one per issue type */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bResetFrameScale = true;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bRemoveNullBodies = true;
+
+	/** Clears a non-positive mass override and resets non-positive mass and inertia scales to 1 */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bResetInvalidMass = true;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bRemoveBrokenConstraints = true;
+
+	/** Renames later duplicates after their bodies, numbered if that's taken too */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bRenameDuplicateJoints = true;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bRebuildBodyIndexMap = true;
+
+	/** Off by default: tissue bodies are built overlapping, their collision is meant to be disabled by group instead */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Fixes")
+	bool bDisableOverlapCollision = false;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsAssetIssue
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	EPhysicsAssetIssueType Type = EPhysicsAssetIssueType::ConstraintFrameScale;
+
+	/** Body or constraint index at validation time */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 Index = INDEX_NONE;
+
+	/** The second body of an overlap */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 OtherIndex = INDEX_NONE;
+
+	/** Body, bone or joint name, None for null entries */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FName Name;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString Message;
+
+	/** No fix exists for it, e.g. a body without shapes has no mass to restore */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	bool bFixable = true;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	bool bFixed = false;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsAssetValidationReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString AssetPath;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodies = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConstraints = 0;
+
+	/** Sorted by type, then index */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FPhysicsAssetIssue> Issues;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumFixed = 0;
+
+	/** The overlap check ran, i.e. a mesh was found for the reference pose */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	bool bCheckedOverlaps = false;
+
+	int32 Count(EPhysicsAssetIssueType Type) const
+	{
+		return Issues.FilterByPredicate([Type](const FPhysicsAssetIssue& Issue) { return Issue.Type == Type; }).Num();
+	}
+};
@@ -0,0 +1,181 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#include "FPhysicsSoakBenchmark.generated.h"
+
+class UAnimSequence;
+
+USTRUCT(BlueprintType)
+struct FPhysicsSoakOptions
+{
+	GENERATED_BODY()
+public:
+	/** Played on the mesh while stepping. Without one only the procedural root motion drives the tissue. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TObjectPtr<UAnimSequence> Animation;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 1))
+	int32 NumFrames = 600;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 0.001))
+	float DeltaTime = 1.f / 60.f;
+
+	/** Frames stepped before measuring, while the tissue settles from the reference pose */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 0))
+	int32 WarmupFrames = 30;
+
+	/** Sinusoidal root offset, on top of the animation */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FVector RootMotionAmplitude = FVector(0.f, 0.f, 10.f);
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 0))
+	float RootMotionFrequency = 1.5f;
+
+	/** Regex per tissue group. Matching bodies simulate, everything else follows the animation kinematically. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FString> GroupPatterns = { TEXT("^glute_"), TEXT("^breast_") };
+
+	/** A simulated body faster than this (cm/s) marks the run unstable */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float MaxStableSpeed = 5000.f;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsSoakGroupResult
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString Group;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumBodies = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumConstraints = 0;
+
+	/** Largest distance between the two joint frames of a constraint, cm */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MaxJointSeparation = 0.f;
+
+	/** RMS of the per-frame change in body velocity relative to the root body, cm/s */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float VelocityJitter = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MaxSpeed = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FPhysicsSoakResult
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString AssetPath;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumFrames = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float AvgStepMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MaxStepMs = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MaxJointSeparation = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float VelocityJitter = 0.f;
+
+	/** False if a body went non-finite or faster than MaxStableSpeed */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	bool bStable = true;
+
+	/** 100 / (1 + MaxJointSeparation + VelocityJitter / 10), 0 when unstable. Only comparable between runs with the same options. */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float StabilityScore = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FPhysicsSoakGroupResult> Groups;
+};
+
+USTRUCT(BlueprintType)
+struct FDriveTuningOptions
+{
+	GENERATED_BODY()
+public:
+	FDriveTuningOptions()
+	{
+		Soak.NumFrames = 180;
+	}
+
+	/** Settings of each evaluation run. GroupPatterns is replaced by the tuned groups. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	FPhysicsSoakOptions Soak;
+
+	/** cm/s, see FPhysicsSoakGroupResult::VelocityJitter */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float MaxVelocityJitter = 50.f;
+
+	/** cm */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float MaxJointSeparation = 1.f;
+
+	/** Position solver iterations tried per group, lowest first. The first count where the group meets the targets wins. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<int32> SolverIterationCandidates = { 2, 4, 8, 16 };
+
+	/** Factors tried on each scale during the coordinate search */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<float> ScaleSteps = { .25f, .5f, 2.f, 4.f };
+
+	/** Coordinate search passes over linear strength, angular strength and damping */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 1))
+	int32 NumRounds = 2;
+};
+
+USTRUCT(BlueprintType)
+struct FDriveTuningGroupResult
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString Group;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float LinearStrengthScale = 1.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float AngularStrengthScale = 1.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float DampingScale = 1.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 SolverIterations = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float VelocityJitter = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float MaxJointSeparation = 0.f;
+
+	/** False if no candidate met the targets; the best one at the highest iteration count is kept */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	bool bMeetsTargets = false;
+};
+
+USTRUCT(BlueprintType)
+struct FDriveTuningReport
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FDriveTuningGroupResult> Groups;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumSimulations = 0;
+};
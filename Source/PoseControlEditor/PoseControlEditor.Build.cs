@@ -51,6 +51,7 @@ public class PoseControlEditor : ModuleRules
                 "PcCommon",
                 "Projects",
 				"ToolMenus",
+				"PropertyEditor",
 				"Slate",
 				"SlateCore",
                 "UMG",
@@ -0,0 +1,131 @@
+﻿#include "BackgroundOperation.h"
+
+#include "CustomLogging.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+#define LOCTEXT_NAMESPACE "PcBackgroundOperation"
+
+/** Assets of the running operations. Only touched on the game thread. */
+static TSet<TObjectKey<UObject>> BusyAssets;
+
+FPcBackgroundOperation::FPcBackgroundOperation(const FText& InTitle, FWorkFunction&& InWork, FCommitFunction&& InCommit,
+                                               FOnPcOperationFinished&& InOnFinished)
+	: Title(InTitle), Work(MoveTemp(InWork)), Commit(MoveTemp(InCommit)), OnFinished(MoveTemp(InOnFinished))
+{
+}
+
+bool FPcBackgroundOperation::IsBusy(const UObject* Asset)
+{
+	return Asset && BusyAssets.Contains(TObjectKey<UObject>(Asset));
+}
+
+TSharedPtr<FPcBackgroundOperation> FPcBackgroundOperation::Launch(const FText& Title, const TArray<UObject*>& Assets, FWorkFunction Work,
+                                                                  FCommitFunction Commit, FOnPcOperationFinished OnFinished)
+{
+	check(IsInGameThread());
+	for(const UObject* Asset : Assets)
+	{
+		if(IsBusy(Asset)) {
+			LGE("%s is busy with another operation, %s not started", *Asset->GetName(), *Title.ToString())
+			return nullptr; }
+	}
+
+	TSharedRef<FPcBackgroundOperation> Operation = MakeShareable(new FPcBackgroundOperation(Title, MoveTemp(Work), MoveTemp(Commit), MoveTemp(OnFinished)));
+	for(UObject* Asset : Assets)
+	{
+		if(!Asset)
+			continue;
+		BusyAssets.Add(TObjectKey<UObject>(Asset));
+		Operation->Assets.Add(TObjectKey<UObject>(Asset));
+		if(!Asset->IsRooted())
+		{
+			Asset->AddToRoot();
+			Operation->RootedAssets.Add(Asset);
+		}
+	}
+
+	FNotificationInfo Info(Title);
+	Info.bFireAndForget = false;
+	Info.bUseThrobber = true;
+	Info.ExpireDuration = 3.f;
+	Info.ButtonDetails.Add(FNotificationButtonInfo(LOCTEXT("Cancel", "Cancel"), LOCTEXT("CancelTooltip", "Stop the operation without applying its results"),
+		FSimpleDelegate::CreateSP(Operation, &FPcBackgroundOperation::Cancel), SNotificationItem::CS_Pending));
+	Operation->Notification = FSlateNotificationManager::Get().AddNotification(Info);
+	if(Operation->Notification.IsValid())
+		Operation->Notification->SetCompletionState(SNotificationItem::CS_Pending);
+
+	// The ticker owns the operation until it finishes, which outlives the task, so the task can use a raw pointer
+	FPcBackgroundOperation* RawOperation = &Operation.Get();
+	Operation->StartTime = FPlatformTime::Seconds();
+	Operation->Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [RawOperation]()
+	{
+		return RawOperation->Work(*RawOperation);
+	});
+	Operation->TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Operation](float DeltaTime)
+	{
+		return Operation->Tick(DeltaTime);
+	}));
+	LG("%s started", *Title.ToString())
+	return Operation;
+}
+
+void FPcBackgroundOperation::SetProgress(float Fraction, const FString& Status)
+{
+	FScopeLock Lock(&ProgressLock);
+	Progress = FMath::Clamp(Fraction, 0.f, 1.f);
+	if(!Status.IsEmpty())
+		ProgressStatus = Status;
+}
+
+bool FPcBackgroundOperation::Tick(float DeltaTime)
+{
+	if(Notification.IsValid())
+	{
+		FScopeLock Lock(&ProgressLock);
+		Notification->SetSubText(FText::Format(LOCTEXT("Progress", "{0}%  {1}"), FText::AsNumber(FMath::RoundToInt(Progress * 100.f)),
+		                                       FText::FromString(ProgressStatus)));
+	}
+	if(!Task.IsCompleted())
+		return true;
+	Finish();
+	return false;
+}
+
+void FPcBackgroundOperation::Finish()
+{
+	bool bSuccess = Task.GetResult() && !bCancelled;
+	bool bAssetsValid = true;
+	for(const TObjectKey<UObject>& Asset : Assets)
+		bAssetsValid &= Asset.ResolveObjectPtr() != nullptr;
+	if(bSuccess && !bAssetsValid) {
+		LGE("%s: an asset was unloaded, results discarded", *Title.ToString())
+		bSuccess = false; }
+	if(bSuccess)
+		bSuccess = Commit();
+
+	for(const TObjectKey<UObject>& Asset : Assets)
+		BusyAssets.Remove(Asset);
+	for(const TWeakObjectPtr<UObject>& Asset : RootedAssets)
+	{
+		if(UObject* Object = Asset.Get())
+			Object->RemoveFromRoot();
+	}
+
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+	if(Notification.IsValid())
+	{
+		const FText Result = bCancelled ? LOCTEXT("Cancelled", "Cancelled") : bSuccess ? LOCTEXT("Done", "Done") : LOCTEXT("Failed", "Failed, see the log");
+		Notification->SetSubText(FText::Format(LOCTEXT("Result", "{0} ({1} s)"), Result, FText::AsNumber(FMath::RoundToInt(Seconds))));
+		Notification->SetCompletionState(bSuccess ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		Notification->ExpireAndFadeout();
+		Notification.Reset();
+	}
+	LG("%s %s after %.1f s", *Title.ToString(), bCancelled ? TEXT("cancelled") : bSuccess ? TEXT("finished") : TEXT("failed"), Seconds)
+	OnFinished.ExecuteIfBound(bSuccess);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,61 @@
+﻿#include "BonePose.h"
+
+#include "MorphVariantCache.h"
+#include "SkinSurface.h"
+#include "AnimationRuntime.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+
+FBonePose FBonePose::FromComponent(const USkeletalMeshComponent* SkeletalMeshComponent, bool bWithSkin)
+{
+	FBonePose Pose;
+	if(!SkeletalMeshComponent || !SkeletalMeshComponent->GetSkinnedAsset())
+		return Pose;
+	Pose.RefSkeleton = &SkeletalMeshComponent->GetSkinnedAsset()->GetRefSkeleton();
+	Pose.ComponentSpace = SkeletalMeshComponent->GetComponentSpaceTransforms();
+	Pose.ComponentToWorld = SkeletalMeshComponent->GetComponentTransform();
+	if(bWithSkin)
+		Pose.SkinSurface = FSkinSurface::FromComponent(SkeletalMeshComponent);
+	return Pose;
+}
+
+FBonePose FBonePose::FromRefPose(const USkeletalMesh* SkeletalMesh, bool bWithSkin)
+{
+	FBonePose Pose;
+	if(!SkeletalMesh)
+		return Pose;
+	Pose.RefSkeleton = &SkeletalMesh->GetRefSkeleton();
+	FAnimationRuntime::FillUpComponentSpaceTransforms(*Pose.RefSkeleton, Pose.RefSkeleton->GetRefBonePose(), Pose.ComponentSpace);
+	if(bWithSkin)
+		Pose.SkinSurface = FSkinSurface::FromRefPose(SkeletalMesh);
+	return Pose;
+}
+
+FBonePose FBonePose::FromMorphVariant(const USkeletalMesh* SourceMesh, const FMorphVariant& Variant, bool bWithSkin)
+{
+	FBonePose Pose;
+	if(!SourceMesh || Variant.ComponentSpace.Num() != SourceMesh->GetRefSkeleton().GetNum())
+		return Pose;
+	Pose.RefSkeleton = &SourceMesh->GetRefSkeleton();
+	Pose.ComponentSpace = Variant.ComponentSpace;
+	if(bWithSkin)
+		Pose.SkinSurface = FSkinSurface::FromVertices(SourceMesh, Variant.SkinVertices);
+	return Pose;
+}
+
+int32 FBonePose::GetBoneIndex(FName BoneName) const
+{
+	return RefSkeleton ? RefSkeleton->FindBoneIndex(BoneName) : INDEX_NONE;
+}
+
+FName FBonePose::GetParentBone(FName BoneName) const
+{
+	const int32 BoneIndex = GetBoneIndex(BoneName);
+	const int32 ParentIndex = BoneIndex != INDEX_NONE ? RefSkeleton->GetParentIndex(BoneIndex) : INDEX_NONE;
+	return ParentIndex != INDEX_NONE ? RefSkeleton->GetBoneName(ParentIndex) : NAME_None;
+}
+
+FTransform FBonePose::GetBoneTransform(int32 BoneIndex) const
+{
+	return ComponentSpace.IsValidIndex(BoneIndex) ? ComponentSpace[BoneIndex] * ComponentToWorld : FTransform::Identity;
+}
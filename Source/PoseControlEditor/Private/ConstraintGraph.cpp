@@ -0,0 +1,373 @@
+﻿#include "ConstraintGraph.h"
+
+#include "CustomLogging.h"
+#include "CompGeom/Delaunay2.h"
+#include "PhysicsEngine/ConstraintInstance.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+static uint64 PairKey(int32 A, int32 B)
+{
+	return (uint64(uint32(FMath::Min(A, B))) << 32) | uint64(uint32(FMath::Max(A, B)));
+}
+
+int32 ConstraintGraph::EstimateSolverRows(const FConstraintParams& Params)
+{
+	int32 Rows = 0;
+	Rows += Params.LinearLimitedX != LCM_Free;
+	Rows += Params.LinearLimitedY != LCM_Free;
+	Rows += Params.LinearLimitedZ != LCM_Free;
+	Rows += Params.TwistLimited != ACM_Free;
+	Rows += Params.Swing1Limited != ACM_Free;
+	Rows += Params.Swing2Limited != ACM_Free;
+	if(Params.LinearStrengthMassMultiplier > 0.f || Params.LinearStrength > 0.f)
+		Rows += 3;
+	if(Params.AngularStrengthMassMultiplier > 0.f || Params.AngularStrength > 0.f)
+		Rows += 3;
+	return Rows;
+}
+
+int32 ConstraintGraph::EstimateSolverRows(const FConstraintInstance& Constraint)
+{
+	const FConstraintProfileProperties& Profile = Constraint.ProfileInstance;
+	int32 Rows = 0;
+	Rows += Constraint.GetLinearXMotion() != LCM_Free;
+	Rows += Constraint.GetLinearYMotion() != LCM_Free;
+	Rows += Constraint.GetLinearZMotion() != LCM_Free;
+	Rows += Constraint.GetAngularTwistMotion() != ACM_Free;
+	Rows += Constraint.GetAngularSwing1Motion() != ACM_Free;
+	Rows += Constraint.GetAngularSwing2Motion() != ACM_Free;
+
+	for(const FConstraintDrive* Drive : {&Profile.LinearDrive.XDrive, &Profile.LinearDrive.YDrive, &Profile.LinearDrive.ZDrive})
+	{
+		Rows += Drive->bEnablePositionDrive || Drive->bEnableVelocityDrive;
+	}
+	const FAngularDriveConstraint& Angular = Profile.AngularDrive;
+	if(Angular.AngularDriveMode == EAngularDriveMode::SLERP)
+	{
+		Rows += (Angular.SlerpDrive.bEnablePositionDrive || Angular.SlerpDrive.bEnableVelocityDrive) ? 3 : 0;
+	}
+	else
+	{
+		Rows += (Angular.TwistDrive.bEnablePositionDrive || Angular.TwistDrive.bEnableVelocityDrive) ? 1 : 0;
+		Rows += (Angular.SwingDrive.bEnablePositionDrive || Angular.SwingDrive.bEnableVelocityDrive) ? 2 : 0;
+	}
+	return Rows;
+}
+
+void ConstraintGraph::FilterEdges(TArray<FConstraintEdge>& Edges, const FConstraintGraphOptions& Options,
+                                  FConstraintGraphReport& OutReport)
+{
+	const int32 NumEdges = Edges.Num();
+	OutReport.NumBefore += NumEdges;
+	for(const FConstraintEdge& Edge : Edges)
+		OutReport.SolverRowsBefore += Edge.Rows;
+
+	TBitArray<> Removed(false, NumEdges);
+	int32 NumNodes = 0;
+	for(int32 i = 0; i < NumEdges; i++)
+		NumNodes = FMath::Max(NumNodes, FMath::Max(Edges[i].A, Edges[i].B) + 1);
+
+	if(Options.bDeduplicate)
+	{
+		TSet<uint64> Seen;
+		Seen.Reserve(NumEdges);
+		for(int32 i = 0; i < NumEdges; i++)
+		{
+			bool bAlreadyInSet = false;
+			Seen.Add(PairKey(Edges[i].A, Edges[i].B), &bAlreadyInSet);
+			if(bAlreadyInSet || Edges[i].A == Edges[i].B)
+			{
+				Removed[i] = true;
+				OutReport.NumDuplicates++;
+			}
+		}
+	}
+
+	// Adjacency of the remaining graph, as edge indices per node
+	TArray<TArray<int32>> NodeEdges;
+	TArray<int32> Degree;
+	NodeEdges.SetNum(NumNodes);
+	Degree.Init(0, NumNodes);
+	int32 NumAlive = 0;
+	for(int32 i = 0; i < NumEdges; i++)
+	{
+		if(Removed[i])
+			continue;
+		NodeEdges[Edges[i].A].Add(i);
+		NodeEdges[Edges[i].B].Add(i);
+		Degree[Edges[i].A]++;
+		Degree[Edges[i].B]++;
+		NumAlive++;
+	}
+
+	auto OtherNode = [&Edges](int32 EdgeIndex, int32 Node)
+	{
+		return Edges[EdgeIndex].A == Node ? Edges[EdgeIndex].B : Edges[EdgeIndex].A;
+	};
+	auto FindEdge = [&](int32 U, int32 V)
+	{
+		for(int32 EdgeIndex : NodeEdges[U])
+		{
+			if(!Removed[EdgeIndex] && OtherNode(EdgeIndex, U) == V)
+				return EdgeIndex;
+		}
+		return int32(INDEX_NONE);
+	};
+	auto TryRemove = [&](int32 EdgeIndex, int32 MinDegree)
+	{
+		const FConstraintEdge& Edge = Edges[EdgeIndex];
+		if(Removed[EdgeIndex] || Degree[Edge.A] <= MinDegree || Degree[Edge.B] <= MinDegree)
+			return false;
+		Removed[EdgeIndex] = true;
+		Degree[Edge.A]--;
+		Degree[Edge.B]--;
+		NumAlive--;
+		return true;
+	};
+
+	// Longest edges first, they are the ones most likely to be spanned by shorter paths
+	TArray<int32> Order;
+	Order.Reserve(NumAlive);
+	for(int32 i = 0; i < NumEdges; i++)
+	{
+		if(!Removed[i])
+			Order.Add(i);
+	}
+	Order.Sort([&Edges](int32 L, int32 R) { return Edges[L].Length > Edges[R].Length; });
+
+	if(Options.bPruneRedundant)
+	{
+		const int32 MinDegree = FMath::Max(1, Options.MinConstraintsPerBody);
+		for(int32 EdgeIndex : Order)
+		{
+			const FConstraintEdge& Edge = Edges[EdgeIndex];
+			const float MaxPath = Edge.Length * (1.f + Options.RedundancyTolerance);
+			for(int32 SideIndex : NodeEdges[Edge.A])
+			{
+				if(SideIndex == EdgeIndex || Removed[SideIndex] || Edges[SideIndex].Length >= MaxPath)
+					continue;
+				const int32 C = OtherNode(SideIndex, Edge.A);
+				const int32 OtherSide = C != Edge.B ? FindEdge(C, Edge.B) : INDEX_NONE;
+				if(OtherSide != INDEX_NONE && Edges[SideIndex].Length + Edges[OtherSide].Length <= MaxPath)
+				{
+					if(TryRemove(EdgeIndex, MinDegree))
+						OutReport.NumRedundant++;
+					break;
+				}
+			}
+		}
+	}
+
+	if(Options.MaxConstraints > 0)
+	{
+		// Never isolate a body to meet the budget
+		for(int32 EdgeIndex : Order)
+		{
+			if(NumAlive <= Options.MaxConstraints)
+				break;
+			if(TryRemove(EdgeIndex, 1))
+				OutReport.NumOverBudget++;
+		}
+		if(NumAlive > Options.MaxConstraints)
+		{
+			LGW("Constraint budget %d not met, %d constraints needed to keep every body connected", Options.MaxConstraints, NumAlive)
+		}
+	}
+
+	TArray<FConstraintEdge> Kept;
+	Kept.Reserve(NumAlive);
+	for(int32 i = 0; i < NumEdges; i++)
+	{
+		if(!Removed[i])
+		{
+			Kept.Add(Edges[i]);
+			OutReport.SolverRowsAfter += Edges[i].Rows;
+		}
+	}
+	OutReport.NumAfter += Kept.Num();
+	OutReport.SolverCostReduction = OutReport.SolverRowsBefore > 0
+		? 1.f - float(OutReport.SolverRowsAfter) / float(OutReport.SolverRowsBefore)
+		: 0.f;
+	Edges = MoveTemp(Kept);
+}
+
+void ConstraintGraph::AppendReport(FConstraintGraphReport& Into, const FConstraintGraphReport& From)
+{
+	Into.NumBefore += From.NumBefore;
+	Into.NumDuplicates += From.NumDuplicates;
+	Into.NumRedundant += From.NumRedundant;
+	Into.NumOverBudget += From.NumOverBudget;
+	Into.NumAfter += From.NumAfter;
+	Into.SolverRowsBefore += From.SolverRowsBefore;
+	Into.SolverRowsAfter += From.SolverRowsAfter;
+	Into.SolverCostReduction = Into.SolverRowsBefore > 0
+		? 1.f - float(Into.SolverRowsAfter) / float(Into.SolverRowsBefore)
+		: 0.f;
+}
+
+// Dominant eigenvector by power iteration, same approach as ComputeEigenVector in Utils.h
+static FVector DominantAxis(const FMatrix& A, const FVector& Start)
+{
+	FVector Bk = Start;
+	for(int32 i = 0; i < 32; ++i)
+	{
+		const FVector Next = A.TransformVector(Bk);
+		const double Length = Next.Size();
+		if(Length <= UE_SMALL_NUMBER)
+			break;
+		Bk = Next / Length;
+	}
+	return Bk.GetSafeNormal();
+}
+
+static void ComputeSurfaceFrame(const TArray<FVector>& Points, FVector& OutCenter, FVector& OutAxis1, FVector& OutAxis2)
+{
+	OutCenter = FVector::ZeroVector;
+	for(const FVector& Point : Points)
+		OutCenter += Point;
+	OutCenter /= double(Points.Num());
+
+	FMatrix Covariance = FMatrix(EForceInit::ForceInitToZero);
+	for(const FVector& Point : Points)
+	{
+		const FVector D = Point - OutCenter;
+		for(int32 j = 0; j < 3; j++)
+			for(int32 k = 0; k < 3; k++)
+				Covariance.M[j][k] += D[j] * D[k];
+	}
+
+	OutAxis1 = DominantAxis(Covariance, FVector(1, 1, 1).GetSafeNormal());
+	if(OutAxis1.IsNearlyZero())
+		OutAxis1 = FVector::XAxisVector;
+
+	// Deflate the first axis out, the second largest variance is the other in-plane axis
+	const double Lambda1 = FVector::DotProduct(OutAxis1, Covariance.TransformVector(OutAxis1));
+	FMatrix Deflated = Covariance;
+	for(int32 j = 0; j < 3; j++)
+		for(int32 k = 0; k < 3; k++)
+			Deflated.M[j][k] -= Lambda1 * OutAxis1[j] * OutAxis1[k];
+
+	FVector Unused;
+	OutAxis1.FindBestAxisVectors(OutAxis2, Unused);
+	OutAxis2 = DominantAxis(Deflated, OutAxis2);
+	OutAxis2 = (OutAxis2 - OutAxis1 * FVector::DotProduct(OutAxis2, OutAxis1)).GetSafeNormal();
+	if(OutAxis2.IsNearlyZero())
+		OutAxis1.FindBestAxisVectors(OutAxis2, Unused);
+}
+
+bool ConstraintGraph::TriangulateSurfaceEdges(const TArray<FVector>& Points, float MaxEdgeRatio, int32 Rows,
+                                              TArray<FConstraintEdge>& OutEdges)
+{
+	const int32 NumPoints = Points.Num();
+	OutEdges.Reset();
+	if(NumPoints < 2)
+		return false;
+	if(NumPoints <= 3)
+	{
+		for(int32 i = 0; i < NumPoints; i++)
+			for(int32 j = i + 1; j < NumPoints; j++)
+				OutEdges.Add(FConstraintEdge(i, j, FVector::Dist(Points[i], Points[j]), Rows));
+		return true;
+	}
+
+	FVector Center, Axis1, Axis2;
+	ComputeSurfaceFrame(Points, Center, Axis1, Axis2);
+	TArray<FVector2d> Projected;
+	Projected.Reserve(NumPoints);
+	for(const FVector& Point : Points)
+	{
+		const FVector D = Point - Center;
+		Projected.Add(FVector2d(FVector::DotProduct(D, Axis1), FVector::DotProduct(D, Axis2)));
+	}
+
+	UE::Geometry::FDelaunay2 Delaunay;
+	if(!Delaunay.Triangulate(Projected))
+	{
+		LGE("Delaunay triangulation failed for %d points", NumPoints)
+		return false;
+	}
+
+	// Where the patch curves away from the plane, projected neighbours aren't surface neighbours and their triangles stand
+	// nearly edge-on to the plane, so those are dropped. Edges are counted per kept triangle to tell the boundary apart.
+	constexpr double MinProjectedAreaRatio = 0.25;
+	const FVector PlaneNormal = FVector::CrossProduct(Axis1, Axis2).GetSafeNormal();
+	TMap<uint64, int32> TrianglesPerEdge;
+	TArray<UE::Geometry::FIndex3i> Folded;
+	for(const UE::Geometry::FIndex3i& Triangle : Delaunay.GetTriangles())
+	{
+		const FVector Normal = FVector::CrossProduct(Points[Triangle.B] - Points[Triangle.A], Points[Triangle.C] - Points[Triangle.A]);
+		const double Area = Normal.Size();
+		if(Area > UE_SMALL_NUMBER && FMath::Abs(FVector::DotProduct(Normal, PlaneNormal)) < Area * MinProjectedAreaRatio)
+		{
+			Folded.Add(Triangle);
+			continue;
+		}
+		for(int32 Corner = 0; Corner < 3; Corner++)
+		{
+			const int32 A = Triangle[Corner];
+			const int32 B = Triangle[(Corner + 1) % 3];
+			int32& Count = TrianglesPerEdge.FindOrAdd(PairKey(A, B));
+			if(Count++ == 0)
+				OutEdges.Add(FConstraintEdge(FMath::Min(A, B), FMath::Max(A, B), FVector::Dist(Points[A], Points[B]), Rows));
+		}
+	}
+
+	TArray<int32> Degree;
+	Degree.Init(0, NumPoints);
+	for(const FConstraintEdge& Edge : OutEdges)
+	{
+		Degree[Edge.A]++;
+		Degree[Edge.B]++;
+	}
+	// A point only on folded triangles keeps its shortest edge of them
+	for(int32 Point = 0; Point < NumPoints; Point++)
+	{
+		if(Degree[Point] > 0)
+			continue;
+		int32 Closest = INDEX_NONE;
+		for(const UE::Geometry::FIndex3i& Triangle : Folded)
+		{
+			if(!Triangle.Contains(Point))
+				continue;
+			for(int32 Corner = 0; Corner < 3; Corner++)
+			{
+				const int32 Other = Triangle[Corner];
+				if(Other != Point && (Closest == INDEX_NONE
+					|| FVector::DistSquared(Points[Point], Points[Other]) < FVector::DistSquared(Points[Point], Points[Closest])))
+					Closest = Other;
+			}
+		}
+		if(Closest != INDEX_NONE && !TrianglesPerEdge.Contains(PairKey(Point, Closest)))
+		{
+			TrianglesPerEdge.Add(PairKey(Point, Closest), 0);
+			OutEdges.Add(FConstraintEdge(FMath::Min(Point, Closest), FMath::Max(Point, Closest), FVector::Dist(Points[Point], Points[Closest]), Rows));
+			Degree[Point]++;
+			Degree[Closest]++;
+		}
+	}
+
+	// Border slivers: drop long boundary edges (on a single triangle) as long as both points keep another edge.
+	// Interior edges stay whatever their length, removing them would open holes in the surface.
+	if(MaxEdgeRatio > 0.f && OutEdges.Num() > 2)
+	{
+		TArray<float> Lengths;
+		Lengths.Reserve(OutEdges.Num());
+		for(const FConstraintEdge& Edge : OutEdges)
+			Lengths.Add(Edge.Length);
+		Lengths.Sort();
+		const float MaxLength = Lengths[Lengths.Num() / 2] * MaxEdgeRatio;
+
+		OutEdges.Sort([](const FConstraintEdge& L, const FConstraintEdge& R) { return L.Length > R.Length; });
+		OutEdges.RemoveAll([&](const FConstraintEdge& Edge)
+		{
+			if(Edge.Length <= MaxLength || TrianglesPerEdge[PairKey(Edge.A, Edge.B)] != 1 || Degree[Edge.A] <= 1 || Degree[Edge.B] <= 1)
+				return false;
+			Degree[Edge.A]--;
+			Degree[Edge.B]--;
+			return true;
+		});
+	}
+	return true;
+}
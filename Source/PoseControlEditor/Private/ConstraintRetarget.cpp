@@ -0,0 +1,187 @@
+﻿#include "ConstraintRetarget.h"
+
+#include "CustomLogging.h"
+#include "JointNames.h"
+#include "PackageSaveScope.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "Async/ParallelFor.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+/** Source constraint with its drive strengths relative to the source child mass */
+struct FSourceConstraint
+{
+	FConstraintParams Params;
+	bool bHasMass = false;
+};
+
+struct FTargetPlan
+{
+	TArray<FConstraintParams> Updates;
+	TArray<FConstraintParams> Creates;
+	int32 NumSkipped = 0;
+};
+
+static FName RemapBone(const TMap<FName, FName>& BoneRemap, FName BoneName)
+{
+	const FName* Remapped = BoneRemap.Find(BoneName);
+	return Remapped ? *Remapped : BoneName;
+}
+
+/** Explicit joint remap first, then JointNames pair names are rebuilt from the remapped bones */
+static FName RemapJoint(const TMap<FName, FName>& BoneRemap, FName JointName, FName SourceChild, FName SourceParent,
+                        FName TargetChild, FName TargetParent)
+{
+	if(const FName* Remapped = BoneRemap.Find(JointName))
+		return *Remapped;
+	if((SourceChild != TargetChild || SourceParent != TargetParent) && JointName == JointNames::MakePairName(SourceChild, SourceParent))
+		return JointNames::MakePairName(TargetChild, TargetParent);
+	return JointName;
+}
+
+static void ReadSource(const UPhysicsAsset* PhysicsAsset, const FConstraintRetargetOptions& Options, TArray<FSourceConstraint>& OutConstraints)
+{
+	TArray<int32> ConstraintIndexes;
+	for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+	{
+		const UPhysicsConstraintTemplate* Constraint = PhysicsAsset->ConstraintSetup[i];
+		if(Constraint && (Options.ConstraintNames.IsEmpty() || Options.ConstraintNames.Contains(Constraint->DefaultInstance.JointName)))
+			ConstraintIndexes.Add(i);
+	}
+
+	// One mass per child body, however many constraints share it
+	TMap<int32, float> ChildMasses;
+	for(int32 ConstraintIndex : ConstraintIndexes)
+	{
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance.ConstraintBone1);
+		if(BodyIndex != INDEX_NONE && !ChildMasses.Contains(BodyIndex))
+			ChildMasses.Add(BodyIndex, PhysicsAsset->SkeletalBodySetups[BodyIndex]->CalculateMass());
+	}
+
+	OutConstraints.SetNum(ConstraintIndexes.Num());
+	for(int32 i = 0; i < ConstraintIndexes.Num(); i++)
+	{
+		const FConstraintInstance& Instance = PhysicsAsset->ConstraintSetup[ConstraintIndexes[i]]->DefaultInstance;
+		const float* Mass = ChildMasses.Find(PhysicsAsset->FindBodyIndex(Instance.ConstraintBone1));
+		FSourceConstraint& Source = OutConstraints[i];
+		UPhysicsEditorBPLibrary::ReadConstraintParams(Instance, Mass ? *Mass : 0.f, Source.Params);
+		Source.Params.ConstraintOverwrite = Options.ConstraintOverwrite;
+		Source.Params.bOverwriteExisting = true;
+		Source.bHasMass = Mass && *Mass > 0.f;
+	}
+}
+
+/** Reads the target only, so targets are planned in parallel */
+static void PlanTarget(const UPhysicsAsset* PhysicsAsset, const TArray<FSourceConstraint>& Sources, const FConstraintRetargetOptions& Options,
+                       FTargetPlan& OutPlan)
+{
+	TMap<int32, float> ChildMasses;
+	for(const FSourceConstraint& Source : Sources)
+	{
+		FConstraintParams Params = Source.Params;
+		Params.ConstraintBone1 = RemapBone(Options.BoneRemap, Source.Params.ConstraintBone1);
+		Params.ConstraintBone2 = RemapBone(Options.BoneRemap, Source.Params.ConstraintBone2);
+		Params.JointName = RemapJoint(Options.BoneRemap, Source.Params.JointName, Source.Params.ConstraintBone1, Source.Params.ConstraintBone2,
+		                              Params.ConstraintBone1, Params.ConstraintBone2);
+
+		const int32 ChildIndex = PhysicsAsset->FindBodyIndex(Params.ConstraintBone1);
+		if(ChildIndex == INDEX_NONE || PhysicsAsset->FindBodyIndex(Params.ConstraintBone2) == INDEX_NONE)
+		{
+			OutPlan.NumSkipped++;
+			continue;
+		}
+
+		// Resolve the strengths here so the game thread apply doesn't compute masses again
+		if(Options.bScaleDrivesByMass && Source.bHasMass)
+		{
+			float* Mass = ChildMasses.Find(ChildIndex);
+			if(!Mass)
+				Mass = &ChildMasses.Add(ChildIndex, PhysicsAsset->SkeletalBodySetups[ChildIndex]->CalculateMass());
+			if(*Mass > 0.f)
+			{
+				Params.LinearStrength = Params.LinearStrengthMassMultiplier * *Mass;
+				Params.AngularStrength = Params.AngularStrengthMassMultiplier * *Mass;
+			}
+		}
+		Params.LinearStrengthMassMultiplier = 0.f;
+		Params.AngularStrengthMassMultiplier = 0.f;
+
+		if(PhysicsAsset->FindConstraintIndex(Params.JointName) != INDEX_NONE)
+			OutPlan.Updates.Add(MoveTemp(Params));
+		else if(Options.bCreateMissing)
+			OutPlan.Creates.Add(MoveTemp(Params));
+		else
+			OutPlan.NumSkipped++;
+	}
+}
+
+bool ConstraintRetarget::Retarget(UPhysicsAsset* SourcePhysicsAsset, const TArray<UPhysicsAsset*>& TargetPhysicsAssets,
+                                  const FConstraintRetargetOptions& Options, FConstraintRetargetReport& OutReport)
+{
+	OutReport = FConstraintRetargetReport();
+	if(!SourcePhysicsAsset) {
+		LGE("Source physics asset not found")
+		return false; }
+
+	TArray<UPhysicsAsset*> Targets;
+	for(UPhysicsAsset* Target : TargetPhysicsAssets)
+	{
+		if(Target && Target != SourcePhysicsAsset)
+			Targets.AddUnique(Target);
+	}
+	if(Targets.IsEmpty()) {
+		LGE("No target physics assets")
+		return false; }
+
+	TArray<FSourceConstraint> Sources;
+	ReadSource(SourcePhysicsAsset, Options, Sources);
+	OutReport.NumSourceConstraints = Sources.Num();
+	OutReport.NumTargets = Targets.Num();
+	if(Sources.IsEmpty()) {
+		LGE("No matching constraints in %s", *SourcePhysicsAsset->GetName())
+		return false; }
+
+	TArray<FTargetPlan> Plans;
+	Plans.SetNum(Targets.Num());
+	ParallelFor(Targets.Num(), [&Targets, &Sources, &Options, &Plans](int32 TargetIndex)
+	{
+		PlanTarget(Targets[TargetIndex], Sources, Options, Plans[TargetIndex]);
+	});
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("ConstraintRetarget", "RetargetConstraints", "Retarget Constraints"));
+	FScopedPackageSave SaveScope;
+	TArray<UObject*> Modified;
+	for(int32 i = 0; i < Targets.Num(); i++)
+	{
+		UPhysicsAsset* Target = Targets[i];
+		const FTargetPlan& Plan = Plans[i];
+		int32 NumUpdated = 0, NumCreated = 0;
+		for(const FConstraintParams& Params : Plan.Updates)
+		{
+			if(UPhysicsEditorBPLibrary::ApplyConstraintParams(Target, Params))
+				NumUpdated++;
+		}
+		for(const FConstraintParams& Params : Plan.Creates)
+		{
+			// MakeNewConstraint applies the params itself
+			if(UPhysicsEditorBPLibrary::MakeNewConstraint(Target, Params) != INDEX_NONE)
+				NumCreated++;
+		}
+		LG("Retargeted %s: %d updated, %d created, %d skipped", *Target->GetName(), NumUpdated, NumCreated, Plan.NumSkipped)
+		OutReport.NumUpdated += NumUpdated;
+		OutReport.NumCreated += NumCreated;
+		OutReport.NumSkipped += Plan.NumSkipped;
+		if(NumUpdated + NumCreated > 0)
+		{
+			Target->MarkPackageDirty();
+			Modified.Add(Target);
+		}
+	}
+	FScopedPackageSave::RequestSave(Modified);
+	return OutReport.NumUpdated + OutReport.NumCreated > 0;
+}
@@ -0,0 +1,240 @@
+﻿#include "DriveTuner.h"
+
+#include "CustomLogging.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "PhysicsSoakBenchmark.h"
+#include "SymmetryMap.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+struct FTunedGroup
+{
+	FAddPointConstraints* Options = nullptr;
+	/** Point pattern and its mirror, as one soak group */
+	FString Pattern;
+	TArray<FName> Bodies;
+	TArray<int32> Constraints;
+	/** Profiles of Constraints before tuning, the scales are applied on top of these */
+	TArray<FConstraintProfileProperties> BaseProfiles;
+	FConstraintProfilePreset Scales;
+	int32 SolverIterations = 0;
+};
+
+struct FTuningScore
+{
+	float Jitter = 0.f;
+	float Separation = 0.f;
+	bool bStable = false;
+
+	bool MeetsTargets(const FDriveTuningOptions& Options) const
+	{
+		return bStable && Jitter <= Options.MaxVelocityJitter && Separation <= Options.MaxJointSeparation;
+	}
+	/** Both targets normalised to 1, unstable runs rank last */
+	float GetCost(const FDriveTuningOptions& Options) const
+	{
+		return (bStable ? 0.f : 1000.f) + Jitter / FMath::Max(Options.MaxVelocityJitter, UE_KINDA_SMALL_NUMBER)
+			+ Separation / FMath::Max(Options.MaxJointSeparation, UE_KINDA_SMALL_NUMBER);
+	}
+};
+
+static void ApplyScales(UPhysicsAsset* PhysicsAsset, const FTunedGroup& Group)
+{
+	for(int32 i = 0; i < Group.Constraints.Num(); i++)
+	{
+		PhysicsAsset->ConstraintSetup[Group.Constraints[i]]->DefaultInstance.ProfileInstance =
+			UPhysicsEditorBPLibrary::MakeProfileProperties(Group.BaseProfiles[i], Group.Scales);
+	}
+}
+
+static void ScaleParams(FConstraintParams& Params, const FConstraintProfilePreset& Scales)
+{
+	if(Params.LinearStrengthMassMultiplier > 0.f)
+		Params.LinearStrengthMassMultiplier *= Scales.LinearStrengthScale;
+	else
+		Params.LinearStrength *= Scales.LinearStrengthScale;
+	if(Params.AngularStrengthMassMultiplier > 0.f)
+		Params.AngularStrengthMassMultiplier *= Scales.AngularStrengthScale;
+	else
+		Params.AngularStrength *= Scales.AngularStrengthScale;
+	// Damping is strength * ratio, so only the damping scale goes into the ratio
+	Params.LinearDampingRatio *= Scales.DampingScale;
+	Params.AngularDampingRatio *= Scales.DampingScale;
+}
+
+void DriveTuner::SetSolverIterations(UPhysicsAsset* PhysicsAsset, const TArray<FName>& BodyNames, int32 Iterations)
+{
+	const uint8 Count = uint8(FMath::Clamp(Iterations, 1, 255));
+	for(const FName& BodyName : BodyNames)
+	{
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
+		if(BodyIndex == INDEX_NONE)
+			continue;
+		FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, BodyIndex);
+		PhysicsAsset->SkeletalBodySetups[BodyIndex]->DefaultInstance.PositionSolverIterationCount = Count;
+	}
+}
+
+bool DriveTuner::Tune(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions& InOutOptions,
+                      const FDriveTuningOptions& Options, FDriveTuningReport& OutReport)
+{
+	OutReport = FDriveTuningReport();
+	if(!SkeletalMesh || !PhysicsAsset) {
+		LGE("Skeletal mesh or physics asset not found")
+		return false; }
+	if(Options.SolverIterationCandidates.IsEmpty()) {
+		LGE("No solver iteration candidates")
+		return false; }
+	
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("DriveTuner", "TuneConstraintDrives", "Tune Constraint Drives"));
+	TArray<FName> BodyNames;
+	PhysicsAsset->BodySetupIndexMap.GetKeys(BodyNames);
+
+	TArray<FTunedGroup> Groups;
+	const TPair<bool, FAddPointConstraints*> Candidates[] = {
+		{InOutOptions.bAddGluteCores, &InOutOptions.GluteCores}, {InOutOptions.bAddGluteSpokes, &InOutOptions.GluteSpokes},
+		{InOutOptions.bAddGlutePoints, &InOutOptions.GlutePoints}, {InOutOptions.bAddBreastCores, &InOutOptions.BreastCores},
+		{InOutOptions.bAddBreastSpokes, &InOutOptions.BreastSpokes}, {InOutOptions.bAddBreastPoints, &InOutOptions.BreastPoints}};
+	for(const TPair<bool, FAddPointConstraints*>& Candidate : Candidates)
+	{
+		if(!Candidate.Key)
+			continue;
+		FTunedGroup Group;
+		Group.Options = Candidate.Value;
+		const FString& PointPattern = Group.Options->PointPatternString;
+		Group.Pattern = Group.Options->bAddMirrorConstraints ? FString::Printf(TEXT("(%s)|(%s)"), *PointPattern, *FBilateralSymmetryMap::MirrorString(PointPattern)) : PointPattern;
+		Group.Bodies = UPhysicsEditorBPLibrary::FilterNames(BodyNames, Group.Pattern);
+		const TSet<FName> BodySet(Group.Bodies);
+		for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+		{
+			if(!PhysicsAsset->ConstraintSetup[i])
+				continue;
+			const FConstraintInstance& Constraint = PhysicsAsset->ConstraintSetup[i]->DefaultInstance;
+			if(!BodySet.Contains(Constraint.ConstraintBone1))
+				continue;
+			FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, i);
+			Group.Constraints.Add(i);
+			Group.BaseProfiles.Add(Constraint.ProfileInstance);
+		}
+		if(Group.Constraints.IsEmpty())
+		{
+			LGW("No constraints for %s, generate them before tuning", *PointPattern)
+			continue;
+		}
+		Groups.Add(MoveTemp(Group));
+	}
+	if(Groups.IsEmpty())
+		return false;
+
+	FPhysicsSoakOptions SoakOptions = Options.Soak;
+	SoakOptions.GroupPatterns.Reset();
+	for(const FTunedGroup& Group : Groups)
+		SoakOptions.GroupPatterns.Add(Group.Pattern);
+	// Lowest first, so the first count that meets the targets is the cheapest and the fallback is the highest
+	TArray<int32> IterationCandidates = Options.SolverIterationCandidates;
+	IterationCandidates.Sort();
+
+	auto Evaluate = [&](int32 GroupIndex)
+	{
+		ApplyScales(PhysicsAsset, Groups[GroupIndex]);
+		FPhysicsSoakResult Result;
+		FTuningScore Score;
+		OutReport.NumSimulations++;
+		if(PhysicsSoakBenchmark::Run(SkeletalMesh, PhysicsAsset, SoakOptions, Result) && Result.Groups.IsValidIndex(GroupIndex))
+		{
+			Score.bStable = Result.bStable;
+			Score.Jitter = Result.Groups[GroupIndex].VelocityJitter;
+			Score.Separation = Result.Groups[GroupIndex].MaxJointSeparation;
+		}
+		return Score;
+	};
+
+	for(int32 g = 0; g < Groups.Num(); g++)
+	{
+		FTunedGroup& Group = Groups[g];
+		LG("Tuning %s (%d bodies, %d constraints)", *Group.Pattern, Group.Bodies.Num(), Group.Constraints.Num())
+		FConstraintProfilePreset BestScales;
+		FTuningScore BestScore;
+		int32 BestIterations = IterationCandidates.Last();
+		float BestCost = MAX_FLT;
+		bool bMet = false;
+		for(const int32 Iterations : IterationCandidates)
+		{
+			SetSolverIterations(PhysicsAsset, Group.Bodies, Iterations);
+			Group.Scales = FConstraintProfilePreset();
+			FTuningScore Score = Evaluate(g);
+			float Cost = Score.GetCost(Options);
+			for(int32 Round = 0; Round < Options.NumRounds && !Score.MeetsTargets(Options); Round++)
+			{
+				for(float FConstraintProfilePreset::* Scale : {&FConstraintProfilePreset::LinearStrengthScale,
+				                                               &FConstraintProfilePreset::AngularStrengthScale,
+				                                               &FConstraintProfilePreset::DampingScale})
+				{
+					const float Current = Group.Scales.*Scale;
+					float BestValue = Current;
+					for(const float Step : Options.ScaleSteps)
+					{
+						Group.Scales.*Scale = Current * Step;
+						const FTuningScore StepScore = Evaluate(g);
+						const float StepCost = StepScore.GetCost(Options);
+						if(StepCost < Cost)
+						{
+							Cost = StepCost;
+							Score = StepScore;
+							BestValue = Group.Scales.*Scale;
+						}
+					}
+					Group.Scales.*Scale = BestValue;
+				}
+			}
+			LGV("  %d iterations: jitter %.2f, separation %.3f", Iterations, Score.Jitter, Score.Separation)
+			if(Score.MeetsTargets(Options) || Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestScore = Score;
+				BestScales = Group.Scales;
+				BestIterations = Iterations;
+			}
+			if(Score.MeetsTargets(Options))
+			{
+				bMet = true;
+				break;
+			}
+		}
+
+		// Keep the winner applied while the next groups are tuned
+		Group.Scales = BestScales;
+		Group.SolverIterations = BestIterations;
+		ApplyScales(PhysicsAsset, Group);
+		SetSolverIterations(PhysicsAsset, Group.Bodies, BestIterations);
+
+		FAddPointConstraints& GroupOptions = *Group.Options;
+		for(FConstraintParams* Params : {&GroupOptions.PointToParentConstraintParams, &GroupOptions.PointToPointConstraintParams,
+		                                 &GroupOptions.ExtraBonesConstraintParams})
+			ScaleParams(*Params, BestScales);
+		GroupOptions.SolverIterations = BestIterations;
+
+		FDriveTuningGroupResult& GroupResult = OutReport.Groups.AddDefaulted_GetRef();
+		GroupResult.Group = Group.Pattern;
+		GroupResult.LinearStrengthScale = BestScales.LinearStrengthScale;
+		GroupResult.AngularStrengthScale = BestScales.AngularStrengthScale;
+		GroupResult.DampingScale = BestScales.DampingScale;
+		GroupResult.SolverIterations = BestIterations;
+		GroupResult.VelocityJitter = BestScore.Jitter;
+		GroupResult.MaxJointSeparation = BestScore.Separation;
+		GroupResult.bMeetsTargets = bMet;
+		LG("  %s: linear x%.2f, angular x%.2f, damping x%.2f at %d iterations, jitter %.2f cm/s, separation %.3f cm%s", *Group.Pattern,
+		   BestScales.LinearStrengthScale, BestScales.AngularStrengthScale, BestScales.DampingScale, BestIterations,
+		   BestScore.Jitter, BestScore.Separation, bMet ? TEXT("") : TEXT(" (targets not met)"))
+	}
+	LG("Drive tuning done after %d simulations", OutReport.NumSimulations)
+
+	PhysicsAsset->MarkPackageDirty();
+	PhysicsAsset->RefreshPhysicsAssetChange();
+	return true;
+}
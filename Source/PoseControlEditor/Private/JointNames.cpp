@@ -0,0 +1,44 @@
+﻿#include "JointNames.h"
+
+FName JointNames::MakePairName(FName ChildBone, FName ParentBone)
+{
+	if(ChildBone.GetNumber() != NAME_NO_NUMBER_INTERNAL)
+	{
+		// The pair number would replace the bone's own number
+		FNameBuilder Base(ChildBone);
+		Base << TEXT("_e");
+		ChildBone = FName(Base.ToView());
+	}
+	// FName hashes depend on the name table, the parent's string doesn't. Lowercase since FNames compare case-insensitively.
+	FNameBuilder Parent(ParentBone);
+	TCHAR* Chars = Parent.GetData();
+	for(int32 i = 0; i < Parent.Len(); i++)
+		Chars[i] = FChar::ToLower(Chars[i]);
+	const uint32 Hash = FCrc::MemCrc32(Chars, Parent.Len() * sizeof(TCHAR));
+	return FName(ChildBone, NAME_EXTERNAL_TO_INTERNAL(int32(Hash & 0x3FFFFFFF)));
+}
+
+void JointNames::FindLegacyPairNames(FName ChildBone, FName ParentBone, TArray<FName, TInlineAllocator<3>>& OutNames)
+{
+	for(const TCHAR* Prefix : {TEXT("pt_pt_"), TEXT("pt_bone_"), TEXT("")})
+	{
+		FNameBuilder Name;
+		Name << Prefix;
+		ChildBone.AppendString(Name);
+		Name << TEXT("__");
+		ParentBone.AppendString(Name);
+		const FName Legacy(Name.ToView(), FNAME_Find);
+		if(!Legacy.IsNone())
+			OutNames.Add(Legacy);
+	}
+}
+
+FName JointNames::MakeSidedName(const TCHAR* Prefix, std::initializer_list<int32> Numbers, int32 Side)
+{
+	TStringBuilder<NAME_SIZE> Name;
+	Name << Prefix;
+	for(int32 Number : Numbers)
+		Name.Appendf(TEXT("_%02d"), Number);
+	Name << (Side == 0 ? TEXT("_l") : TEXT("_r"));
+	return FName(Name.ToView());
+}
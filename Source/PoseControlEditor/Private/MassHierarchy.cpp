@@ -0,0 +1,147 @@
+﻿#include "MassHierarchy.h"
+
+#include "CustomLogging.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "Utils.h"
+#include "Internationalization/Regex.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+static FString MirrorPattern(const FString& Pattern)
+{
+	if(Pattern.EndsWith("_l"))
+		return Pattern.LeftChop(1) + "r";
+	if(Pattern.EndsWith("_r"))
+		return Pattern.LeftChop(1) + "l";
+	return Pattern;
+}
+
+static bool MatchesGroup(const FAddPointConstraints& Group, const FString& BodyName)
+{
+	for(const FString& PatternString : {Group.PointPatternString, MirrorPattern(Group.PointPatternString)})
+	{
+		FRegexMatcher Matcher(FRegexPattern(PatternString), BodyName);
+		if(Matcher.FindNext())
+			return true;
+	}
+	return false;
+}
+
+ETissueLevel MassHierarchy::GetTissueLevel(const FPhatConstraintOptions& PhatOptions, FName BodyName)
+{
+	const FString Name = BodyName.ToString();
+	if(MatchesGroup(PhatOptions.GlutePoints, Name) || MatchesGroup(PhatOptions.BreastPoints, Name))
+		return ETissueLevel::Point;
+	if(MatchesGroup(PhatOptions.GluteSpokes, Name) || MatchesGroup(PhatOptions.BreastSpokes, Name))
+		return ETissueLevel::Spoke;
+	if(MatchesGroup(PhatOptions.GluteCores, Name) || MatchesGroup(PhatOptions.BreastCores, Name))
+		return ETissueLevel::Core;
+	return ETissueLevel::Skeleton;
+}
+
+static float GetTargetRatio(const FMassRebalanceOptions& Options, ETissueLevel Level)
+{
+	const float LevelRatio = Level == ETissueLevel::Core ? Options.CoreMassRatio
+		: Level == ETissueLevel::Spoke ? Options.SpokeMassRatio
+		: Level == ETissueLevel::Point ? Options.PointMassRatio : 0.f;
+	return LevelRatio > 0.f ? LevelRatio : Options.MinParentChildMassRatio;
+}
+
+bool MassHierarchy::Rebalance(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton, const FPhatConstraintOptions& PhatOptions,
+                              const FMassRebalanceOptions& Options, FMassRebalanceReport& OutReport)
+{
+	OutReport = FMassRebalanceReport();
+	if(!PhysicsAsset) {
+		LGE("Physics asset not found")
+		return false; }
+	
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("MassHierarchy", "RebalanceMass", "Rebalance Mass Hierarchy"));
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	TArray<float> Masses, MassScales;
+	Masses.SetNumZeroed(NumBodies);
+	MassScales.Init(1.f, NumBodies);
+	TArray<int32> BodyByBone;
+	BodyByBone.Init(INDEX_NONE, RefSkeleton.GetNum());
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[i];
+		if(!BodySetup)
+			continue;
+		Masses[i] = BodySetup->CalculateMass();
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(BodySetup->BoneName);
+		if(BoneIndex != INDEX_NONE)
+			BodyByBone[BoneIndex] = i;
+	}
+
+	// Bone indexes are sorted parents first, so one pass sees every parent's final mass before its children
+	TArray<int32> ParentBody;
+	ParentBody.Init(INDEX_NONE, RefSkeleton.GetNum());
+	for(int32 BoneIndex = 0; BoneIndex < RefSkeleton.GetNum(); BoneIndex++)
+	{
+		const int32 ParentBone = RefSkeleton.GetParentIndex(BoneIndex);
+		const int32 InheritedBody = ParentBone != INDEX_NONE ? (BodyByBone[ParentBone] != INDEX_NONE ? BodyByBone[ParentBone] : ParentBody[ParentBone]) : INDEX_NONE;
+		ParentBody[BoneIndex] = InheritedBody;
+		const int32 BodyIndex = BodyByBone[BoneIndex];
+		if(BodyIndex == INDEX_NONE || InheritedBody == INDEX_NONE || Masses[BodyIndex] <= 0.f)
+			continue;
+
+		const FName BodyName = PhysicsAsset->SkeletalBodySetups[BodyIndex]->BoneName;
+		const ETissueLevel Level = MassHierarchy::GetTissueLevel(PhatOptions, BodyName);
+		if(Masses[BodyIndex] >= Masses[InheritedBody])
+		{
+			LGW("Mass inversion: %s %.3f kg >= parent %s %.3f kg", *BodyName.ToString(), Masses[BodyIndex],
+			    *PhysicsAsset->SkeletalBodySetups[InheritedBody]->BoneName.ToString(), Masses[InheritedBody])
+			OutReport.InvertedBodies.Add(BodyName);
+		}
+		if(Level == ETissueLevel::Skeleton && !Options.bFixSkeletonInversions)
+			continue;
+		const float TargetMass = Masses[InheritedBody] / GetTargetRatio(Options, Level);
+		if(Masses[BodyIndex] <= TargetMass)
+			continue;
+
+		MassScales[BodyIndex] = TargetMass / Masses[BodyIndex];
+		Masses[BodyIndex] = TargetMass;
+		FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, BodyIndex);
+		FBodyInstance& Body = PhysicsAsset->SkeletalBodySetups[BodyIndex]->DefaultInstance;
+		if(Body.bOverrideMass)
+			Body.SetMassOverride(TargetMass);
+		else
+			Body.SetMassScale(Body.MassScale * MassScales[BodyIndex]);
+		OutReport.NumBodiesRescaled++;
+		LGV("  %s -> %.3f kg", *BodyName.ToString(), TargetMass)
+	}
+
+	if(Options.bRederiveDriveStrengths)
+	{
+		for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+		{
+			UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[i];
+			const int32 BodyIndex = Template ? PhysicsAsset->FindBodyIndex(Template->DefaultInstance.ConstraintBone1) : INDEX_NONE;
+			if(BodyIndex == INDEX_NONE || MassScales[BodyIndex] == 1.f)
+				continue;
+			// Drive strengths are mass * multiplier, damping strength * ratio
+			FConstraintProfilePreset Scale;
+			Scale.LinearStrengthScale = Scale.AngularStrengthScale = MassScales[BodyIndex];
+			FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, i);
+			Template->DefaultInstance.ProfileInstance = UPhysicsEditorBPLibrary::MakeProfileProperties(Template->DefaultInstance.ProfileInstance, Scale);
+			for(FPhysicsConstraintProfileHandle& Handle : GetProfileHandles(Template))
+				Handle.ProfileProperties = UPhysicsEditorBPLibrary::MakeProfileProperties(Handle.ProfileProperties, Scale);
+			OutReport.NumConstraintsRescaled++;
+		}
+	}
+	LG("Mass hierarchy: %d inversions, %d bodies rescaled, %d constraints rescaled", OutReport.InvertedBodies.Num(),
+	   OutReport.NumBodiesRescaled, OutReport.NumConstraintsRescaled)
+
+	if(OutReport.NumBodiesRescaled > 0)
+	{
+		PhysicsAsset->UpdateBoundsBodiesArray();
+		PhysicsAsset->MarkPackageDirty();
+		PhysicsAsset->RefreshPhysicsAssetChange();
+	}
+	return true;
+}
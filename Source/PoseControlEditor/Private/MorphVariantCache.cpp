@@ -0,0 +1,306 @@
+﻿#include "MorphVariantCache.h"
+
+#include "AnimationRuntime.h"
+#include "CustomLogging.h"
+#include "Editor.h"
+#include "Animation/AnimBlueprint.h"
+#include "Animation/MorphTarget.h"
+#include "Animation/PcAnimInstance.h"
+#include "Async/ParallelFor.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "DataAssets/PcActorDataAsset.h"
+#include "Engine/SkeletalMesh.h"
+#include "Misc/SecureHash.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "Subsystems/UnrealEditorSubsystem.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+/** A variant holds every LOD0 vertex twice, so only the most recently used ones are kept */
+static constexpr int32 MaxCachedVariants = 16;
+
+static TMap<FString, TSharedPtr<const FMorphVariant>> Variants;
+/** Keys of Variants, least recently used first */
+static TArray<FString> VariantOrder;
+static int32 NumLookups = 0;
+static int32 NumHits = 0;
+
+static void HashFloatMap(FSHA1& Sha, const TMap<FName, float>& Map)
+{
+	TArray<TPair<FName, float>> Entries = Map.Array();
+	Entries.Sort([](const TPair<FName, float>& A, const TPair<FName, float>& B) { return A.Key.LexicalLess(B.Key); });
+	for(const TPair<FName, float>& Entry : Entries)
+	{
+		const FString Name = Entry.Key.ToString();
+		Sha.UpdateWithString(*Name, Name.Len());
+		Sha.Update(reinterpret_cast<const uint8*>(&Entry.Value), sizeof(float));
+	}
+}
+
+FString MorphVariantCache::MakeKey(const UPcActorDataAsset* DataAsset)
+{
+	if(!DataAsset)
+		return FString();
+	FSHA1 Sha;
+	const USkeletalMesh* SourceMesh = DataAsset->GetSourceSkeletalMesh();
+	// The model id changes whenever the mesh is reimported or edited
+	const FString MeshId = SourceMesh && SourceMesh->GetImportedModel()
+		? SourceMesh->GetPathName() + SourceMesh->GetImportedModel()->GetIdString() : FString();
+	Sha.UpdateWithString(*MeshId, MeshId.Len());
+	const FString AnimBlueprint = DataAsset->AnimBlueprintRef ? DataAsset->AnimBlueprintRef->GetPathName() : FString();
+	Sha.UpdateWithString(*AnimBlueprint, AnimBlueprint.Len());
+	HashFloatMap(Sha, DataAsset->CurveMap);
+	HashFloatMap(Sha, DataAsset->MorphTargetMap);
+	Sha.Final();
+	uint8 Digest[FSHA1::DigestSize];
+	Sha.GetHash(Digest);
+	return BytesToHex(Digest, FSHA1::DigestSize);
+}
+
+/** Bone space pose and morph target weights after one update of the data asset's AnimBlueprint, or of the maps alone without one */
+static bool EvaluatePose(UPcActorDataAsset* DataAsset, USkeletalMesh* SourceMesh, TArray<FTransform>& OutRefPose,
+                         TMap<FName, float>& OutMorphWeights)
+{
+	OutRefPose = SourceMesh->GetRefSkeleton().GetRefBonePose();
+	// Curves named after a morph target drive it, like they do on a component
+	for(const TPair<FName, float>& Curve : DataAsset->CurveMap)
+	{
+		if(SourceMesh->FindMorphTarget(Curve.Key))
+			OutMorphWeights.Add(Curve.Key, Curve.Value);
+	}
+	if(!DataAsset->AnimBlueprintRef)
+	{
+		OutMorphWeights.Append(DataAsset->MorphTargetMap);
+		return true;
+	}
+
+	UUnrealEditorSubsystem* UnrealEditorSubsystem = GEditor ? GEditor->GetEditorSubsystem<UUnrealEditorSubsystem>() : nullptr;
+	UWorld* World = UnrealEditorSubsystem ? UnrealEditorSubsystem->GetEditorWorld() : nullptr;
+	if(!World) {
+		LGE("No editor world to evaluate the AnimBlueprint in.")
+		return false; }
+
+	// Registered for the anim instance, but never ticked or rendered
+	USkeletalMeshComponent* SkelMeshComp = NewObject<USkeletalMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+	SkelMeshComp->SetSkeletalMesh(SourceMesh);
+	SkelMeshComp->SetUpdateAnimationInEditor(true);
+	SkelMeshComp->SetDisablePostProcessBlueprint(true);
+	SkelMeshComp->SetAnimInstanceClass(DataAsset->AnimBlueprintRef->GetAnimBlueprintGeneratedClass());
+	SkelMeshComp->RegisterComponentWithWorld(World);
+
+	bool bEvaluated = false;
+	if(UAnimInstance* AnimInstance = SkelMeshComp->GetAnimInstance())
+	{
+		if(UPcAnimInstance* PcAnimInstance = Cast<UPcAnimInstance>(AnimInstance))
+		{
+			PcAnimInstance->CurveMap = DataAsset->CurveMap;
+			PcAnimInstance->MorphTargetMap = DataAsset->MorphTargetMap;
+		}
+		AnimInstance->RefreshCurves(SkelMeshComp);
+		AnimInstance->UpdateAnimation(.1f, false);
+		SkelMeshComp->TickAnimation(.2f, false);
+		// Without a tick function the bones are evaluated right here on the game thread
+		SkelMeshComp->RefreshBoneTransforms();
+		if(SkelMeshComp->GetBoneSpaceTransforms().Num() == OutRefPose.Num())
+		{
+			OutRefPose = SkelMeshComp->GetBoneSpaceTransforms();
+			OutMorphWeights.Append(SkelMeshComp->GetMorphTargetCurves());
+			bEvaluated = true;
+		}
+	}
+	SkelMeshComp->DestroyComponent();
+	if(!bEvaluated) {
+		LGE("AnimBlueprint %s not evaluated on %s.", *DataAsset->AnimBlueprintRef->GetName(), *SourceMesh->GetName())
+		return false; }
+	OutMorphWeights.Append(DataAsset->MorphTargetMap);
+	return true;
+}
+
+/** Applies the morph deltas to LOD0, skins it to Variant.RefPose and collects the vertices of each dominant bone */
+static bool SkinVariant(const USkeletalMesh* SourceMesh, const TMap<FName, float>& MorphWeights, FMorphVariant& Variant)
+{
+	const FSkeletalMeshModel* Model = SourceMesh->GetImportedModel();
+	if(!Model || Model->LODModels.IsEmpty()) {
+		LGE("%s has no imported model to morph.", *SourceMesh->GetName())
+		return false; }
+	const FSkeletalMeshLODModel& LODModel = Model->LODModels[0];
+	const FReferenceSkeleton& RefSkeleton = SourceMesh->GetRefSkeleton();
+
+	// Section vertices are laid out back to back, which is also what the morph deltas index
+	TArray<const FSoftSkinVertex*> Vertices;
+	TArray<const FSkelMeshSection*> VertexSections;
+	Vertices.Reserve(LODModel.NumVertices);
+	VertexSections.Reserve(LODModel.NumVertices);
+	for(const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for(const FSoftSkinVertex& Vertex : Section.SoftVertices)
+		{
+			Vertices.Add(&Vertex);
+			VertexSections.Add(&Section);
+		}
+	}
+
+	TArray<FVector3f> Positions, Normals;
+	Positions.SetNumUninitialized(Vertices.Num());
+	Normals.SetNumUninitialized(Vertices.Num());
+	for(int32 i = 0; i < Vertices.Num(); i++)
+	{
+		Positions[i] = Vertices[i]->Position;
+		Normals[i] = FVector3f(Vertices[i]->TangentZ);
+	}
+	for(const TPair<FName, float>& Weight : MorphWeights)
+	{
+		const UMorphTarget* MorphTarget = FMath::IsNearlyZero(Weight.Value) ? nullptr : SourceMesh->FindMorphTarget(Weight.Key);
+		if(!MorphTarget)
+			continue;
+		int32 NumDeltas = 0;
+		const FMorphTargetDelta* Deltas = MorphTarget->GetMorphTargetDelta(0, NumDeltas);
+		for(int32 i = 0; i < NumDeltas; i++)
+		{
+			if(!Positions.IsValidIndex(Deltas[i].SourceIdx))
+				continue;
+			Positions[Deltas[i].SourceIdx] += Deltas[i].PositionDelta * Weight.Value;
+			Normals[Deltas[i].SourceIdx] += Deltas[i].TangentZDelta * Weight.Value;
+		}
+	}
+
+	TArray<FTransform> RefComponentSpace;
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, RefSkeleton.GetRefBonePose(), RefComponentSpace);
+	FAnimationRuntime::FillUpComponentSpaceTransforms(RefSkeleton, Variant.RefPose, Variant.ComponentSpace);
+	// Matrices rather than transforms, so non uniform bone scale skins like it does on the GPU
+	TArray<FMatrix44f> SkinMatrices, RefInverses, BoneInverses;
+	SkinMatrices.SetNumUninitialized(RefComponentSpace.Num());
+	RefInverses.SetNumUninitialized(RefComponentSpace.Num());
+	BoneInverses.SetNumUninitialized(RefComponentSpace.Num());
+	for(int32 b = 0; b < RefComponentSpace.Num(); b++)
+	{
+		const FMatrix RefInverse = RefComponentSpace[b].ToMatrixWithScale().Inverse();
+		RefInverses[b] = FMatrix44f(RefInverse);
+		SkinMatrices[b] = FMatrix44f(RefInverse * Variant.ComponentSpace[b].ToMatrixWithScale());
+		BoneInverses[b] = FMatrix44f(Variant.ComponentSpace[b].ToMatrixWithScale().Inverse());
+	}
+
+	TArray<int32> DominantBones;
+	DominantBones.SetNumUninitialized(Vertices.Num());
+	Variant.SkinVertices.SetNumUninitialized(Vertices.Num());
+	ParallelFor(Vertices.Num(), [&](int32 i)
+	{
+		const FSoftSkinVertex& Vertex = *Vertices[i];
+		const FSkelMeshSection& Section = *VertexSections[i];
+		FVector3f Skinned = FVector3f::ZeroVector;
+		float TotalWeight = 0.f;
+		float DominantWeight = 0.f;
+		DominantBones[i] = INDEX_NONE;
+		for(int32 j = 0; j < Section.MaxBoneInfluences; j++)
+		{
+			const float InfluenceWeight = float(Vertex.InfluenceWeights[j]);
+			if(InfluenceWeight <= 0.f || !Section.BoneMap.IsValidIndex(Vertex.InfluenceBones[j]))
+				continue;
+			const int32 BoneIndex = Section.BoneMap[Vertex.InfluenceBones[j]];
+			if(!SkinMatrices.IsValidIndex(BoneIndex))
+				continue;
+			Skinned += SkinMatrices[BoneIndex].TransformPosition(Positions[i]) * InfluenceWeight;
+			TotalWeight += InfluenceWeight;
+			if(InfluenceWeight > DominantWeight)
+			{
+				DominantWeight = InfluenceWeight;
+				DominantBones[i] = BoneIndex;
+			}
+		}
+		// Weights are normalized here, whatever their stored precision
+		Variant.SkinVertices[i] = TotalWeight > 0.f ? Skinned / TotalWeight : Positions[i];
+	});
+
+	Variant.Infos.SetNum(RefSkeleton.GetRawBoneNum());
+	for(int32 i = 0; i < Vertices.Num(); i++)
+	{
+		const int32 BoneIndex = DominantBones[i];
+		if(!Variant.Infos.IsValidIndex(BoneIndex))
+			continue;
+		FBoneVertInfo& Info = Variant.Infos[BoneIndex];
+		Info.Positions.Add(BoneInverses[BoneIndex].TransformPosition(Variant.SkinVertices[i]));
+		// Morphed normals follow the dominant bone rigidly, which leaves them in its reference space
+		Info.Normals.Add(RefInverses[BoneIndex].TransformVector(Normals[i]).GetSafeNormal());
+	}
+	return true;
+}
+
+TSharedPtr<const FMorphVariant> MorphVariantCache::FindOrEvaluate(UPcActorDataAsset* DataAsset)
+{
+	if(!DataAsset) {
+		LGE("No Data Asset found. Aborting.")
+		return nullptr; }
+	USkeletalMesh* SourceMesh = DataAsset->GetSourceSkeletalMesh();
+	if(!SourceMesh) {
+		LGE("No source skeletal mesh on %s to evaluate the morph variant of.", *DataAsset->GetName())
+		return nullptr; }
+
+	const FString Key = MakeKey(DataAsset);
+	NumLookups++;
+	if(const TSharedPtr<const FMorphVariant>* Cached = Variants.Find(Key))
+	{
+		NumHits++;
+		VariantOrder.Remove(Key);
+		VariantOrder.Add(Key);
+		LGV("Morph variant %s of %s: cached", *Key, *SourceMesh->GetName())
+		return *Cached;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	TSharedPtr<FMorphVariant> Variant = MakeShared<FMorphVariant>();
+	Variant->Key = Key;
+	TMap<FName, float> MorphWeights;
+	if(!EvaluatePose(DataAsset, SourceMesh, Variant->RefPose, MorphWeights) || !SkinVariant(SourceMesh, MorphWeights, *Variant))
+		return nullptr;
+	LG("Morph variant %s of %s: %d morph targets, %d vertices in %.2fs", *Key, *SourceMesh->GetName(), MorphWeights.Num(),
+	   Variant->SkinVertices.Num(), FPlatformTime::Seconds() - StartTime)
+
+	if(VariantOrder.Num() >= MaxCachedVariants)
+	{
+		Variants.Remove(VariantOrder[0]);
+		VariantOrder.RemoveAt(0);
+	}
+	Variants.Add(Key, Variant);
+	VariantOrder.Add(Key);
+	return Variant;
+}
+
+bool MorphVariantCache::Apply(UPcActorDataAsset* DataAsset)
+{
+	const TSharedPtr<const FMorphVariant> Variant = FindOrEvaluate(DataAsset);
+	if(!Variant)
+		return false;
+	const FReferenceSkeleton& RefSkeleton = DataAsset->GetSourceSkeletalMesh()->GetRefSkeleton();
+	DataAsset->RefPoseTransforms.Reset();
+	for(int32 i = 0; i < RefSkeleton.GetNum() && i < Variant->RefPose.Num(); i++)
+		DataAsset->RefPoseTransforms.Add(RefSkeleton.GetBoneName(i), Variant->RefPose[i]);
+	DataAsset->MorphVariantKey = Variant->Key;
+	DataAsset->MarkPackageDirty();
+	return true;
+}
+
+bool MorphVariantCache::IsApplied(const UPcActorDataAsset* DataAsset)
+{
+	return DataAsset && DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache && !DataAsset->RefPoseTransforms.IsEmpty()
+		&& !DataAsset->MorphVariantKey.IsEmpty() && DataAsset->MorphVariantKey == MakeKey(DataAsset);
+}
+
+int32 MorphVariantCache::GetNumLookups()
+{
+	return NumLookups;
+}
+
+int32 MorphVariantCache::GetNumHits()
+{
+	return NumHits;
+}
+
+void MorphVariantCache::Reset()
+{
+	Variants.Empty();
+	VariantOrder.Empty();
+	NumLookups = 0;
+	NumHits = 0;
+}
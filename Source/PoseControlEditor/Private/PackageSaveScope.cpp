@@ -0,0 +1,68 @@
+﻿#include "PackageSaveScope.h"
+
+#include "CustomLogging.h"
+#include "FileHelpers.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+int32 FScopedPackageSave::Depth = 0;
+TArray<TWeakObjectPtr<UPackage>> FScopedPackageSave::PendingPackages;
+TSet<TWeakObjectPtr<UPackage>> FScopedPackageSave::ForcedPackages;
+
+void FScopedPackageSave::Enter()
+{
+	check(IsInGameThread());
+	Depth++;
+}
+
+bool FScopedPackageSave::Leave()
+{
+	if(Depth == 0)
+	{
+		LGW("Package save scope closed without being opened")
+		return false;
+	}
+	return --Depth == 0 ? Flush() : true;
+}
+
+bool FScopedPackageSave::RequestSave(UObject* Asset, bool bForce)
+{
+	return RequestSave(TArray<UObject*>{Asset}, bForce);
+}
+
+bool FScopedPackageSave::RequestSave(const TArray<UObject*>& Assets, bool bForce)
+{
+	for(const UObject* Asset : Assets)
+	{
+		UPackage* Package = Asset ? Asset->GetPackage() : nullptr;
+		if(!Package)
+			continue;
+		PendingPackages.AddUnique(Package);
+		if(bForce)
+			ForcedPackages.Add(Package);
+	}
+	return Depth > 0 ? true : Flush();
+}
+
+bool FScopedPackageSave::Flush()
+{
+	TArray<UPackage*> Packages;
+	Packages.Reserve(PendingPackages.Num());
+	for(const TWeakObjectPtr<UPackage>& Package : PendingPackages)
+	{
+		if(Package.IsValid() && (Package->IsDirty() || ForcedPackages.Contains(Package)))
+			Packages.Add(Package.Get());
+	}
+	const int32 NumRequested = PendingPackages.Num();
+	PendingPackages.Reset();
+	ForcedPackages.Reset();
+	if(Packages.IsEmpty())
+		return true;
+
+	LG("Saving %d packages (%d requested)", Packages.Num(), NumRequested)
+	const bool bSuccess = UEditorLoadingAndSavingUtils::SavePackages(Packages, false);
+	if(!bSuccess)
+		LGE("Saving %d packages failed", Packages.Num())
+	return bSuccess;
+}
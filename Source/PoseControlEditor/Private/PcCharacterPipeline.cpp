@@ -0,0 +1,531 @@
+﻿#include "PcCharacterPipeline.h"
+
+#include "CustomLogging.h"
+#include "MorphVariantCache.h"
+#include "PackageSaveScope.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "DataAssets/PcActorDataAsset.h"
+#include "Engine/DataTable.h"
+#include "Misc/SecureHash.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Rendering/SkeletalMeshModel.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+static constexpr int32 NumPipelineStages = int32(EPcPipelineStage::AddConstraints) + 1;
+/** Longest wait for the preload or the bake callback before the pipeline gives up */
+static constexpr float WaitTimeoutSeconds = 600.f;
+
+static FName GetStageName(EPcPipelineStage Stage)
+{
+	return FName(StaticEnum<EPcPipelineStage>()->GetNameStringByValue(int64(Stage)));
+}
+
+static TMap<FSoftObjectPath, TArray<FPcPipelineStageResult>> LastResults;
+
+/** Data assets with a pipeline in flight, a second Start on one of them is rejected */
+static TSet<FSoftObjectPath> RunningDataAssets;
+
+static TArray<FPcPipelineStageStats>& GetMutableSessionStats()
+{
+	static TArray<FPcPipelineStageStats> Stats;
+	if(Stats.IsEmpty())
+	{
+		Stats.SetNum(NumPipelineStages);
+		for(int32 i = 0; i < NumPipelineStages; i++)
+			Stats[i].Stage = EPcPipelineStage(i);
+	}
+	return Stats;
+}
+
+static void HashString(FSHA1& Sha, const FString& Value)
+{
+	Sha.UpdateWithString(*Value, Value.Len());
+}
+
+template<typename T>
+static void HashValue(FSHA1& Sha, const T& Value)
+{
+	Sha.Update(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+}
+
+template<typename StructType>
+static void HashStruct(FSHA1& Sha, const StructType& Value)
+{
+	FString Text;
+	StructType::StaticStruct()->ExportText(Text, &Value, nullptr, nullptr, PPF_None, nullptr);
+	HashString(Sha, Text);
+}
+
+static void HashNames(FSHA1& Sha, const TArray<FName>& Names)
+{
+	for(const FName& Name : Names)
+		HashString(Sha, Name.ToString());
+}
+
+static void HashFloatMap(FSHA1& Sha, const TMap<FName, float>& Map)
+{
+	TArray<TPair<FName, float>> Entries = Map.Array();
+	Entries.Sort([](const TPair<FName, float>& A, const TPair<FName, float>& B) { return A.Key.LexicalLess(B.Key); });
+	for(const TPair<FName, float>& Entry : Entries)
+	{
+		HashString(Sha, Entry.Key.ToString());
+		HashValue(Sha, Entry.Value);
+	}
+}
+
+static FString FinishHash(FSHA1& Sha)
+{
+	Sha.Final();
+	uint8 Digest[FSHA1::DigestSize];
+	Sha.GetHash(Digest);
+	return BytesToHex(Digest, FSHA1::DigestSize);
+}
+
+/** Bodies with their shapes and instance settings, and constraints with their profiles */
+static void HashPhysicsAsset(FSHA1& Sha, const UPhysicsAsset* PhysicsAsset)
+{
+	if(!PhysicsAsset)
+		return;
+	HashString(Sha, PhysicsAsset->GetPathName());
+	for(const USkeletalBodySetup* Body : PhysicsAsset->SkeletalBodySetups)
+	{
+		if(!Body)
+			continue;
+		HashString(Sha, Body->BoneName.ToString());
+		HashValue(Sha, Body->PhysicsType);
+		HashStruct(Sha, Body->AggGeom);
+		HashStruct(Sha, Body->DefaultInstance);
+	}
+	for(const UPhysicsConstraintTemplate* Constraint : PhysicsAsset->ConstraintSetup)
+	{
+		if(Constraint)
+			HashStruct(Sha, Constraint->DefaultInstance);
+	}
+}
+
+static void HashDataTable(FSHA1& Sha, const UDataTable* DataTable)
+{
+	if(DataTable)
+		HashString(Sha, DataTable->GetTableAsJSON());
+}
+
+/** Reference skeleton and LOD0 vertex positions */
+static void HashSkeletalMesh(FSHA1& Sha, USkeletalMesh* SkeletalMesh)
+{
+	if(!SkeletalMesh)
+		return;
+	HashString(Sha, SkeletalMesh->GetPathName());
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	for(int32 i = 0; i < RefSkeleton.GetRawBoneNum(); i++)
+	{
+		HashString(Sha, RefSkeleton.GetRawRefBoneInfo()[i].Name.ToString());
+		const FTransform& Pose = RefSkeleton.GetRawRefBonePose()[i];
+		HashValue(Sha, Pose.GetLocation());
+		HashValue(Sha, Pose.GetRotation());
+		HashValue(Sha, Pose.GetScale3D());
+	}
+	const FSkeletalMeshModel* Model = SkeletalMesh->GetImportedModel();
+	if(Model && Model->LODModels.Num() > 0)
+	{
+		for(const FSkelMeshSection& Section : Model->LODModels[0].Sections)
+		{
+			for(const FSoftSkinVertex& Vertex : Section.SoftVertices)
+				HashValue(Sha, Vertex.Position);
+		}
+	}
+}
+
+static void CountOutputs(UPcActorDataAsset* DataAsset, FPcPipelineStageResult& Result)
+{
+	if(const UPhysicsAsset* PhysicsAsset = DataAsset->GetTargetPhysicsAsset())
+	{
+		Result.NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+		Result.NumConstraints = PhysicsAsset->ConstraintSetup.Num();
+	}
+}
+
+UPcCharacterPipeline* UPcCharacterPipeline::RunCharacterPipeline(UPcActorDataAsset* DataAsset, FMeshBakeOptions Options)
+{
+	return Start(DataAsset, Options, 0, NumPipelineStages);
+}
+
+UPcCharacterPipeline* UPcCharacterPipeline::RunCharacterPipelineStage(UPcActorDataAsset* DataAsset, FMeshBakeOptions Options, EPcPipelineStage Stage)
+{
+	Options.bForceRebuild = true;
+	return Start(DataAsset, Options, int32(Stage), int32(Stage) + 1);
+}
+
+const TArray<FPcPipelineStageResult>* UPcCharacterPipeline::GetLastResults(const UPcActorDataAsset* DataAsset)
+{
+	return DataAsset ? LastResults.Find(FSoftObjectPath(DataAsset)) : nullptr;
+}
+
+const TArray<FPcPipelineStageStats>& UPcCharacterPipeline::GetSessionStats()
+{
+	return GetMutableSessionStats();
+}
+
+FOnPcAnyPipelineFinished& UPcCharacterPipeline::OnAnyPipelineFinished()
+{
+	static FOnPcAnyPipelineFinished Delegate;
+	return Delegate;
+}
+
+UPcCharacterPipeline* UPcCharacterPipeline::Start(UPcActorDataAsset* DataAsset, const FMeshBakeOptions& Options, int32 FirstStage, int32 EndStage)
+{
+	if(!DataAsset) {
+		LGE("No Data Asset found. Aborting.")
+		return nullptr; }
+	if(RunningDataAssets.Contains(FSoftObjectPath(DataAsset))) {
+		LGE("A character pipeline is already running for %s. Aborting.", *DataAsset->GetName())
+		return nullptr; }
+	
+	UPcCharacterPipeline* Pipeline = NewObject<UPcCharacterPipeline>();
+	Pipeline->DataAsset = DataAsset;
+	Pipeline->Options = Options;
+	Pipeline->NextStage = FirstStage;
+	Pipeline->EndStage = EndStage;
+	Pipeline->bSingleStage = EndStage - FirstStage == 1;
+	Pipeline->bRunning = true;
+	// Chain on the hash the last enabled stage before this one was recorded with, like a full run would
+	for(int32 i = FirstStage - 1; i >= 0; i--)
+	{
+		if(!Pipeline->IsStageEnabled(EPcPipelineStage(i)))
+			continue;
+		if(const FPcPipelineStageRecord* Record = DataAsset->PipelineStageRecords.Find(GetStageName(EPcPipelineStage(i))))
+			Pipeline->PreviousHash = Record->InputHash;
+		break;
+	}
+	// Kept alive across the bake timer, released in Finish
+	Pipeline->AddToRoot();
+	RunningDataAssets.Add(FSoftObjectPath(DataAsset));
+	Pipeline->ArmWaitTimeout();
+	// The stages start once every reference is loaded, the handle keeps them resident until Finish
+	DataAsset->PreloadReferences(FStreamableDelegate::CreateUObject(Pipeline, &UPcCharacterPipeline::RunNextStages));
+	return Pipeline;
+}
+
+bool UPcCharacterPipeline::IsStageEnabled(EPcPipelineStage Stage) const
+{
+	switch(Stage)
+	{
+	case EPcPipelineStage::CopyPhysicsAsset:
+		return true;
+	case EPcPipelineStage::BakeMorphedMesh:
+		// A variant without an AnimBlueprint only applies the morph targets
+		return Options.bBakeMorphedMesh && !DataAsset->SourceSkeletalMesh.IsNull()
+			&& (DataAsset->AnimBlueprintRef || DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache);
+	case EPcPipelineStage::CreateBodies:
+		return Options.bGeneratePhysicsBodies;
+	case EPcPipelineStage::CopyTwistShapes:
+		return Options.bCopyTwistBones;
+	case EPcPipelineStage::AlignCapsules:
+		return Options.bAlignCapsulesToBones;
+	case EPcPipelineStage::FixConstraintScale:
+		return Options.bFixConstraintScale;
+	case EPcPipelineStage::AddConstraints:
+		return Options.bAddConstraints;
+	default:
+		return false;
+	}
+}
+
+void UPcCharacterPipeline::HashStageInputs(EPcPipelineStage Stage, FSHA1& Sha) const
+{
+	switch(Stage)
+	{
+	case EPcPipelineStage::CopyPhysicsAsset:
+		HashPhysicsAsset(Sha, DataAsset->GetSourcePhysicsAsset());
+		HashString(Sha, DataAsset->NewAssetPath);
+		HashString(Sha, DataAsset->CharacterName.ToString());
+		break;
+	case EPcPipelineStage::BakeMorphedMesh:
+		HashSkeletalMesh(Sha, DataAsset->GetSourceSkeletalMesh());
+		HashFloatMap(Sha, DataAsset->CurveMap);
+		HashFloatMap(Sha, DataAsset->MorphTargetMap);
+		HashString(Sha, DataAsset->AnimBlueprintRef ? DataAsset->AnimBlueprintRef->GetPathName() : FString());
+		HashValue(Sha, DataAsset->MorphVariantMode);
+		break;
+	case EPcPipelineStage::CreateBodies:
+		HashDataTable(Sha, DataAsset->GetBodyParamsDataTable());
+		if(DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+			HashString(Sha, MorphVariantCache::MakeKey(DataAsset));
+		else
+			HashSkeletalMesh(Sha, DataAsset->GetTargetSkeletalMesh());
+		break;
+	case EPcPipelineStage::CopyTwistShapes:
+		HashNames(Sha, DataAsset->TwistNames);
+		HashValue(Sha, Options.bDeleteTwistBones);
+		break;
+	case EPcPipelineStage::AlignCapsules:
+		HashNames(Sha, DataAsset->CapsuleNames);
+		break;
+	case EPcPipelineStage::FixConstraintScale:
+		break;
+	case EPcPipelineStage::AddConstraints:
+		HashStruct(Sha, DataAsset->PhatConstraintOptions);
+		if(DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+			HashString(Sha, MorphVariantCache::MakeKey(DataAsset));
+		break;
+	default:
+		break;
+	}
+}
+
+FString UPcCharacterPipeline::HashStageOutput(EPcPipelineStage Stage) const
+{
+	FSHA1 Sha;
+	if(Stage == EPcPipelineStage::BakeMorphedMesh)
+		HashSkeletalMesh(Sha, DataAsset->GetTargetSkeletalMesh());
+	else
+		HashPhysicsAsset(Sha, DataAsset->GetTargetPhysicsAsset());
+	return FinishHash(Sha);
+}
+
+bool UPcCharacterPipeline::HasStageOutput(EPcPipelineStage Stage, const FPcPipelineStageRecord& Record) const
+{
+	if(Stage == EPcPipelineStage::BakeMorphedMesh && DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+		return MorphVariantCache::IsApplied(DataAsset);
+	if(Stage == EPcPipelineStage::BakeMorphedMesh && (Options.bOverwriteSkeletalMeshAsset || !DataAsset->GetTargetSkeletalMesh()))
+		return false;
+	if(Stage != EPcPipelineStage::BakeMorphedMesh && !DataAsset->GetTargetPhysicsAsset())
+		return false;
+	// Edited or replaced since the pipeline last wrote it
+	return Record.OutputHash == HashStageOutput(Stage);
+}
+
+bool UPcCharacterPipeline::RunStage(EPcPipelineStage Stage)
+{
+	switch(Stage)
+	{
+	case EPcPipelineStage::CopyPhysicsAsset:
+		// An existing target is fine unless the copy was forced
+		return UPhysicsAssetTools::CopyPhysicsAsset(DataAsset, Options.bOverwritePhysicsAsset) || DataAsset->GetTargetPhysicsAsset();
+	case EPcPipelineStage::BakeMorphedMesh:
+		if(DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+			return MorphVariantCache::Apply(DataAsset);
+		BakeHelper = UPhysicsAssetTools::StartBakeMorphedMesh(DataAsset, FOnMorphedMeshBaked::CreateUObject(this, &UPcCharacterPipeline::ResumeAfterStage));
+		bWaiting = BakeHelper != nullptr;
+		return bWaiting;
+	case EPcPipelineStage::CreateBodies:
+		return UPhysicsAssetTools::CreateBodiesFromDataTable(DataAsset);
+	case EPcPipelineStage::CopyTwistShapes:
+		return UPhysicsAssetTools::CopyTwistShapesToParents(DataAsset, Options.bDeleteTwistBones);
+	case EPcPipelineStage::AlignCapsules:
+		return UPhysicsAssetTools::AlignCapsulesToBones(DataAsset);
+	case EPcPipelineStage::FixConstraintScale:
+		return UPhysicsEditorBPLibrary::FixConstraintScale(DataAsset->GetTargetPhysicsAsset());
+	case EPcPipelineStage::AddConstraints:
+	{
+		FConstraintGraphReport GraphReport;
+		if(DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+		{
+			// Without a variant nothing is added, and a success would record the stage as done
+			if(!MorphVariantCache::IsApplied(DataAsset)) {
+				LGE("Morph variant of %s isn't applied, run BakeMorphedMesh first", *DataAsset->GetName())
+				return false; }
+			const TArray<int32> ConstraintIndexes = UPhysicsEditorBPLibrary::AddPhatConstraintsFromMorphVariant(DataAsset, GraphReport);
+			LG("Pipeline added or modified %d constraints on the morph variant", ConstraintIndexes.Num())
+			return DataAsset->GetTargetPhysicsAsset() && DataAsset->GetSourceSkeletalMesh();
+		}
+		const TArray<int32> ConstraintIndexes = UPhysicsEditorBPLibrary::AddPhatConstraintsFromRefPose(DataAsset->GetTargetPhysicsAsset(),
+			DataAsset->GetTargetSkeletalMesh(), DataAsset->PhatConstraintOptions, GraphReport);
+		LG("Pipeline added or modified %d constraints", ConstraintIndexes.Num())
+		return DataAsset->GetTargetPhysicsAsset() && DataAsset->GetTargetSkeletalMesh();
+	}
+	default:
+		return false;
+	}
+}
+
+void UPcCharacterPipeline::RunNextStages()
+{
+	if(!bRunning)
+		return;
+	ClearWaitTimeout();
+	while(NextStage < EndStage)
+	{
+		const EPcPipelineStage Stage = EPcPipelineStage(NextStage);
+		if(!IsStageEnabled(Stage))
+		{
+			NextStage++;
+			continue;
+		}
+		
+		const FName StageName = GetStageName(Stage);
+		FSHA1 Sha;
+		HashString(Sha, PreviousHash);
+		HashString(Sha, StageName.ToString());
+		HashStageInputs(Stage, Sha);
+		CurrentHash = FinishHash(Sha);
+
+		FPcPipelineStageResult& Result = Results.AddDefaulted_GetRef();
+		Result.Stage = Stage;
+		Result.InputHash = CurrentHash;
+		
+		FPcPipelineStageStats& Stats = GetMutableSessionStats()[NextStage];
+		Stats.NumLookups++;
+		const FPcPipelineStageRecord* Record = DataAsset->PipelineStageRecords.Find(StageName);
+		if(!Options.bForceRebuild && !bUpstreamRan && Record && Record->InputHash == CurrentHash && HasStageOutput(Stage, *Record))
+		{
+			LG("Pipeline stage %s: inputs unchanged, skipping", *StageName.ToString())
+			Stats.NumHits++;
+			Result.bSkipped = true;
+			Result.bSuccess = true;
+			CountOutputs(DataAsset, Result);
+			PreviousHash = CurrentHash;
+			NextStage++;
+			continue;
+		}
+
+		LG("Pipeline stage %s: running", *StageName.ToString())
+		Stats.NumRuns++;
+		StageStartTime = FPlatformTime::Seconds();
+		bWaiting = false;
+		bool bSuccess;
+		{
+			// Saves requested by the stage are written once it returns
+			FScopedPackageSave SaveScope;
+			bSuccess = RunStage(Stage);
+		}
+		if(bSuccess && bWaiting) {
+			ArmWaitTimeout();
+			return; }
+		FinishStage(bSuccess);
+		if(!bSuccess)
+			return;
+	}
+	Finish(true);
+}
+
+void UPcCharacterPipeline::ResumeAfterStage(bool bSuccess)
+{
+	if(!bRunning || !bWaiting)
+		return;
+	ClearWaitTimeout();
+	bWaiting = false;
+	BakeHelper = nullptr;
+	FinishStage(bSuccess);
+	if(bSuccess)
+		RunNextStages();
+}
+
+void UPcCharacterPipeline::FinishStage(bool bSuccess)
+{
+	FPcPipelineStageResult& Result = Results.Last();
+	Result.bSuccess = bSuccess;
+	Result.Seconds = float(FPlatformTime::Seconds() - StageStartTime);
+	CountOutputs(DataAsset, Result);
+	GetMutableSessionStats()[int32(Result.Stage)].TotalSeconds += Result.Seconds;
+	const FName StageName = GetStageName(Result.Stage);
+	if(!bSuccess)
+	{
+		LGE("Pipeline stage %s failed after %.2fs", *StageName.ToString(), Result.Seconds)
+		DataAsset->PipelineStageRecords.Remove(StageName);
+		DataAsset->MarkPackageDirty();
+		Finish(false);
+		return;
+	}
+	
+	LG("Pipeline stage %s done in %.2fs", *StageName.ToString(), Result.Seconds)
+	FPcPipelineStageRecord& Record = DataAsset->PipelineStageRecords.FindOrAdd(StageName);
+	Record.InputHash = CurrentHash;
+	Record.LastRun = FDateTime::UtcNow();
+	if(bSingleStage)
+	{
+		for(int32 i = NextStage + 1; i < NumPipelineStages; i++)
+			DataAsset->PipelineStageRecords.Remove(GetStageName(EPcPipelineStage(i)));
+	}
+	DataAsset->MarkPackageDirty();
+	bUpstreamRan = true;
+	PreviousHash = CurrentHash;
+	NextStage++;
+}
+
+void UPcCharacterPipeline::Finish(bool bSuccess)
+{
+	bRunning = false;
+	ClearWaitTimeout();
+	const int32 NumSkipped = Results.FilterByPredicate([](const FPcPipelineStageResult& R) { return R.bSkipped; }).Num();
+	LG("Character pipeline for %s %s: %d stages run, %d skipped", *DataAsset->GetName(), bSuccess ? TEXT("finished") : TEXT("failed"),
+	   Results.Num() - NumSkipped, NumSkipped)
+
+	TArray<FPcPipelineStageResult>& Last = LastResults.FindOrAdd(FSoftObjectPath(DataAsset.Get()));
+	if(bSingleStage)
+	{
+		for(const FPcPipelineStageResult& Result : Results)
+		{
+			Last.RemoveAll([&Result](const FPcPipelineStageResult& R) { return R.Stage == Result.Stage; });
+			Last.Add(Result);
+		}
+		Last.Sort([](const FPcPipelineStageResult& A, const FPcPipelineStageResult& B) { return A.Stage < B.Stage; });
+	}
+	else
+	{
+		Last = Results;
+	}
+
+	// What the stages left behind, later stages change the same assets so this is taken once at the end.
+	// A failed run keeps the old hashes so its partial output doesn't count as produced.
+	for(int32 i = 0; bSuccess && i < NumPipelineStages; i++)
+	{
+		if(FPcPipelineStageRecord* Record = DataAsset->PipelineStageRecords.Find(GetStageName(EPcPipelineStage(i))))
+			Record->OutputHash = HashStageOutput(EPcPipelineStage(i));
+	}
+	FScopedPackageSave::RequestSave(TArray<UObject*>{DataAsset->GetTargetPhysicsAsset(), DataAsset.Get()});
+	RunningDataAssets.Remove(FSoftObjectPath(DataAsset.Get()));
+	DataAsset->ReleasePreload();
+	RemoveFromRoot();
+	OnFinished.Broadcast(bSuccess);
+	OnAnyPipelineFinished().Broadcast(DataAsset, bSuccess);
+}
+
+void UPcCharacterPipeline::Cancel()
+{
+	if(!bRunning)
+		return;
+	LGW("Character pipeline for %s cancelled", *DataAsset->GetName())
+	if(bWaiting)
+	{
+		// The stage's late callback is ignored, and the bake helper is left to the GC
+		bWaiting = false;
+		BakeHelper = nullptr;
+		FinishStage(false);
+	}
+	else
+	{
+		Finish(false);
+	}
+}
+
+void UPcCharacterPipeline::ArmWaitTimeout()
+{
+	ClearWaitTimeout();
+	WaitTimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float DeltaTime)
+	{
+		WaitTimeoutHandle.Reset();
+		LGE("Character pipeline for %s got no callback in %.0fs", *DataAsset->GetName(), WaitTimeoutSeconds)
+		Cancel();
+		return false;
+	}), WaitTimeoutSeconds);
+}
+
+void UPcCharacterPipeline::ClearWaitTimeout()
+{
+	if(WaitTimeoutHandle.IsValid())
+		FTSTicker::GetCoreTicker().RemoveTicker(WaitTimeoutHandle);
+	WaitTimeoutHandle.Reset();
+}
+
+void UPcCharacterPipeline::BeginDestroy()
+{
+	ClearWaitTimeout();
+	if(bRunning && DataAsset)
+		RunningDataAssets.Remove(FSoftObjectPath(DataAsset.Get()));
+	Super::BeginDestroy();
+}
@@ -0,0 +1,202 @@
+﻿#include "PhysicsAssetCost.h"
+
+#include "ConstraintGraph.h"
+#include "CustomLogging.h"
+#include "Utils.h"
+#include "Internationalization/Regex.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+// Rough sizes of the Chaos state created per instance, measured on 5.4 and rounded up
+static constexpr int64 ParticleBytes = 1024;
+static constexpr int64 ShapeInstanceBytes = 256;
+static constexpr int64 JointBytes = 512;
+// Chaos keeps a phi value and a gradient per level set cell
+static constexpr int64 LevelSetCellBytes = sizeof(double) + sizeof(FVector);
+// Cooked convex: vertices plus roughly one plane and one half-edge record per vertex
+static constexpr int64 ConvexVertexBytes = sizeof(FVector3f) * 2 + sizeof(FPlane4f) + 16;
+// Hash entry of TMap<FRigidBodyIndexPair, bool>
+static constexpr int64 CollisionDisableEntryBytes = sizeof(FRigidBodyIndexPair) + sizeof(bool) + 16;
+
+static FName GetGroupName(FName BodyName, const TArray<FRegexPattern>& Patterns, const TArray<FString>& PatternStrings)
+{
+	const FString Name = BodyName.ToString();
+	for(int32 i = 0; i < Patterns.Num(); i++)
+	{
+		FRegexMatcher Matcher(Patterns[i], Name);
+		if(Matcher.FindNext())
+			return FName(PatternStrings[i]);
+	}
+	FString Group;
+	Group.Reserve(Name.Len());
+	for(int32 i = 0; i < Name.Len(); i++)
+	{
+		if(FChar::IsDigit(Name[i]))
+		{
+			Group.AppendChar(TEXT('#'));
+			while(i + 1 < Name.Len() && FChar::IsDigit(Name[i + 1]))
+				i++;
+		}
+		else
+			Group.AppendChar(Name[i]);
+	}
+	return FName(Group);
+}
+
+static TCHAR MotionChar(ELinearConstraintMotion Motion)
+{
+	return Motion == LCM_Free ? TEXT('F') : Motion == LCM_Limited ? TEXT('L') : TEXT('X');
+}
+
+static TCHAR MotionChar(EAngularConstraintMotion Motion)
+{
+	return Motion == ACM_Free ? TEXT('F') : Motion == ACM_Limited ? TEXT('L') : TEXT('X');
+}
+
+static FString GetConstraintConfig(const FConstraintInstance& Constraint)
+{
+	const FConstraintProfileProperties& Profile = Constraint.ProfileInstance;
+	const FLinearDriveConstraint& Linear = Profile.LinearDrive;
+	const FAngularDriveConstraint& Angular = Profile.AngularDrive;
+	const bool bPosition = Linear.XDrive.bEnablePositionDrive || Linear.YDrive.bEnablePositionDrive || Linear.ZDrive.bEnablePositionDrive
+		|| Angular.SlerpDrive.bEnablePositionDrive || Angular.SwingDrive.bEnablePositionDrive || Angular.TwistDrive.bEnablePositionDrive;
+	const bool bVelocity = Linear.XDrive.bEnableVelocityDrive || Linear.YDrive.bEnableVelocityDrive || Linear.ZDrive.bEnableVelocityDrive
+		|| Angular.SlerpDrive.bEnableVelocityDrive || Angular.SwingDrive.bEnableVelocityDrive || Angular.TwistDrive.bEnableVelocityDrive;
+	TStringBuilder<32> Config;
+	Config << TEXT("lin ") << MotionChar(Profile.LinearLimit.XMotion) << MotionChar(Profile.LinearLimit.YMotion) << MotionChar(Profile.LinearLimit.ZMotion)
+		<< TEXT(" ang ") << MotionChar(Profile.ConeLimit.Swing1Motion) << MotionChar(Profile.ConeLimit.Swing2Motion) << MotionChar(Profile.TwistLimit.TwistMotion)
+		<< TEXT(" drv ") << (bPosition ? TEXT("P") : TEXT("")) << (bVelocity ? TEXT("V") : TEXT("")) << (!bPosition && !bVelocity ? TEXT("-") : TEXT(""));
+	return Config.ToString();
+}
+
+static void AddShapeCosts(const FKAggregateGeom& Geom, FPhysicsCostTotals& Cost)
+{
+	Cost.NumSpheres = Geom.SphereElems.Num();
+	Cost.NumBoxes = Geom.BoxElems.Num();
+	Cost.NumCapsules = Geom.SphylElems.Num();
+	Cost.NumTaperedCapsules = Geom.TaperedCapsuleElems.Num();
+	Cost.NumConvex = Geom.ConvexElems.Num();
+	Cost.NumLevelSets = Geom.LevelSetElems.Num();
+	Cost.NumSkinnedLevelSets = Geom.SkinnedLevelSetElems.Num();
+	Cost.AssetBytes += Geom.SphereElems.GetAllocatedSize() + Geom.BoxElems.GetAllocatedSize() + Geom.SphylElems.GetAllocatedSize()
+		+ Geom.TaperedCapsuleElems.GetAllocatedSize() + Geom.ConvexElems.GetAllocatedSize() + Geom.LevelSetElems.GetAllocatedSize()
+		+ Geom.SkinnedLevelSetElems.GetAllocatedSize();
+
+	for(const FKConvexElem& Convex : Geom.ConvexElems)
+	{
+		Cost.NumConvexVertices += Convex.VertexData.Num();
+		Cost.AssetBytes += Convex.VertexData.GetAllocatedSize() + Convex.IndexData.GetAllocatedSize() + Convex.VertexData.Num() * ConvexVertexBytes;
+	}
+	for(const FKLevelSetElem& LevelSet : Geom.LevelSetElems)
+	{
+		FTransform GridTransform;
+		TArray<float> GridValues;
+		FIntVector GridDims;
+		float GridCellSize;
+		LevelSet.GetLevelSetData(GridTransform, GridValues, GridDims, GridCellSize);
+		const int32 NumCells = GridDims.X * GridDims.Y * GridDims.Z;
+		Cost.NumLevelSetCells += NumCells;
+		Cost.AssetBytes += NumCells * LevelSetCellBytes;
+	}
+	Cost.InstanceBytes += Cost.GetNumShapes() * ShapeInstanceBytes;
+}
+
+bool PhysicsAssetCost::BuildReport(const UPhysicsAsset* PhysicsAsset, const TArray<FString>& GroupPatterns, FPhysicsAssetCostReport& OutReport)
+{
+	OutReport = FPhysicsAssetCostReport();
+	if(!PhysicsAsset) {
+		LGE("Physics asset not found")
+		return false; }
+	OutReport.AssetPath = PhysicsAsset->GetPathName();
+
+	TArray<FRegexPattern> Patterns;
+	for(const FString& PatternString : GroupPatterns)
+		Patterns.Emplace(PatternString);
+
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	OutReport.Bodies.SetNum(NumBodies);
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		FPhysicsBodyCost& Cost = OutReport.Bodies[i];
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[i];
+		if(!BodySetup)
+			continue;
+		Cost.BodyName = BodySetup->BoneName;
+		Cost.Group = GetGroupName(BodySetup->BoneName, Patterns, GroupPatterns);
+		Cost.AssetBytes = sizeof(USkeletalBodySetup);
+		Cost.InstanceBytes = sizeof(FBodyInstance) + ParticleBytes;
+		AddShapeCosts(BodySetup->AggGeom, Cost);
+	}
+
+	for(const UPhysicsConstraintTemplate* Template : PhysicsAsset->ConstraintSetup)
+	{
+		if(!Template)
+			continue;
+		const FConstraintInstance& Constraint = Template->DefaultInstance;
+		OutReport.ConstraintConfigs.FindOrAdd(GetConstraintConfig(Constraint))++;
+		FPhysicsCostTotals ConstraintCost;
+		ConstraintCost.NumConstraints = 1;
+		ConstraintCost.SolverRows = ConstraintGraph::EstimateSolverRows(Constraint);
+		ConstraintCost.AssetBytes = sizeof(UPhysicsConstraintTemplate) + GetProfileHandles(Template).NumBytes();
+		ConstraintCost.InstanceBytes = sizeof(FConstraintInstance) + JointBytes;
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(Constraint.ConstraintBone1);
+		if(OutReport.Bodies.IsValidIndex(BodyIndex))
+			OutReport.Bodies[BodyIndex].Add(ConstraintCost);
+		else
+			OutReport.Totals.Add(ConstraintCost);
+	}
+
+	TMap<FName, int32> GroupIndexMap;
+	for(const FPhysicsBodyCost& Cost : OutReport.Bodies)
+	{
+		int32& GroupIndex = GroupIndexMap.FindOrAdd(Cost.Group, INDEX_NONE);
+		if(GroupIndex == INDEX_NONE)
+		{
+			GroupIndex = OutReport.Groups.AddDefaulted();
+			OutReport.Groups[GroupIndex].Group = Cost.Group;
+		}
+		OutReport.Groups[GroupIndex].Add(Cost);
+		OutReport.Groups[GroupIndex].NumBodies++;
+		OutReport.Totals.Add(Cost);
+	}
+	OutReport.Groups.Sort([](const FPhysicsGroupCost& A, const FPhysicsGroupCost& B) { return A.InstanceBytes > B.InstanceBytes; });
+
+	OutReport.NumBodies = NumBodies;
+	OutReport.NumCollisionDisablePairs = PhysicsAsset->CollisionDisableTable.Num();
+	OutReport.CollisionDisableBytes = OutReport.NumCollisionDisablePairs * CollisionDisableEntryBytes;
+	OutReport.Totals.AssetBytes += OutReport.CollisionDisableBytes;
+
+	LG("Cost of %s: %d bodies, %d shapes, %d constraints (%d solver rows), %d disabled pairs, ~%lld KB asset, ~%lld KB per instance",
+	   *OutReport.AssetPath, NumBodies, OutReport.Totals.GetNumShapes(), OutReport.Totals.NumConstraints, OutReport.Totals.SolverRows,
+	   OutReport.NumCollisionDisablePairs, OutReport.Totals.AssetBytes / 1024, OutReport.Totals.InstanceBytes / 1024)
+	return true;
+}
+
+static void AppendCsvRow(FString& Csv, const TCHAR* Kind, const FString& Name, const FString& Group, int32 NumBodies, const FPhysicsCostTotals& Cost)
+{
+	Csv += FString::Printf(TEXT("%s,%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%lld,%lld\n"), Kind, *CsvField(Name), *CsvField(Group), NumBodies,
+	                       Cost.NumSpheres, Cost.NumBoxes, Cost.NumCapsules, Cost.NumTaperedCapsules, Cost.NumConvex, Cost.NumConvexVertices,
+	                       Cost.NumLevelSets, Cost.NumLevelSetCells, Cost.NumSkinnedLevelSets, Cost.NumConstraints, Cost.SolverRows,
+	                       Cost.AssetBytes, Cost.InstanceBytes);
+}
+
+FString PhysicsAssetCost::ToCsv(const FPhysicsAssetCostReport& Report)
+{
+	FString Csv = TEXT("Kind,Name,Group,Bodies,Spheres,Boxes,Capsules,TaperedCapsules,Convex,ConvexVertices,LevelSets,LevelSetCells,")
+		TEXT("SkinnedLevelSets,Constraints,SolverRows,AssetBytes,InstanceBytes\n");
+	for(const FPhysicsBodyCost& Cost : Report.Bodies)
+		AppendCsvRow(Csv, TEXT("Body"), Cost.BodyName.ToString(), Cost.Group.ToString(), 1, Cost);
+	for(const FPhysicsGroupCost& Cost : Report.Groups)
+		AppendCsvRow(Csv, TEXT("Group"), Cost.Group.ToString(), Cost.Group.ToString(), Cost.NumBodies, Cost);
+	AppendCsvRow(Csv, TEXT("Asset"), Report.AssetPath, FString(), Report.NumBodies, Report.Totals);
+	// Only the columns that apply are filled: the constraint count per configuration, the table size and bytes
+	for(const TPair<FString, int32>& Config : Report.ConstraintConfigs)
+		Csv += FString::Printf(TEXT("Config,%s,,,,,,,,,,,,%d,,,\n"), *CsvField(Config.Key), Config.Value);
+	Csv += FString::Printf(TEXT("CollisionDisable,%d,,,,,,,,,,,,,,%lld,\n"), Report.NumCollisionDisablePairs, Report.CollisionDisableBytes);
+	return Csv;
+}
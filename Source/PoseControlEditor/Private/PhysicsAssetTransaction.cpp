@@ -0,0 +1,59 @@
+﻿#include "PhysicsAssetTransaction.h"
+
+#include "ScopedTransaction.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+int32 FScopedPhysicsAssetTransaction::Depth = 0;
+TSet<const UObject*> FScopedPhysicsAssetTransaction::ModifiedObjects;
+
+FScopedPhysicsAssetTransaction::FScopedPhysicsAssetTransaction(const FText& Description)
+{
+	check(IsInGameThread());
+	if(Depth++ == 0)
+	{
+		ModifiedObjects.Reset();
+		Transaction = MakeUnique<FScopedTransaction>(Description);
+	}
+}
+
+FScopedPhysicsAssetTransaction::~FScopedPhysicsAssetTransaction()
+{
+	if(--Depth == 0)
+	{
+		Transaction.Reset();
+		ModifiedObjects.Reset();
+	}
+}
+
+void FScopedPhysicsAssetTransaction::ModifyObject(UObject* Object)
+{
+	if(!Object)
+		return;
+	if(Depth > 0)
+	{
+		bool bAlreadyModified = false;
+		ModifiedObjects.Add(Object, &bAlreadyModified);
+		if(bAlreadyModified)
+			return;
+	}
+	Object->Modify();
+}
+
+void FScopedPhysicsAssetTransaction::ModifyAsset(UPhysicsAsset* PhysicsAsset)
+{
+	ModifyObject(PhysicsAsset);
+}
+
+void FScopedPhysicsAssetTransaction::ModifyBody(UPhysicsAsset* PhysicsAsset, int32 BodyIndex)
+{
+	if(PhysicsAsset && PhysicsAsset->SkeletalBodySetups.IsValidIndex(BodyIndex))
+		ModifyObject(PhysicsAsset->SkeletalBodySetups[BodyIndex]);
+}
+
+void FScopedPhysicsAssetTransaction::ModifyConstraint(UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex)
+{
+	if(PhysicsAsset && PhysicsAsset->ConstraintSetup.IsValidIndex(ConstraintIndex))
+		ModifyObject(PhysicsAsset->ConstraintSetup[ConstraintIndex]);
+}
@@ -0,0 +1,461 @@
+﻿#include "PhysicsAssetValidation.h"
+
+#include "BonePose.h"
+#include "CustomLogging.h"
+#include "JointNames.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "Async/ParallelFor.h"
+#include "Engine/SkeletalMesh.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+/** One shape in component space: a segment with a radius (spheres have A == B), or just its bounds for boxes and convexes */
+struct FValidationShape
+{
+	FVector A = FVector::ZeroVector;
+	FVector B = FVector::ZeroVector;
+	float Radius = 0.f;
+	FBox Bounds = FBox(ForceInit);
+	bool bRound = false;
+};
+
+struct FBodyShapes
+{
+	TArray<FValidationShape, TInlineAllocator<4>> Shapes;
+	FBox Bounds = FBox(ForceInit);
+};
+
+static FPhysicsAssetIssue MakeIssue(EPhysicsAssetIssueType Type, int32 Index, FName Name, const FString& Message, bool bFixable = true)
+{
+	FPhysicsAssetIssue Issue;
+	Issue.Type = Type;
+	Issue.Index = Index;
+	Issue.Name = Name;
+	Issue.Message = Message;
+	Issue.bFixable = bFixable;
+	return Issue;
+}
+
+static uint64 MakePairKey(int32 A, int32 B)
+{
+	return (uint64(uint32(FMath::Min(A, B))) << 32) | uint32(FMath::Max(A, B));
+}
+
+static void AddRoundShape(FBodyShapes& Body, const FVector& A, const FVector& B, float Radius)
+{
+	FValidationShape& Shape = Body.Shapes.AddDefaulted_GetRef();
+	Shape.A = A;
+	Shape.B = B;
+	Shape.Radius = Radius;
+	Shape.bRound = true;
+	Shape.Bounds = FBox(A.ComponentMin(B) - FVector(Radius), A.ComponentMax(B) + FVector(Radius));
+	Body.Bounds += Shape.Bounds;
+}
+
+static void AddBoxShape(FBodyShapes& Body, const FBox& Bounds)
+{
+	Body.Shapes.AddDefaulted_GetRef().Bounds = Bounds;
+	Body.Bounds += Bounds;
+}
+
+static void CollectShapes(const USkeletalBodySetup* Body, const FTransform& BoneTransform, FBodyShapes& OutShapes)
+{
+	const float Scale = BoneTransform.GetMaximumAxisScale();
+	const FKAggregateGeom& Geom = Body->AggGeom;
+	for(const FKSphereElem& Sphere : Geom.SphereElems)
+	{
+		const FVector Center = BoneTransform.TransformPosition(Sphere.Center);
+		AddRoundShape(OutShapes, Center, Center, Sphere.Radius * Scale);
+	}
+	for(const FKSphylElem& Capsule : Geom.SphylElems)
+	{
+		const FTransform ElemTransform = Capsule.GetTransform() * BoneTransform;
+		const FVector HalfAxis = ElemTransform.TransformVector(FVector(0.f, 0.f, Capsule.Length * .5f));
+		AddRoundShape(OutShapes, ElemTransform.GetLocation() - HalfAxis, ElemTransform.GetLocation() + HalfAxis, Capsule.Radius * Scale);
+	}
+	// Tapered capsules as capsules of their larger radius
+	for(const FKTaperedCapsuleElem& Capsule : Geom.TaperedCapsuleElems)
+	{
+		const FTransform ElemTransform = Capsule.GetTransform() * BoneTransform;
+		const FVector HalfAxis = ElemTransform.TransformVector(FVector(0.f, 0.f, Capsule.Length * .5f));
+		AddRoundShape(OutShapes, ElemTransform.GetLocation() - HalfAxis, ElemTransform.GetLocation() + HalfAxis,
+		              FMath::Max(Capsule.Radius0, Capsule.Radius1) * Scale);
+	}
+	for(const FKBoxElem& Box : Geom.BoxElems)
+		AddBoxShape(OutShapes, Box.CalcAABB(BoneTransform, 1.f));
+	for(const FKConvexElem& Convex : Geom.ConvexElems)
+		AddBoxShape(OutShapes, Convex.CalcAABB(BoneTransform, FVector::OneVector));
+}
+
+static bool ShapesOverlap(const FValidationShape& Shape1, const FValidationShape& Shape2, float Tolerance)
+{
+	if(Shape1.bRound && Shape2.bRound)
+	{
+		FVector Closest1, Closest2;
+		FMath::SegmentDistToSegmentSafe(Shape1.A, Shape1.B, Shape2.A, Shape2.B, Closest1, Closest2);
+		return FVector::Dist(Closest1, Closest2) < Shape1.Radius + Shape2.Radius - Tolerance;
+	}
+	// Anything angular by its bounds, which overestimates rotated shapes
+	return Shape1.Bounds.ExpandBy(-Tolerance).Intersect(Shape2.Bounds.ExpandBy(-Tolerance));
+}
+
+static void CheckBody(const UPhysicsAsset* PhysicsAsset, int32 BodyIndex, const FBonePose& Pose, TArray<FPhysicsAssetIssue>& OutIssues,
+                      FBodyShapes& OutShapes)
+{
+	const USkeletalBodySetup* Body = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+	if(!Body)
+	{
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::NullBodySetup, BodyIndex, NAME_None, TEXT("Null body setup")));
+		return;
+	}
+
+	const int32* MappedIndex = PhysicsAsset->BodySetupIndexMap.Find(Body->BoneName);
+	if(!MappedIndex)
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::StaleBodyIndexMap, BodyIndex, Body->BoneName, TEXT("Missing from the index map")));
+	else if(*MappedIndex != BodyIndex)
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::StaleBodyIndexMap, BodyIndex, Body->BoneName,
+		                        FString::Printf(TEXT("Index map points at %d"), *MappedIndex)));
+
+	// Written as !(x > 0) so NaN fails too
+	const FBodyInstance& Instance = Body->DefaultInstance;
+	if(Instance.bOverrideMass && !(Instance.GetMassOverride() > 0.f))
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::InvalidBodyMass, BodyIndex, Body->BoneName,
+		                        FString::Printf(TEXT("Mass override %.3f kg"), Instance.GetMassOverride())));
+	else if(!(Instance.MassScale > 0.f))
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::InvalidBodyMass, BodyIndex, Body->BoneName,
+		                        FString::Printf(TEXT("Mass scale %.3f"), Instance.MassScale)));
+	else if(!(Instance.InertiaTensorScale.GetMin() > 0.f))
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::InvalidBodyMass, BodyIndex, Body->BoneName,
+		                        FString::Printf(TEXT("Inertia scale %s"), *Instance.InertiaTensorScale.ToCompactString())));
+	else
+	{
+		const float Mass = Body->CalculateMass();
+		if(!(Mass > 0.f) || !FMath::IsFinite(Mass))
+			OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::InvalidBodyMass, BodyIndex, Body->BoneName,
+			                        Body->AggGeom.GetElementCount() == 0 ? FString(TEXT("No shapes to take a mass from"))
+			                                                             : FString::Printf(TEXT("Mass %.3f kg"), Mass), false));
+	}
+
+	if(!Pose.IsValid() || Body->CollisionReponse == EBodyCollisionResponse::BodyCollision_Disabled
+		|| !CollisionEnabledHasPhysics(Instance.GetCollisionEnabled()))
+		return;
+	const int32 BoneIndex = Pose.GetBoneIndex(Body->BoneName);
+	if(Pose.ComponentSpace.IsValidIndex(BoneIndex))
+		CollectShapes(Body, Pose.ComponentSpace[BoneIndex], OutShapes);
+}
+
+static void CheckConstraint(const UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex, const TMap<FName, int32>& BodyIndexes,
+                            const TMap<FName, int32>& FirstJointIndexes, TArray<FPhysicsAssetIssue>& OutIssues)
+{
+	const UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[ConstraintIndex];
+	if(!Template)
+	{
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::MissingConstraintBody, ConstraintIndex, NAME_None, TEXT("Null constraint template")));
+		return;
+	}
+	const FConstraintInstance& Instance = Template->DefaultInstance;
+
+	for(const EConstraintFrame::Type Frame : {EConstraintFrame::Frame1, EConstraintFrame::Frame2})
+	{
+		const FTransform RefFrame = Instance.GetRefFrame(Frame);
+		if(!RefFrame.Scale3DEquals(FTransform::Identity))
+			OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::ConstraintFrameScale, ConstraintIndex, Instance.JointName,
+			                        FString::Printf(TEXT("Frame %d scale %s"), Frame == EConstraintFrame::Frame1 ? 1 : 2,
+			                                        *RefFrame.GetScale3D().ToCompactString())));
+	}
+
+	for(const FName& BoneName : {Instance.ConstraintBone1, Instance.ConstraintBone2})
+	{
+		if(!BodyIndexes.Contains(BoneName))
+			OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::MissingConstraintBody, ConstraintIndex, Instance.JointName,
+			                        FString::Printf(TEXT("No body for bone %s"), *BoneName.ToString())));
+	}
+
+	const int32* FirstIndex = FirstJointIndexes.Find(Instance.JointName);
+	if(FirstIndex && *FirstIndex != ConstraintIndex)
+		OutIssues.Add(MakeIssue(EPhysicsAssetIssueType::DuplicateJointName, ConstraintIndex, Instance.JointName,
+		                        FString::Printf(TEXT("Also used by constraint %d"), *FirstIndex)));
+}
+
+bool PhysicsAssetValidation::Validate(const UPhysicsAsset* PhysicsAsset, const USkeletalMesh* SkeletalMesh,
+                                      const FPhysicsAssetValidationOptions& Options, FPhysicsAssetValidationReport& OutReport)
+{
+	OutReport = FPhysicsAssetValidationReport();
+	if(!PhysicsAsset) {
+		LGE("No physics asset to validate")
+		return false; }
+	OutReport.AssetPath = PhysicsAsset->GetPathName();
+	const int32 NumBodies = OutReport.NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	const int32 NumConstraints = OutReport.NumConstraints = PhysicsAsset->ConstraintSetup.Num();
+
+	// Lookups the parallel passes share, built from the setups themselves since the index map may be stale
+	TMap<FName, int32> BodyIndexes;
+	BodyIndexes.Reserve(NumBodies);
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		if(const USkeletalBodySetup* Body = PhysicsAsset->SkeletalBodySetups[i])
+			BodyIndexes.FindOrAdd(Body->BoneName, i);
+	}
+	TMap<FName, int32> FirstJointIndexes;
+	TSet<uint64> ConstrainedWithoutCollision;
+	FirstJointIndexes.Reserve(NumConstraints);
+	for(int32 i = 0; i < NumConstraints; i++)
+	{
+		const UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[i];
+		if(!Template)
+			continue;
+		const FConstraintInstance& Instance = Template->DefaultInstance;
+		FirstJointIndexes.FindOrAdd(Instance.JointName, i);
+		const int32* Child = BodyIndexes.Find(Instance.ConstraintBone1);
+		const int32* Parent = BodyIndexes.Find(Instance.ConstraintBone2);
+		if(Child && Parent && Instance.ProfileInstance.bDisableCollision)
+			ConstrainedWithoutCollision.Add(MakePairKey(*Child, *Parent));
+	}
+
+	// Entries for names without any body; the bodies' own entries are checked in the body pass
+	for(const TPair<FName, int32>& Entry : PhysicsAsset->BodySetupIndexMap)
+	{
+		if(!BodyIndexes.Contains(Entry.Key))
+			OutReport.Issues.Add(MakeIssue(EPhysicsAssetIssueType::StaleBodyIndexMap, Entry.Value, Entry.Key, TEXT("No body for this entry")));
+	}
+
+	const USkeletalMesh* PoseMesh = SkeletalMesh ? SkeletalMesh : PhysicsAsset->GetPreviewMesh();
+	const FBonePose Pose = Options.bCheckOverlaps ? FBonePose::FromRefPose(PoseMesh) : FBonePose();
+	OutReport.bCheckedOverlaps = Pose.IsValid();
+	if(Options.bCheckOverlaps && !Pose.IsValid())
+		LGW("No mesh to pose %s, skipping the overlap check", *PhysicsAsset->GetName())
+
+	TArray<TArray<FPhysicsAssetIssue>> BodyIssues;
+	TArray<FBodyShapes> BodyShapes;
+	BodyIssues.SetNum(NumBodies);
+	BodyShapes.SetNum(NumBodies);
+	ParallelFor(NumBodies, [PhysicsAsset, &Pose, &BodyIssues, &BodyShapes](int32 BodyIndex)
+	{
+		CheckBody(PhysicsAsset, BodyIndex, Pose, BodyIssues[BodyIndex], BodyShapes[BodyIndex]);
+	});
+
+	TArray<TArray<FPhysicsAssetIssue>> ConstraintIssues;
+	ConstraintIssues.SetNum(NumConstraints);
+	ParallelFor(NumConstraints, [PhysicsAsset, &BodyIndexes, &FirstJointIndexes, &ConstraintIssues](int32 ConstraintIndex)
+	{
+		CheckConstraint(PhysicsAsset, ConstraintIndex, BodyIndexes, FirstJointIndexes, ConstraintIssues[ConstraintIndex]);
+	});
+
+	// Sweep and prune along X: each body only tests the bodies that start before it ends
+	TArray<int32> SweepOrder;
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		if(BodyShapes[i].Shapes.Num() > 0)
+			SweepOrder.Add(i);
+	}
+	SweepOrder.Sort([&BodyShapes](int32 A, int32 B) { return BodyShapes[A].Bounds.Min.X < BodyShapes[B].Bounds.Min.X; });
+	TArray<TArray<FPhysicsAssetIssue>> OverlapIssues;
+	OverlapIssues.SetNum(SweepOrder.Num());
+	const float Tolerance = Options.OverlapTolerance;
+	ParallelFor(SweepOrder.Num(), [&](int32 SweepIndex)
+	{
+		const int32 BodyA = SweepOrder[SweepIndex];
+		const FBodyShapes& ShapesA = BodyShapes[BodyA];
+		for(int32 j = SweepIndex + 1; j < SweepOrder.Num(); j++)
+		{
+			const int32 BodyB = SweepOrder[j];
+			const FBodyShapes& ShapesB = BodyShapes[BodyB];
+			if(ShapesB.Bounds.Min.X > ShapesA.Bounds.Max.X - Tolerance)
+				break;
+			if(!ShapesA.Bounds.Intersect(ShapesB.Bounds) || !PhysicsAsset->IsCollisionEnabled(BodyA, BodyB)
+				|| ConstrainedWithoutCollision.Contains(MakePairKey(BodyA, BodyB))
+				|| UPhysicsEditorBPLibrary::BodiesIgnoreEachOther(PhysicsAsset, BodyA, BodyB))
+				continue;
+			bool bOverlap = false;
+			for(int32 s = 0; s < ShapesA.Shapes.Num() && !bOverlap; s++)
+			{
+				for(int32 t = 0; t < ShapesB.Shapes.Num() && !bOverlap; t++)
+					bOverlap = ShapesOverlap(ShapesA.Shapes[s], ShapesB.Shapes[t], Tolerance);
+			}
+			if(!bOverlap)
+				continue;
+			const int32 First = FMath::Min(BodyA, BodyB), Second = FMath::Max(BodyA, BodyB);
+			FPhysicsAssetIssue Issue = MakeIssue(EPhysicsAssetIssueType::OverlappingColliders, First,
+				PhysicsAsset->SkeletalBodySetups[First]->BoneName,
+				FString::Printf(TEXT("Overlaps %s"), *PhysicsAsset->SkeletalBodySetups[Second]->BoneName.ToString()));
+			Issue.OtherIndex = Second;
+			OverlapIssues[SweepIndex].Add(MoveTemp(Issue));
+		}
+	});
+
+	for(TArray<TArray<FPhysicsAssetIssue>>* Issues : {&BodyIssues, &ConstraintIssues, &OverlapIssues})
+	{
+		for(TArray<FPhysicsAssetIssue>& ItemIssues : *Issues)
+			OutReport.Issues.Append(MoveTemp(ItemIssues));
+	}
+	OutReport.Issues.Sort([](const FPhysicsAssetIssue& A, const FPhysicsAssetIssue& B)
+	{
+		return A.Type != B.Type ? A.Type < B.Type : A.Index != B.Index ? A.Index < B.Index : A.OtherIndex < B.OtherIndex;
+	});
+
+	LG("Validated %s: %d bodies, %d constraints, %d issues", *PhysicsAsset->GetName(), NumBodies, NumConstraints, OutReport.Issues.Num())
+	for(const FPhysicsAssetIssue& Issue : OutReport.Issues)
+		LGV("  %s %d %s: %s", *StaticEnum<EPhysicsAssetIssueType>()->GetNameStringByValue(int64(Issue.Type)), Issue.Index,
+		    *Issue.Name.ToString(), *Issue.Message)
+	return true;
+}
+
+static bool IsFixEnabled(const FPhysicsAssetValidationOptions& Options, EPhysicsAssetIssueType Type)
+{
+	switch(Type)
+	{
+	case EPhysicsAssetIssueType::ConstraintFrameScale:
+		return Options.bResetFrameScale;
+	case EPhysicsAssetIssueType::NullBodySetup:
+		return Options.bRemoveNullBodies;
+	case EPhysicsAssetIssueType::InvalidBodyMass:
+		return Options.bResetInvalidMass;
+	case EPhysicsAssetIssueType::MissingConstraintBody:
+		return Options.bRemoveBrokenConstraints;
+	case EPhysicsAssetIssueType::DuplicateJointName:
+		return Options.bRenameDuplicateJoints;
+	case EPhysicsAssetIssueType::StaleBodyIndexMap:
+		return Options.bRebuildBodyIndexMap;
+	case EPhysicsAssetIssueType::OverlappingColliders:
+		return Options.bDisableOverlapCollision;
+	default:
+		return false;
+	}
+}
+
+static FName MakeUniqueJointName(const UPhysicsAsset* PhysicsAsset, const FConstraintInstance& Instance)
+{
+	const FName Base = JointNames::MakePairName(Instance.ConstraintBone1, Instance.ConstraintBone2);
+	FName Name = Base;
+	for(int32 Number = 1; PhysicsAsset->FindConstraintIndex(Name) != INDEX_NONE; Number++)
+		Name = FName(Base, Base.GetNumber() + Number);
+	return Name;
+}
+
+int32 PhysicsAssetValidation::ApplyFixes(UPhysicsAsset* PhysicsAsset, const FPhysicsAssetValidationOptions& Options,
+                                         FPhysicsAssetValidationReport& Report)
+{
+	if(!PhysicsAsset)
+		return 0;
+	if(Report.AssetPath != PhysicsAsset->GetPathName() || Report.NumBodies != PhysicsAsset->SkeletalBodySetups.Num()
+		|| Report.NumConstraints != PhysicsAsset->ConstraintSetup.Num()) {
+		LGE("Validation report doesn't match %s, validate it again", *PhysicsAsset->GetName())
+		return 0; }
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsAssetValidation", "FixPhysicsAsset", "Fix Physics Asset"));
+	TArray<int32> RemovedBodies, RemovedConstraints;
+	bool bRebuildIndexMap = false;
+	int32 NumFixed = 0;
+
+	// In place first, while every index in the report is still valid
+	for(FPhysicsAssetIssue& Issue : Report.Issues)
+	{
+		if(!Issue.bFixable || Issue.bFixed || !IsFixEnabled(Options, Issue.Type))
+			continue;
+		switch(Issue.Type)
+		{
+		case EPhysicsAssetIssueType::ConstraintFrameScale:
+		{
+			FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, Issue.Index);
+			FConstraintInstance& Instance = PhysicsAsset->ConstraintSetup[Issue.Index]->DefaultInstance;
+			for(const EConstraintFrame::Type Frame : {EConstraintFrame::Frame1, EConstraintFrame::Frame2})
+			{
+				FTransform RefFrame = Instance.GetRefFrame(Frame);
+				RefFrame.SetScale3D(FVector::OneVector);
+				Instance.SetRefFrame(Frame, RefFrame);
+			}
+			break;
+		}
+		case EPhysicsAssetIssueType::InvalidBodyMass:
+		{
+			FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, Issue.Index);
+			FBodyInstance& Instance = PhysicsAsset->SkeletalBodySetups[Issue.Index]->DefaultInstance;
+			if(Instance.bOverrideMass && !(Instance.GetMassOverride() > 0.f))
+				Instance.bOverrideMass = false;
+			if(!(Instance.MassScale > 0.f))
+				Instance.MassScale = 1.f;
+			for(int32 Axis = 0; Axis < 3; Axis++)
+			{
+				if(!(Instance.InertiaTensorScale[Axis] > 0.f))
+					Instance.InertiaTensorScale[Axis] = 1.f;
+			}
+			break;
+		}
+		case EPhysicsAssetIssueType::DuplicateJointName:
+		{
+			FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, Issue.Index);
+			FConstraintInstance& Instance = PhysicsAsset->ConstraintSetup[Issue.Index]->DefaultInstance;
+			Instance.JointName = MakeUniqueJointName(PhysicsAsset, Instance);
+			break;
+		}
+		case EPhysicsAssetIssueType::OverlappingColliders:
+			FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+			PhysicsAsset->DisableCollision(Issue.Index, Issue.OtherIndex);
+			break;
+		case EPhysicsAssetIssueType::MissingConstraintBody:
+			RemovedConstraints.AddUnique(Issue.Index);
+			break;
+		case EPhysicsAssetIssueType::NullBodySetup:
+			RemovedBodies.Add(Issue.Index);
+			break;
+		case EPhysicsAssetIssueType::StaleBodyIndexMap:
+			bRebuildIndexMap = true;
+			break;
+		default:
+			continue;
+		}
+		Issue.bFixed = true;
+		NumFixed++;
+	}
+
+	if(RemovedConstraints.Num() > 0)
+	{
+		FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+		RemovedConstraints.Sort(TGreater<int32>());
+		for(int32 Index : RemovedConstraints)
+			PhysicsAsset->ConstraintSetup.RemoveAt(Index);
+	}
+
+	if(RemovedBodies.Num() > 0)
+	{
+		// The collision table is keyed by body index, so its pairs move down with the bodies
+		FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+		TArray<int32> NewIndexes;
+		NewIndexes.SetNumUninitialized(PhysicsAsset->SkeletalBodySetups.Num());
+		for(int32 i = 0, Next = 0; i < NewIndexes.Num(); i++)
+			NewIndexes[i] = RemovedBodies.Contains(i) ? INDEX_NONE : Next++;
+		TMap<FRigidBodyIndexPair, bool> CollisionDisableTable;
+		for(const TPair<FRigidBodyIndexPair, bool>& Entry : PhysicsAsset->CollisionDisableTable)
+		{
+			const int32 A = Entry.Key.Indices[0], B = Entry.Key.Indices[1];
+			if(NewIndexes.IsValidIndex(A) && NewIndexes.IsValidIndex(B) && NewIndexes[A] != INDEX_NONE && NewIndexes[B] != INDEX_NONE)
+				CollisionDisableTable.Add(FRigidBodyIndexPair(NewIndexes[A], NewIndexes[B]), Entry.Value);
+		}
+		RemovedBodies.Sort(TGreater<int32>());
+		for(int32 Index : RemovedBodies)
+			PhysicsAsset->SkeletalBodySetups.RemoveAt(Index);
+		PhysicsAsset->CollisionDisableTable = MoveTemp(CollisionDisableTable);
+		bRebuildIndexMap = true;
+	}
+
+	if(bRebuildIndexMap)
+	{
+		FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+		PhysicsAsset->UpdateBodySetupIndexMap();
+		PhysicsAsset->UpdateBoundsBodiesArray();
+	}
+
+	Report.NumFixed += NumFixed;
+	LG("Fixed %d of %d issues on %s", NumFixed, Report.Issues.Num(), *PhysicsAsset->GetName())
+	if(NumFixed > 0)
+	{
+		PhysicsAsset->RefreshPhysicsAssetChange();
+		PhysicsAsset->MarkPackageDirty();
+	}
+	return NumFixed;
+}
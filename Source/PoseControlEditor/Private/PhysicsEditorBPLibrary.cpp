@@ -3,8 +3,26 @@
 
 #include "PhysicsEditorBPLibrary.h"
 #include "Utils.h"
+#include "BackgroundOperation.h"
+#include "BonePose.h"
+#include "ConstraintGraph.h"
+#include "ConstraintRetarget.h"
+#include "DriveTuner.h"
+#include "JointNames.h"
+#include "MassHierarchy.h"
+#include "MorphVariantCache.h"
+#include "PackageSaveScope.h"
+#include "PhysicsAssetCost.h"
+#include "PhysicsLod.h"
+#include "PhysicsSoakBenchmark.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsAssetValidation.h"
+#include "SkinSurface.h"
+#include "SolverOrdering.h"
+#include "SymmetryMap.h"
 #include "AnimationEditorPreviewActor.h"
 #include "AssetViewUtils.h"
+#include "Async/ParallelFor.h"
 #include "CustomLogging.h"
 #include "DynamicMeshBuilder.h"
 #include "FileHelpers.h"
@@ -13,10 +31,12 @@
 #include "PhysicsEngine/ConvexElem.h"
 #include "PhysicsEngine/AggregateGeom.h"
 #include "MeshUtilitiesCommon.h"
+#include "Misc/FileHelper.h"
 #include "Animation/PcAnimInstance.h"
 #include "Animation/SkeletalMeshActor.h"
 #include "AssetUtils/CreateSkeletalMeshUtil.h"
 #include "EditorAssetLibrary.h"
+#include "Engine/CollisionProfile.h"
 #include "IPhysicsAssetEditor.h"
 #include "Animation/DebugSkelMeshComponent.h"
 #include "EditorScriptingUtilities/Private/EditorScriptingUtils.h"
@@ -33,16 +53,16 @@
 #undef LOG_CAT
 #define LOG_CAT LogPhysicsEditor
 
-bool UPhysicsEditorBPLibrary::SetRefPoseOverride(USkeletalMeshComponent* SkeletalMeshComponent, TArray<FTransform> NewRefPoseTransforms)
-// const TArray<FTransform>& NewRefPoseTransforms)
+bool UPhysicsEditorBPLibrary::SetRefPoseOverride(USkeletalMeshComponent* SkeletalMeshComponent, const TArray<FTransform>& NewRefPoseTransforms)
 {
 	if(SkeletalMeshComponent)
 	{
 		
 		if(NewRefPoseTransforms.Num() != SkeletalMeshComponent->GetNumBones())
 		{
-			LG("Skel Mesh has %d bones, Transform array has %d bones. Using current pose.")
-			NewRefPoseTransforms = SkeletalMeshComponent->GetBoneSpaceTransforms();
+			LG("Skel Mesh has %d bones, Transform array has %d bones. Using current pose.", SkeletalMeshComponent->GetNumBones(), NewRefPoseTransforms.Num())
+			SkeletalMeshComponent->SetRefPoseOverride(SkeletalMeshComponent->GetBoneSpaceTransforms());
+			return true;
 		}
 		LG("Setting Ref Pose Override");
 		SkeletalMeshComponent->SetRefPoseOverride(NewRefPoseTransforms);
@@ -53,70 +73,137 @@ bool UPhysicsEditorBPLibrary::SetRefPoseOverride(USkeletalMeshComponent* Skeleta
 
 bool UPhysicsEditorBPLibrary::FixConstraintScale(UPhysicsAsset* PhysicsAsset)
 {
-	for (int i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
-	{
-		if (PhysicsAsset->ConstraintSetup[i])
-		{
-			UPhysicsConstraintTemplate* ConstraintTemplate = PhysicsAsset->ConstraintSetup[i];
-			FConstraintInstance* Constraint = &ConstraintTemplate->DefaultInstance;
-			//FConstraintInstance* constraint = PhysicsAsset->GetConstraintInstanceByIndex(i);
+	// The frame scale fix alone, the other checks are cheap enough to log along with it
+	FPhysicsAssetValidationOptions Options;
+	Options.bCheckOverlaps = false;
+	Options.bRemoveNullBodies = Options.bResetInvalidMass = Options.bRemoveBrokenConstraints = false;
+	Options.bRenameDuplicateJoints = Options.bRebuildBodyIndexMap = Options.bDisableOverlapCollision = false;
+	FPhysicsAssetValidationReport Report;
+	return FixPhysicsAsset(PhysicsAsset, nullptr, Options, Report);
+}
 
-			for (int j = 0; j < 2; j++)
-			{
-				EConstraintFrame::Type Frame = j == 0 ? EConstraintFrame::Frame1 : EConstraintFrame::Frame2;
-				FTransform Tform = Constraint->GetRefFrame(Frame);
-				if (!Tform.Scale3DEquals(FTransform::Identity))
-				{
-					LG("constraint %s frame %d, scale: %s", *Constraint->JointName.ToString(), j + 1, *Tform.GetScale3D().ToCompactString());
-					Tform.SetScale3D(FVector::OneVector);
-					Constraint->SetRefFrame(Frame, Tform);
-				}
-			}
-		}
-	}
+bool UPhysicsEditorBPLibrary::ValidatePhysicsAsset(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+                                                   const FPhysicsAssetValidationOptions& Options, FPhysicsAssetValidationReport& OutReport)
+{
+	return PhysicsAssetValidation::Validate(PhysicsAsset, SkeletalMesh, Options, OutReport);
+}
+
+bool UPhysicsEditorBPLibrary::FixPhysicsAsset(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+                                              const FPhysicsAssetValidationOptions& Options, FPhysicsAssetValidationReport& OutReport)
+{
+	if(!PhysicsAssetValidation::Validate(PhysicsAsset, SkeletalMesh, Options, OutReport))
+		return false;
+	PhysicsAssetValidation::ApplyFixes(PhysicsAsset, Options, OutReport);
 	return true;
 }
 
+bool UPhysicsEditorBPLibrary::GetPhysicsAssetCostReport(UPhysicsAsset* PhysicsAsset, const TArray<FString>& GroupPatterns, const FString& CsvFilePath,
+                                                        FPhysicsAssetCostReport& OutReport)
+{
+	if(!PhysicsAssetCost::BuildReport(PhysicsAsset, GroupPatterns, OutReport))
+		return false;
+	if(!CsvFilePath.IsEmpty() && !FFileHelper::SaveStringToFile(PhysicsAssetCost::ToCsv(OutReport), *CsvFilePath)) {
+		LGE("Unable to write cost report to %s", *CsvFilePath)
+		return false; }
+	return true;
+}
+
+bool UPhysicsEditorBPLibrary::RunPhysicsSoakBenchmark(UPcActorDataAsset* DataAsset, const FPhysicsSoakOptions& Options, FPhysicsSoakResult& OutResult)
+{
+	if(!DataAsset) {
+		LGE("No Data Asset found.")
+		return false; }
+	USkeletalMesh* SkeletalMesh = PhysicsSoakBenchmark::GetSoakMesh(DataAsset);
+	if(!SkeletalMesh)
+		return false;
+	return PhysicsSoakBenchmark::Run(SkeletalMesh, DataAsset->GetTargetPhysicsAsset(), Options, OutResult);
+}
+
+bool UPhysicsEditorBPLibrary::TuneConstraintDrives(UPcActorDataAsset* DataAsset, const FDriveTuningOptions& Options, FDriveTuningReport& OutReport)
+{
+	if(!DataAsset) {
+		LGE("No Data Asset found.")
+		return false; }
+	USkeletalMesh* SkeletalMesh = PhysicsSoakBenchmark::GetSoakMesh(DataAsset);
+	if(!SkeletalMesh)
+		return false;
+	UPhysicsAsset* PhysicsAsset = DataAsset->GetTargetPhysicsAsset();
+	if(!DriveTuner::Tune(SkeletalMesh, PhysicsAsset, DataAsset->PhatConstraintOptions, Options, OutReport))
+		return false;
+	DataAsset->MarkPackageDirty();
+	FScopedPackageSave::RequestSave(TArray<UObject*>{PhysicsAsset, DataAsset});
+	return true;
+}
+
+bool UPhysicsEditorBPLibrary::RebalanceMassHierarchy(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+	const FPhatConstraintOptions& PhatOptions, const FMassRebalanceOptions& Options, FMassRebalanceReport& OutReport)
+{
+	if(!PhysicsAsset || !SkeletalMesh) {
+		LGE("Physics asset or skeletal mesh not found")
+		return false; }
+	if(!MassHierarchy::Rebalance(PhysicsAsset, SkeletalMesh->GetRefSkeleton(), PhatOptions, Options, OutReport))
+		return false;
+	FScopedPackageSave::RequestSave(PhysicsAsset);
+	return true;
+}
+
+UPhysicsAsset* UPhysicsEditorBPLibrary::GeneratePhysicsLod(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+	const FPhatConstraintOptions& PhatOptions, const FPhysicsLodOptions& Options, FPhysicsLodReport& OutReport)
+{
+	return PhysicsLod::Generate(PhysicsAsset, SkeletalMesh, PhatOptions, Options, OutReport);
+}
+
+bool UPhysicsEditorBPLibrary::ReorderBodiesForSolver(UPhysicsAsset* PhysicsAsset, const FPhatConstraintOptions& PhatOptions,
+	const FSolverOrderingOptions& Options, FSolverOrderingReport& OutReport)
+{
+	if(!SolverOrdering::Reorder(PhysicsAsset, PhatOptions, Options, OutReport))
+		return false;
+	if(OutReport.NumBodiesMoved > 0 || OutReport.NumConstraintsMoved > 0)
+		FScopedPackageSave::RequestSave(PhysicsAsset);
+	return true;
+}
+
+
+static bool AlignConstraintInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose, int32 ConstraintIndex, float PositionBlend)
+{
+	if(!PhysicsAsset || !Pose.IsValid()) {
+		LGE("Physics asset not found")
+		return false; }
+	UPhysicsConstraintTemplate* Setup = PhysicsAsset->ConstraintSetup.IsValidIndex(ConstraintIndex) ? PhysicsAsset->ConstraintSetup[ConstraintIndex].Get() : nullptr;
+	if(!Setup)
+		return false;
+	FConstraintInstance* Constraint = &Setup->DefaultInstance;
+	if(PhysicsAsset->FindBodyIndex(Constraint->ConstraintBone1) == INDEX_NONE || PhysicsAsset->FindBodyIndex(Constraint->ConstraintBone2) == INDEX_NONE) {
+		LGE("One or more bodies not found in physics asset")
+		return false; }
+
+	FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, ConstraintIndex);
+	FVector Pos1 = Pose.GetBoneLocation(Constraint->ConstraintBone1);
+	FVector Pos2 = Pose.GetBoneLocation(Constraint->ConstraintBone2);
+	FTransform xform1 = Constraint->GetRefFrame(EConstraintFrame::Frame1);
+	FTransform xform2 = Constraint->GetRefFrame(EConstraintFrame::Frame2);
+	
+	FVector PosFinal = FMath::Lerp(xform1.GetLocation(), xform2.GetLocation(), PositionBlend);
+	FTransform xformFinal = FTransform(PosFinal);
+	Constraint->SetRefFrame(EConstraintFrame::Frame1, xform1.GetRelativeTransform(xformFinal));
+	Constraint->SetRefFrame(EConstraintFrame::Frame2, xform2.GetRelativeTransform(xformFinal));
+	Constraint->PhysScene = nullptr;
+	Constraint->ConstraintHandle.Reset();
+	LG("Constraint %s position set to %s;  %s;  %s", *Constraint->JointName.ToString(), *(PosFinal - Pos1).ToCompactString(), *(PosFinal - Pos2).ToCompactString(), *PosFinal.ToCompactString())
+	LG("  Pos1 %s;  Pos2 %s", *(Constraint->Pos1).ToCompactString(), *(Constraint->Pos2).ToCompactString())
+	return true;
+}
 
 bool UPhysicsEditorBPLibrary::AlignConstraint(USkeletalMeshComponent* SkelMesh, int32 ConstraintIndex,
 	float PositionBlend, float OrientationBlend)
 {
-	if(UPhysicsAsset* PhysicsAsset = SkelMesh->GetPhysicsAsset())
-	{
-		if(UPhysicsConstraintTemplate* Setup = PhysicsAsset->ConstraintSetup[ConstraintIndex])
-		{
-			if(FConstraintInstance* Constraint = &Setup->DefaultInstance)
-			{
-				FBodyInstance* Body1 = SkelMesh->GetBodyInstance(Constraint->ConstraintBone1);
-				FBodyInstance* Body2 = SkelMesh->GetBodyInstance(Constraint->ConstraintBone2);
-				if(Body1 && Body2)
-				{
-					FVector Pos1 = SkelMesh->GetBoneLocation(SkelMesh->GetBoneName(Body1->InstanceBoneIndex));
-					FVector Pos2 = SkelMesh->GetBoneLocation(SkelMesh->GetBoneName(Body2->InstanceBoneIndex));
-					FTransform xform1 = Constraint->GetRefFrame(EConstraintFrame::Frame1);
-					FTransform xform2 = Constraint->GetRefFrame(EConstraintFrame::Frame2);
-					
-					FVector PosFinal = FMath::Lerp(xform1.GetLocation(), xform2.GetLocation(), PositionBlend);
-					FTransform xformFinal = FTransform(PosFinal);
-					Constraint->SetRefFrame(EConstraintFrame::Frame1, xform1.GetRelativeTransform(xformFinal));
-					Constraint->SetRefFrame(EConstraintFrame::Frame2, xform2.GetRelativeTransform(xformFinal));
-					// Constraint->SetRefPosition(EConstraintFrame::Frame1, );
-					// Constraint->SetRefPosition(EConstraintFrame::Frame2, PosFinal - Pos2);
-					Constraint->PhysScene = nullptr;
-					Constraint->ConstraintHandle.Reset();
-					// PhysicsAsset->ConstraintSetup[Constraint.ConstraintIndex]->DefaultInstance = Constraint;
-					LG("Constraint %s position set to %s;  %s;  %s", *Constraint->JointName.ToString(), *(PosFinal - Pos1).ToCompactString(), *(PosFinal - Pos2).ToCompactString(), *PosFinal.ToCompactString())
-					LG("  Pos1 %s;  Pos2 %s", *(Constraint->Pos1).ToCompactString(), *(Constraint->Pos2).ToCompactString())
-					
-					return true;
-				}
-			}
-			LGE("One or more bodies not found in physics asset")
-			return false;
-		}
-	}
-	LGE("Physics asset not found");
-	return false;
+	return AlignConstraintInternal(SkelMesh ? SkelMesh->GetPhysicsAsset() : nullptr, FBonePose::FromComponent(SkelMesh), ConstraintIndex, PositionBlend);
+}
+
+bool UPhysicsEditorBPLibrary::AlignConstraint(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, int32 ConstraintIndex,
+	float PositionBlend, float OrientationBlend)
+{
+	return AlignConstraintInternal(PhysicsAsset, FBonePose::FromRefPose(SkeletalMesh), ConstraintIndex, PositionBlend);
 }
 
 USkeletalMeshComponent* UPhysicsEditorBPLibrary::GetSkelMeshComponent(FPersonaAssetEditorToolkit* PhysicsAssetEditor)
@@ -137,38 +224,90 @@ USkeletalMeshComponent* UPhysicsEditorBPLibrary::GetSkelMeshComponent(FPersonaAs
 	return nullptr;
 }
 
-bool UPhysicsEditorBPLibrary::AdjustConstraints(USkeletalMeshComponent* SkelMeshComp, FAdjustConstraintsOptions Options,
-                                                TArray<FName> JointNames = TArray<FName>())
+static bool AdjustConstraintsInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose, const FAdjustConstraintsOptions& Options,
+                                      const TArray<FName>& InJointNames)
 {
+	if(!PhysicsAsset || !Pose.IsValid()) {
+		LGE("Physics asset not found")
+		return false; }
 	
-	if(UPhysicsAsset* PhysicsAsset = SkelMeshComp->GetPhysicsAsset())
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "AdjustConstraints", "Adjust Constraints"));
+	TArray<FName> MatchedNames;
+	if(InJointNames.IsEmpty())
 	{
-		if(JointNames.IsEmpty())
-		{
-			PhysicsAsset->BodySetupIndexMap.GetKeys(JointNames);
-			JointNames = FilterNames(JointNames, Options.MatchChildBodyRegex);
-		}
-		for(int i = 0; auto ConstraintTemplate : PhysicsAsset->ConstraintSetup)
-		{
-			if(!ConstraintTemplate)
-				continue;
-			auto Constraint = ConstraintTemplate->DefaultInstance;
-			{
-				if(JointNames.Contains(Constraint.JointName))
-				{
-					LG("    Adjusting Constraint: %s", *Constraint.JointName.ToString())	
-					AlignConstraint(SkelMeshComp, i, Options.PositionRatio, 0.f);
-				}
-			}
-			i++;
-		}
-		UEditorAssetLibrary::SaveLoadedAsset(PhysicsAsset, false);
+		PhysicsAsset->BodySetupIndexMap.GetKeys(MatchedNames);
+		MatchedNames = UPhysicsEditorBPLibrary::FilterNames(MatchedNames, Options.MatchChildBodyRegex);
 	}
+	const TArray<FName>& JointNames = InJointNames.IsEmpty() ? MatchedNames : InJointNames;
+	const TSet<FName> JointSet(JointNames);
 
-	return false;
+	struct FConstraintJob
+	{
+		int32 ConstraintIndex;
+		int32 BoneIndex1;
+		int32 BoneIndex2;
+		FTransform Frame1;
+		FTransform Frame2;
+		FVector PosFinal;
+	};
+	TArray<FConstraintJob> Jobs;
+	Jobs.Reserve(JointSet.Num());
+	for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+	{
+		const UPhysicsConstraintTemplate* ConstraintTemplate = PhysicsAsset->ConstraintSetup[i];
+		if(!ConstraintTemplate || !JointSet.Contains(ConstraintTemplate->DefaultInstance.JointName))
+			continue;
+		const FConstraintInstance& Constraint = ConstraintTemplate->DefaultInstance;
+		const int32 BoneIndex1 = Pose.GetBoneIndex(Constraint.ConstraintBone1);
+		const int32 BoneIndex2 = Pose.GetBoneIndex(Constraint.ConstraintBone2);
+		if(PhysicsAsset->FindBodyIndex(Constraint.ConstraintBone1) == INDEX_NONE || PhysicsAsset->FindBodyIndex(Constraint.ConstraintBone2) == INDEX_NONE
+			|| !Pose.ComponentSpace.IsValidIndex(BoneIndex1) || !Pose.ComponentSpace.IsValidIndex(BoneIndex2)) {
+			LGE("One or more bodies of constraint %s not found", *Constraint.JointName.ToString())
+			continue; }
+		Jobs.Add({i, BoneIndex1, BoneIndex2, Constraint.GetRefFrame(EConstraintFrame::Frame1), Constraint.GetRefFrame(EConstraintFrame::Frame2)});
+	}
+
+	const float PositionBlend = Options.PositionRatio;
+	ParallelFor(Jobs.Num(), [&Jobs, PositionBlend](int32 JobIndex)
+	{
+		FConstraintJob& Job = Jobs[JobIndex];
+		Job.PosFinal = FMath::Lerp(Job.Frame1.GetLocation(), Job.Frame2.GetLocation(), PositionBlend);
+		const FTransform xformFinal = FTransform(Job.PosFinal);
+		Job.Frame1 = Job.Frame1.GetRelativeTransform(xformFinal);
+		Job.Frame2 = Job.Frame2.GetRelativeTransform(xformFinal);
+	});
+
+	for(const FConstraintJob& Job : Jobs)
+	{
+		FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, Job.ConstraintIndex);
+		FConstraintInstance& Constraint = PhysicsAsset->ConstraintSetup[Job.ConstraintIndex]->DefaultInstance;
+		Constraint.SetRefFrame(EConstraintFrame::Frame1, Job.Frame1);
+		Constraint.SetRefFrame(EConstraintFrame::Frame2, Job.Frame2);
+		Constraint.PhysScene = nullptr;
+		Constraint.ConstraintHandle.Reset();
+		LG("    Adjusting Constraint: %s position set to %s;  %s;  %s", *Constraint.JointName.ToString(),
+		   *(Job.PosFinal - Pose.GetBoneTransform(Job.BoneIndex1).GetLocation()).ToCompactString(),
+		   *(Job.PosFinal - Pose.GetBoneTransform(Job.BoneIndex2).GetLocation()).ToCompactString(),
+		   *Job.PosFinal.ToCompactString())
+	}
+	PhysicsAsset->MarkPackageDirty();
+	FScopedPackageSave::RequestSave(PhysicsAsset);
+	return true;
+}
+
+bool UPhysicsEditorBPLibrary::AdjustConstraints(USkeletalMeshComponent* SkelMeshComp, const FAdjustConstraintsOptions& Options,
+                                                const TArray<FName>& JointNames)
+{
+	return AdjustConstraintsInternal(SkelMeshComp ? SkelMeshComp->GetPhysicsAsset() : nullptr, FBonePose::FromComponent(SkelMeshComp), Options, JointNames);
 }
 
-bool UPhysicsEditorBPLibrary::AdjustPointBody(USkeletalMeshComponent* SkelMeshComp, FAdjustBodiesOptions Options, FName BodyName)
+bool UPhysicsEditorBPLibrary::AdjustConstraintsFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+                                                           const FAdjustConstraintsOptions& Options, const TArray<FName>& JointNames)
+{
+	return AdjustConstraintsInternal(PhysicsAsset, FBonePose::FromRefPose(SkeletalMesh), Options, JointNames);
+}
+
+bool UPhysicsEditorBPLibrary::AdjustPointBody(USkeletalMeshComponent* SkelMeshComp, const FAdjustBodiesOptions& Options, FName BodyName)
 {
 	if(auto PhysicsAsset = SkelMeshComp->GetPhysicsAsset())
 	{
@@ -178,6 +317,7 @@ bool UPhysicsEditorBPLibrary::AdjustPointBody(USkeletalMeshComponent* SkelMeshCo
 			auto BodySetup = PhysicsAsset->SkeletalBodySetups[*BodyIndex];
 			if(BodySetup)
 			{
+				FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, *BodyIndex);
 				auto BoneXform = SkelMeshComp->GetBoneTransform(BodySetup->BoneName);
 				auto ParentXform = SkelMeshComp->GetBoneTransform(SkelMeshComp->GetParentBone(BodySetup->BoneName));
 				float Distance = FVector::Dist(BoneXform.GetLocation(), ParentXform.GetLocation());
@@ -196,27 +336,98 @@ bool UPhysicsEditorBPLibrary::AdjustPointBody(USkeletalMeshComponent* SkelMeshCo
 	return false;
 }
 
-bool UPhysicsEditorBPLibrary::AdjustBodies(USkeletalMeshComponent* SkelMeshComp, FAdjustBodiesOptions Options,
-                                           TArray<FName> BodyNames = TArray<FName>())
+static bool AdjustBodiesInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose, const FAdjustBodiesOptions& Options,
+                                 const TArray<FName>& InBodyNames)
 {
-	if(UPhysicsAsset* PhysicsAsset = SkelMeshComp->GetPhysicsAsset())
+	if(!PhysicsAsset || !Pose.IsValid())
+		return false;
+	
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "AdjustBodies", "Adjust Bodies"));
+	TArray<FName> MatchedNames;
+	if(InBodyNames.IsEmpty())
 	{
-		
-		if(BodyNames.IsEmpty())
-		{
-			PhysicsAsset->BodySetupIndexMap.GetKeys(BodyNames);
-			BodyNames = FilterNames(BodyNames, Options.MatchBodyRegex);
-		}
-		for(auto BodyName : BodyNames)
+		PhysicsAsset->BodySetupIndexMap.GetKeys(MatchedNames);
+		MatchedNames = UPhysicsEditorBPLibrary::FilterNames(MatchedNames, Options.MatchBodyRegex);
+	}
+	const TArray<FName>& BodyNames = InBodyNames.IsEmpty() ? MatchedNames : InBodyNames;
+
+	struct FBodyJob
+	{
+		int32 BodyIndex;
+		int32 BoneIndex;
+		int32 ParentBoneIndex;
+		FVector Center;
+		float Radius;
+		bool bOnSkin;
+	};
+	TArray<FBodyJob> Jobs;
+	Jobs.Reserve(BodyNames.Num());
+	for(const FName& BodyName : BodyNames)
+	{
+		const int32* BodyIndex = PhysicsAsset->BodySetupIndexMap.Find(BodyName);
+		const USkeletalBodySetup* BodySetup = BodyIndex ? PhysicsAsset->SkeletalBodySetups[*BodyIndex].Get() : nullptr;
+		const int32 BoneIndex = BodySetup ? Pose.GetBoneIndex(BodySetup->BoneName) : INDEX_NONE;
+		if(!Pose.ComponentSpace.IsValidIndex(BoneIndex))
+			continue;
+		Jobs.Add({*BodyIndex, BoneIndex, Pose.RefSkeleton->GetParentIndex(BoneIndex)});
+	}
+
+	const FSkinSurface* Skin = Options.FitMode == EBodyFitMode::SkinSurface ? Pose.SkinSurface.Get() : nullptr;
+	if(Options.FitMode == EBodyFitMode::SkinSurface && !Skin)
+		LGW("No skin surface in the pose, fitting bodies by bone ratio")
+	ParallelFor(Jobs.Num(), [&Jobs, &Pose, &Options, Skin](int32 JobIndex)
+	{
+		FBodyJob& Job = Jobs[JobIndex];
+		const FTransform BoneXform = Pose.GetBoneTransform(Job.BoneIndex);
+		FVector SkinPoint, SkinNormal;
+		Job.bOnSkin = Skin && Skin->FindNearest(BoneXform.GetLocation(), SkinPoint, SkinNormal);
+		if(Job.bOnSkin)
 		{
-			LG("    Adjusting Body: %s", *BodyName.ToString())	
-			AdjustPointBody(SkelMeshComp, Options, BodyName);
+			// Point the normal away from the bone, whatever the winding. Depth is how far the bone sits under the skin.
+			const FVector ToSkin = SkinPoint - BoneXform.GetLocation();
+			if(FVector::DotProduct(ToSkin, SkinNormal) < 0.f)
+				SkinNormal = -SkinNormal;
+			const float Depth = FVector::DotProduct(ToSkin, SkinNormal);
+			// Fill the span from the bone out to SkinDepth under the skin
+			Job.Radius = FMath::Max(Options.MinRadius, .5f * (Depth - Options.SkinDepth));
+			if(Options.MaxRadius > 0.f)
+				Job.Radius = FMath::Min(Job.Radius, Options.MaxRadius);
+			Job.Center = BoneXform.InverseTransformPosition(SkinPoint - SkinNormal * (Options.SkinDepth + Job.Radius));
+			return;
 		}
-		PhysicsAsset->MarkPackageDirty();
-		// UEditorAssetLibrary::SaveLoadedAsset(PhysicsAsset, false);
-		return true;
+		const FTransform ParentXform = Job.ParentBoneIndex != INDEX_NONE ? Pose.GetBoneTransform(Job.ParentBoneIndex) : Pose.ComponentToWorld;
+		const FVector PosFinal = FMath::Lerp(BoneXform.GetLocation(), ParentXform.GetLocation(), Options.PositionRatio);
+		Job.Center = BoneXform.InverseTransformPosition(PosFinal);
+		Job.Radius = Options.RadiusRatio * FVector::Dist(BoneXform.GetLocation(), ParentXform.GetLocation());
+	});
+
+	for(const FBodyJob& Job : Jobs)
+	{
+		FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, Job.BodyIndex);
+		USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[Job.BodyIndex];
+		if(!BodySetup->AggGeom.SphereElems.IsValidIndex(0))
+			BodySetup->AggGeom.SphereElems.Add(FKSphereElem());
+		BodySetup->AggGeom.SphereElems[0].Center = Job.Center;
+		BodySetup->AggGeom.SphereElems[0].Radius = Job.Radius;
+		LG("    Adjusting Body: %s center %s radius %.2f%s", *BodySetup->BoneName.ToString(), *Job.Center.ToCompactString(), Job.Radius,
+		   Job.bOnSkin ? TEXT(" (skin)") : TEXT(""))
 	}
-	return false;
+	PhysicsAsset->MarkPackageDirty();
+	// UEditorAssetLibrary::SaveLoadedAsset(PhysicsAsset, false);
+	return true;
+}
+
+bool UPhysicsEditorBPLibrary::AdjustBodies(USkeletalMeshComponent* SkelMeshComp, const FAdjustBodiesOptions& Options,
+                                           const TArray<FName>& BodyNames)
+{
+	return AdjustBodiesInternal(SkelMeshComp ? SkelMeshComp->GetPhysicsAsset() : nullptr,
+	                            FBonePose::FromComponent(SkelMeshComp, Options.FitMode == EBodyFitMode::SkinSurface), Options, BodyNames);
+}
+
+bool UPhysicsEditorBPLibrary::AdjustBodiesFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+                                                      const FAdjustBodiesOptions& Options, const TArray<FName>& BodyNames)
+{
+	return AdjustBodiesInternal(PhysicsAsset, FBonePose::FromRefPose(SkeletalMesh, Options.FitMode == EBodyFitMode::SkinSurface), Options, BodyNames);
 }
 
 USkeletalMeshComponent* UPhysicsEditorBPLibrary::FocusOrOpenPhysAssetEditor(UPhysicsAsset* PhysicsAsset)
@@ -244,11 +455,12 @@ USkeletalMeshComponent* UPhysicsEditorBPLibrary::FocusOrOpenPhysAssetEditor(UPhy
 	return nullptr;
 }
 
-bool UPhysicsEditorBPLibrary::ApplyConstraintParams(UPhysicsAsset* PhysicsAsset, FConstraintParams Params)
+bool UPhysicsEditorBPLibrary::ApplyConstraintParams(UPhysicsAsset* PhysicsAsset, const FConstraintParams& Params)
 {
 		int32 Index = PhysicsAsset->FindConstraintIndex(Params.JointName);
 		if(Index != INDEX_NONE)
 		{
+			FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, Index);
 			auto Constraint = PhysicsAsset->ConstraintSetup[Index];
 			float Mass = 0.f;
 			int BodyIndex = PhysicsAsset->FindBodyIndex(Params.ConstraintBone1);
@@ -297,16 +509,22 @@ bool UPhysicsEditorBPLibrary::ApplyConstraintParams(UPhysicsAsset* PhysicsAsset,
 	return false;
 }
 
-bool UPhysicsEditorBPLibrary::ApplyAllConstraintOptions(UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions Options)
+static void ApplyConstraintParamsList(UPhysicsAsset* PhysicsAsset, const TArray<FConstraintParams>& ParamsList)
 {
-	for (auto ConstraintParams : Options.AllConstraintParams)
+	for(const FConstraintParams& ConstraintParams : ParamsList)
 	{
-		int32 Index = MakeNewConstraint(PhysicsAsset, ConstraintParams);
+		int32 Index = UPhysicsEditorBPLibrary::MakeNewConstraint(PhysicsAsset, ConstraintParams);
 		if(Index != INDEX_NONE)
 		{
-			ApplyConstraintParams(PhysicsAsset, ConstraintParams);
+			UPhysicsEditorBPLibrary::ApplyConstraintParams(PhysicsAsset, ConstraintParams);
 		}
 	}
+}
+
+bool UPhysicsEditorBPLibrary::ApplyAllConstraintOptions(UPhysicsAsset* PhysicsAsset, const FPhatConstraintOptions& Options)
+{
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "ApplyAllConstraintOptions", "Apply Constraint Options"));
+	ApplyConstraintParamsList(PhysicsAsset, Options.AllConstraintParams);
 	return true;
 }
 
@@ -314,49 +532,58 @@ bool UPhysicsEditorBPLibrary::ApplyAllConstraintOptions(UPhysicsAsset* PhysicsAs
 
 bool UPhysicsEditorBPLibrary::GetConstraintParams(UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex, FConstraintParams& OutParams)
 {
-	if(PhysicsAsset && ConstraintIndex < PhysicsAsset->ConstraintSetup.Num())
+	if(PhysicsAsset && PhysicsAsset->ConstraintSetup.IsValidIndex(ConstraintIndex))
 	{
-		float _;
 		const auto Constraint = PhysicsAsset->ConstraintSetup[ConstraintIndex];
-
 		int BodyIndex = PhysicsAsset->FindBodyIndex(Constraint->DefaultInstance.ConstraintBone1);
-		float Mass = PhysicsAsset->SkeletalBodySetups[BodyIndex]->CalculateMass();
-		
-		OutParams.RefFrameNoScale1 = Constraint->DefaultInstance.GetRefFrame(EConstraintFrame::Frame1);
-		OutParams.RefFrameNoScale2 = Constraint->DefaultInstance.GetRefFrame(EConstraintFrame::Frame2);
-		
-		OutParams.LinearLimitedX  = Constraint->DefaultInstance.GetLinearXMotion();
-		OutParams.LinearLimitedY  = Constraint->DefaultInstance.GetLinearYMotion();
-		OutParams.LinearLimitedZ  = Constraint->DefaultInstance.GetLinearZMotion();
-		OutParams.LinearLimit = Constraint->DefaultInstance.GetLinearLimit();
-		Constraint->DefaultInstance.GetLinearDriveParams(OutParams.LinearStrength, _, _);
-		OutParams.LinearStrengthMassMultiplier = OutParams.LinearStrength / Mass;
-		OutParams.LinearTarget = Constraint->DefaultInstance.GetLinearPositionTarget();
-		
-		Constraint->DefaultInstance.GetAngularDriveParams(OutParams.AngularStrength, _, _);
-		OutParams.AngularStrengthMassMultiplier = OutParams.AngularStrength / Mass;
-		OutParams.AngularTarget = Constraint->DefaultInstance.GetAngularOrientationTarget();
-		OutParams.bSlerp = Constraint->DefaultInstance.GetAngularDriveMode() == EAngularDriveMode::SLERP;
-		OutParams.TwistLimited = Constraint->DefaultInstance.GetAngularTwistMotion();
-		OutParams.TwistLimit = Constraint->DefaultInstance.GetAngularTwistLimit();
-		OutParams.Swing1Limited = Constraint->DefaultInstance.GetAngularSwing1Motion();
-		OutParams.Swing1Limit = Constraint->DefaultInstance.GetAngularSwing1Limit();
-		OutParams.Swing2Limited = Constraint->DefaultInstance.GetAngularSwing2Motion();
-		OutParams.Swing2Limit = Constraint->DefaultInstance.GetAngularSwing2Limit();
-		
+		float Mass = BodyIndex != INDEX_NONE ? PhysicsAsset->SkeletalBodySetups[BodyIndex]->CalculateMass() : 0.f;
+		ReadConstraintParams(Constraint->DefaultInstance, Mass, OutParams);
 		return true;
 	}
 	return false;
 }
 
+void UPhysicsEditorBPLibrary::ReadConstraintParams(const FConstraintInstance& Instance, float ChildMass, FConstraintParams& OutParams)
+{
+	float _;
+	OutParams.JointName = Instance.JointName;
+	OutParams.ConstraintBone1 = Instance.ConstraintBone1;
+	OutParams.ConstraintBone2 = Instance.ConstraintBone2;
+	
+	OutParams.RefFrameNoScale1 = Instance.GetRefFrame(EConstraintFrame::Frame1);
+	OutParams.RefFrameNoScale2 = Instance.GetRefFrame(EConstraintFrame::Frame2);
+	
+	OutParams.LinearLimitedX  = Instance.GetLinearXMotion();
+	OutParams.LinearLimitedY  = Instance.GetLinearYMotion();
+	OutParams.LinearLimitedZ  = Instance.GetLinearZMotion();
+	OutParams.LinearLimit = Instance.GetLinearLimit();
+	Instance.GetLinearDriveParams(OutParams.LinearStrength, _, _);
+	OutParams.LinearStrengthMassMultiplier = ChildMass > 0.f ? OutParams.LinearStrength / ChildMass : 0.f;
+	OutParams.LinearTarget = Instance.GetLinearPositionTarget();
+	
+	Instance.GetAngularDriveParams(OutParams.AngularStrength, _, _);
+	OutParams.AngularStrengthMassMultiplier = ChildMass > 0.f ? OutParams.AngularStrength / ChildMass : 0.f;
+	OutParams.AngularTarget = Instance.GetAngularOrientationTarget();
+	OutParams.bSlerp = Instance.GetAngularDriveMode() == EAngularDriveMode::SLERP;
+	OutParams.TwistLimited = Instance.GetAngularTwistMotion();
+	OutParams.TwistLimit = Instance.GetAngularTwistLimit();
+	OutParams.Swing1Limited = Instance.GetAngularSwing1Motion();
+	OutParams.Swing1Limit = Instance.GetAngularSwing1Limit();
+	OutParams.Swing2Limited = Instance.GetAngularSwing2Motion();
+	OutParams.Swing2Limit = Instance.GetAngularSwing2Limit();
+}
+
 bool UPhysicsEditorBPLibrary::GetAllConstraintParams(UPhysicsAsset* PhysicsAsset, TArray<FConstraintParams>& OutParams,
-	TArray<FName> ConstraintNames = TArray<FName>())
+	const TArray<FName>& ConstraintNames)
 {
-	bool bAll = !ConstraintNames.IsEmpty();
-	for(int i=0;i<ConstraintNames.Num();i++)
+	if(!PhysicsAsset) {
+		LGE("Physics asset not found")
+		return false; }
+	const bool bAll = ConstraintNames.IsEmpty();
+	for(int i=0;i<PhysicsAsset->ConstraintSetup.Num();i++)
 	{
 		auto Constraint = PhysicsAsset->ConstraintSetup[i];
-		if(bAll || ConstraintNames.Contains(Constraint->DefaultInstance.JointName))
+		if(Constraint && (bAll || ConstraintNames.Contains(Constraint->DefaultInstance.JointName)))
 		{
 			FConstraintParams Param;
 			if(GetConstraintParams(PhysicsAsset, i, Param))
@@ -372,11 +599,11 @@ bool UPhysicsEditorBPLibrary::GetAllConstraintParams(UPhysicsAsset* PhysicsAsset
 // TArray<FConstraintParams>& UPhysicsEditorBPLibrary::SelectConstraints(UPhysicsAsset* PhysicsAsset, TArray<FConstraintParams>& Options)
 
 bool UPhysicsEditorBPLibrary::ScaleConstraintsByMass(UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions& PhatConstraintOptions,
-                                                     TArray<FName> ConstraintNames, float ScaleFactor = .025f)
+                                                     const TArray<FName>& ConstraintNames, float ScaleFactor = .025f)
 {
 	// for(auto Option : Options)
 	// for(int i=0; i<Options.Num(); i++)
-	for(auto Name : ConstraintNames)
+	for(const FName& Name : ConstraintNames)
 	{
 		if(auto ConstraintOptions = PhatConstraintOptions.ConstraintParamsByName.Find(Name))
 		{
@@ -394,62 +621,55 @@ bool UPhysicsEditorBPLibrary::ScaleConstraintsByMass(UPhysicsAsset* PhysicsAsset
 	return true;	
 }
 
-bool UPhysicsEditorBPLibrary::MirrorConstraintOptions(UPhysicsAsset* PhysicsAsset, TArray<FName> ConstraintNames,
-                                                      FPhatConstraintOptions Options, bool bRightToLeft)
+bool UPhysicsEditorBPLibrary::MirrorConstraintOptions(UPhysicsAsset* PhysicsAsset, const TArray<FName>& ConstraintNames,
+                                                      const FPhatConstraintOptions& Options, bool bRightToLeft)
 {
-	FString Suffix = bRightToLeft ? "_r" : "_l"; 
-	FString MirrorSuffix = !bRightToLeft ? "_r" : "_l"; 
-	FConstraintParams Params = FConstraintParams();
+	FBilateralSymmetryMap SymmetryMap;
+	if(!SymmetryMap.Build(PhysicsAsset))
+		return false;
 	
-	if(PhysicsAsset)
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "MirrorConstraints", "Mirror Constraints"));
+	const ESymmetrySide SourceSide = bRightToLeft ? ESymmetrySide::Right : ESymmetrySide::Left;
+	int32 NumMirrored = 0;
+	for(const FName& Name : ConstraintNames)
 	{
-		for(FName Name : ConstraintNames)
-		{
-			if(Name.ToString().EndsWith(Suffix))
-			{
-				int32 Index = PhysicsAsset->FindConstraintIndex(Name);
-				if(Index != INDEX_NONE)
-				{
-					if(GetConstraintParams(PhysicsAsset, Index, Params))
-					{
-						FName MirrorName = FName(Name.ToString().LeftChop(2) + MirrorSuffix);
-						int32 MirrorIndex = PhysicsAsset->FindConstraintIndex(MirrorName);
-						if(MirrorIndex != INDEX_NONE)
-						{
-							auto MirrorConstraint = PhysicsAsset->ConstraintSetup[MirrorIndex];
-							Params.JointName = MirrorConstraint->DefaultInstance.JointName;
-							Params.ConstraintBone1 = MirrorConstraint->DefaultInstance.ConstraintBone1;
-							Params.ConstraintBone2 = MirrorConstraint->DefaultInstance.ConstraintBone2;
-							ApplyConstraintParams(PhysicsAsset, Params);
-							// Options.AllConstraintParams.Add(Params);
-						}
-						LGE("Mirror bone not found for %s", *Name.ToString())
-						
-					}
-				}
-			}
-		}
-		// return ApplyAllConstraintOptions(PhysicsAsset, Options);
+		const int32* Index = SymmetryMap.ConstraintIndexMap.Find(Name);
+		if(!Index || SymmetryMap.ConstraintSide[*Index] != SourceSide)
+			continue;
+		if(SymmetryMap.CopyConstraintProfile(PhysicsAsset, *Index))
+			NumMirrored++;
+		else
+			LGE("Mirror constraint not found for %s", *Name.ToString())
 	}
-	return false;
+	LG("Mirrored %d constraints", NumMirrored)
+	return NumMirrored > 0;
 }
 
-bool UPhysicsEditorBPLibrary::CopyConstraintOptions(UPhysicsAsset* PhysicsAsset, UPhysicsAsset* SourcePhysicsAsset, FPhatConstraintOptions Options)
+bool UPhysicsEditorBPLibrary::RetargetConstraints(UPhysicsAsset* SourcePhysicsAsset, const TArray<UPhysicsAsset*>& TargetPhysicsAssets,
+                                                  const FConstraintRetargetOptions& Options, FConstraintRetargetReport& OutReport)
 {
-	FConstraintParams ConstraintOptions;
-	for(FName Name : Options.ConstraintsToCopy)
+	return ConstraintRetarget::Retarget(SourcePhysicsAsset, TargetPhysicsAssets, Options, OutReport);
+}
+
+bool UPhysicsEditorBPLibrary::CopyConstraintOptions(UPhysicsAsset* PhysicsAsset, UPhysicsAsset* SourcePhysicsAsset, const FPhatConstraintOptions& Options)
+{
+	// Only the copied params are collected, the option struct is applied as is
+	TArray<FConstraintParams> CopiedParams;
+	CopiedParams.Reserve(Options.ConstraintsToCopy.Num());
+	for(const FName& Name : Options.ConstraintsToCopy)
 	{
 		int32 Index = SourcePhysicsAsset->FindConstraintIndex(Name);
-		if(Index != INDEX_NONE)
-		{
-			if(GetConstraintParams(SourcePhysicsAsset, Index, ConstraintOptions))
-				Options.AllConstraintParams.Add(ConstraintOptions);
-		}
+		FConstraintParams ConstraintOptions;
+		if(Index != INDEX_NONE && GetConstraintParams(SourcePhysicsAsset, Index, ConstraintOptions))
+			CopiedParams.Add(MoveTemp(ConstraintOptions));
 	}
-	return ApplyAllConstraintOptions(PhysicsAsset, Options);
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "ApplyAllConstraintOptions", "Apply Constraint Options"));
+	ApplyConstraintParamsList(PhysicsAsset, Options.AllConstraintParams);
+	ApplyConstraintParamsList(PhysicsAsset, CopiedParams);
+	return true;
 }
 
-inline int32 GetClosestPoint(FTransform Transform, TArray<FTransform> Points)
+inline int32 GetClosestPoint(const FTransform& Transform, const TArray<FTransform>& Points)
 {
 	float min_dist = MAX_FLT;
 	float min_index = -1;
@@ -467,42 +687,33 @@ inline int32 GetClosestPoint(FTransform Transform, TArray<FTransform> Points)
 
 inline FName BreastSpokeName(int32 Spoke, int32 Side)
 {
-	char buffer[40];
-	sprintf_s(buffer,"breast_pt_%02d_%c", Spoke, Side == 0 ? 'l' : 'r');
-	return FName(buffer);
+	return JointNames::MakeSidedName(TEXT("breast_pt"), {Spoke}, Side);
 }
 
 inline FName BreastPtName(int32 Spoke, int32 Point, int32 Side)
 {
-	char buffer[40];
-	sprintf_s(buffer,"breast_pt_%02d_%02d_%c", Spoke, Point, Side == 0 ? 'l' : 'r');
-	return FName(buffer);
+	return JointNames::MakeSidedName(TEXT("breast_pt"), {Spoke, Point}, Side);
 }
-inline FName BreastConstraintName(int32 Spoke, int32 Point, int32 Side, const FString& Kind)
+inline FName BreastConstraintName(int32 Spoke, int32 Point, int32 Side, const TCHAR* Kind)
 {
-	char buffer[40];
-	sprintf_s(buffer,"breast_%ls_%02d_%02d_%c", *Kind, Spoke, Point, Side == 0 ? 'l' : 'r');
-	return FName(buffer);
+	TStringBuilder<32> Prefix;
+	Prefix << TEXT("breast_") << Kind;
+	return JointNames::MakeSidedName(*Prefix, {Spoke, Point}, Side);
 }
 inline FName BreastBoneName(int32 Number, int32 Side)
 {
-	char buffer[40];
-	sprintf_s(buffer,"breast_%02d_%c", Number, Side == 0 ? 'l' : 'r');
-	return FName(buffer);
+	return JointNames::MakeSidedName(TEXT("breast"), {Number}, Side);
 }
 
 
-TArray<int32> UPhysicsEditorBPLibrary::AddPointToParentConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
-                                                                   FAddPointConstraints Options, TArray<FName> ChildBodies)
+static TArray<int32> AddPointToParentConstraintsInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose,
+                                                         const FAddPointConstraints& Options, const TArray<FName>& ChildBodies)
 {
 	TArray<int32> NewConstraintIndexes = TArray<int32>();
 	
-	TArray<FName> BodyNames;
-	UPhysicsAsset* PhysicsAsset = SkeletalMeshComponent->GetPhysicsAsset();
-	PhysicsAsset->BodySetupIndexMap.GetKeys(BodyNames);
-	for(auto BodyName : ChildBodies)
+	for(const FName& BodyName : ChildBodies)
 	{
-		FName ParentBone = SkeletalMeshComponent->GetParentBone(BodyName);
+		FName ParentBone = Pose.GetParentBone(BodyName);
 		if(ParentBone == NAME_None)
 		{
 			LGE("No parent bone found for body: %s", *BodyName.ToString())
@@ -512,8 +723,8 @@ TArray<int32> UPhysicsEditorBPLibrary::AddPointToParentConstraints(USkeletalMesh
 		Params.ConstraintBone1 = BodyName;
 		Params.ConstraintBone2 = ParentBone;
 		Params.JointName = BodyName;
-		LG("      Added parent constraint %s -> %s", *Params.ConstraintBone1.ToString(), *Params.ConstraintBone2.ToString())
-		int32 NewIndex = MakeNewConstraint(PhysicsAsset, Params);
+		LGV("      Added parent constraint %s -> %s", *Params.ConstraintBone1.ToString(), *Params.ConstraintBone2.ToString())
+		int32 NewIndex = UPhysicsEditorBPLibrary::MakeNewConstraint(PhysicsAsset, Params);
 		if(NewIndex != INDEX_NONE)
 		{
 			NewConstraintIndexes.Add(NewIndex);
@@ -523,34 +734,97 @@ TArray<int32> UPhysicsEditorBPLibrary::AddPointToParentConstraints(USkeletalMesh
 	return NewConstraintIndexes;
 }
 
-TArray<int32> UPhysicsEditorBPLibrary::AddClosestPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
-                                                            FConstraintParams DefaultParams,
-                                                            TArray<FName> TargetBodies,
-                                                            TArray<FName> SourceBodies = TArray<FName>(),
-                                                            int32 NumClosestPoints = 3,
-                                                            bool bExtraBones = false,
-                                                            TArray<int32> ClosestBones = TArray<int32>())
+TArray<int32> UPhysicsEditorBPLibrary::AddPointToParentConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
+                                                                   const FAddPointConstraints& Options, const TArray<FName>& ChildBodies)
+{
+	return AddPointToParentConstraintsInternal(SkeletalMeshComponent->GetPhysicsAsset(), FBonePose::FromComponent(SkeletalMeshComponent),
+	                                           Options, ChildBodies);
+}
+
+/** Renames the pair's constraint from a name older versions gave it, so regenerating finds it instead of adding a second one */
+static void MigrateLegacyPairName(UPhysicsAsset* PhysicsAsset, FName ChildBone, FName ParentBone, FName JointName)
+{
+	if(PhysicsAsset->FindConstraintIndex(JointName) != INDEX_NONE)
+		return;
+	TArray<FName, TInlineAllocator<3>> LegacyNames;
+	JointNames::FindLegacyPairNames(ChildBone, ParentBone, LegacyNames);
+	for(const FName& LegacyName : LegacyNames)
+	{
+		const int32 ConstraintIndex = PhysicsAsset->FindConstraintIndex(LegacyName);
+		if(ConstraintIndex == INDEX_NONE)
+			continue;
+		FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, ConstraintIndex);
+		PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance.JointName = JointName;
+		LGV("      Renamed constraint %s to %s", *LegacyName.ToString(), *JointName.ToString())
+		return;
+	}
+}
+
+/** Creates one constraint per edge, A indexing ChildBodies and B indexing ParentBodies. Named by body pair, see JointNames. */
+static TArray<int32> CreateEdgeConstraints(UPhysicsAsset* PhysicsAsset, const FConstraintParams& DefaultParams,
+                                           const TArray<FName>& ChildBodies, const TArray<FName>& ParentBodies,
+                                           const TArray<FConstraintEdge>& Edges)
+{
+	TArray<int32> NewConstraintIndexes;
+	NewConstraintIndexes.Reserve(Edges.Num());
+	FConstraintParams Params = DefaultParams;
+	for(const FConstraintEdge& Edge : Edges)
+	{
+		Params.ConstraintBone1 = ChildBodies[Edge.A];
+		Params.ConstraintBone2 = ParentBodies[Edge.B];
+		Params.JointName = JointNames::MakePairName(Params.ConstraintBone1, Params.ConstraintBone2);
+		MigrateLegacyPairName(PhysicsAsset, Params.ConstraintBone1, Params.ConstraintBone2, Params.JointName);
+		// Two parents of one child whose numbers collide; overwriting would move the other pair's constraint
+		const int32 ExistingIndex = PhysicsAsset->FindConstraintIndex(Params.JointName);
+		if(ExistingIndex != INDEX_NONE && PhysicsAsset->ConstraintSetup[ExistingIndex]->DefaultInstance.ConstraintBone2 != Params.ConstraintBone2) {
+			LGW("      Constraint name %s is taken by another pair, skipping", *Params.JointName.ToString())
+			continue; }
+		int32 NewIndex = UPhysicsEditorBPLibrary::MakeNewConstraint(PhysicsAsset, Params);
+		if(NewIndex != INDEX_NONE)
+		{
+			LGV("      Created Constraint: %s", *Params.JointName.ToString())
+			NewConstraintIndexes.Add(NewIndex);
+		}
+	}
+	return NewConstraintIndexes;
+}
+
+static void LogGraphReport(const FConstraintGraphReport& Report)
+{
+	LG("      Constraint graph: %d -> %d (%d duplicate, %d redundant, %d over budget), solver rows %d -> %d (-%.1f%%)",
+	   Report.NumBefore, Report.NumAfter, Report.NumDuplicates, Report.NumRedundant, Report.NumOverBudget,
+	   Report.SolverRowsBefore, Report.SolverRowsAfter, Report.SolverCostReduction * 100.f)
+}
+
+/** Edges from each source to its closest targets, B indexing the sources. Reads only the pose, so it also runs on worker threads. */
+static void PlanClosestPointEdges(const FBonePose& Pose,
+                                  const FConstraintParams& DefaultParams,
+                                  const TArray<FName>& TargetBodies,
+                                  const TArray<FName>& InSourceBodies,
+                                  int32 NumClosestPoints,
+                                  bool bExtraBones,
+                                  const TArray<int32>& ClosestBones,
+                                  const FConstraintGraphOptions* GraphOptions,
+                                  FConstraintGraphReport* OutGraphReport,
+                                  TArray<FConstraintEdge>& Edges)
 {
-	TArray<int32> NewConstraintIndexes = TArray<int32>();
-	TArray<FName> BodyNames;
-	UPhysicsAsset* PhysicsAsset = SkeletalMeshComponent->GetPhysicsAsset();
-	PhysicsAsset->BodySetupIndexMap.GetKeys(BodyNames);
-	int32 N = NumClosestPoints;
 	TArray<FVector> TargetLocations, SourceLocations;
 	
 	// Generate Location vector arrays
 	for(auto BodyName : TargetBodies)
 	{
-		TargetLocations.Add(SkeletalMeshComponent->GetBoneTransform(BodyName).GetLocation());
+		TargetLocations.Add(Pose.GetBoneLocation(BodyName));
 	}
-	if(SourceBodies.IsEmpty())
+	// Points constrained to each other share one node array, so A->B and B->A are the same pair
+	const bool bSameSet = InSourceBodies.IsEmpty();
+	const TArray<FName>& SourceBodies = bSameSet ? TargetBodies : InSourceBodies;
+	if(bSameSet)
 	{
-		SourceBodies = TargetBodies;
 		SourceLocations = TargetLocations;
 	} else {
 		for(auto BodyName : SourceBodies)
 		{
-			SourceLocations.Add(SkeletalMeshComponent->GetBoneTransform(BodyName).GetLocation());
+			SourceLocations.Add(Pose.GetBoneLocation(BodyName));
 		} 
 	}
 	int32 NumTargets = TargetBodies.Num();
@@ -569,11 +843,17 @@ TArray<int32> UPhysicsEditorBPLibrary::AddClosestPointConstraints(USkeletalMeshC
 			AdjMatrix[i].Add(false);
 		}
 	}
-	// Create Constraints
+	// Plan edges
 	// for each source bone
+	Edges.Reset();
+	const int32 Rows = ConstraintGraph::EstimateSolverRows(DefaultParams);
 	for(int i = 0; i < NumSources; i++)
 	{
-		LG("    Source: %s", *SourceBodies[i].ToString())
+		LGV("    Source: %s", *SourceBodies[i].ToString())
+		// Counts come from user data, there can't be more closest points than targets
+		const int32 N = FMath::Min((bExtraBones && ClosestBones.IsValidIndex(i)) ? ClosestBones[i] : NumClosestPoints, NumTargets);
+		if(N < 1)
+			continue;
 		TArray<int32> ClosestIndex;
 		ClosestIndex.Init(-1, N);
 		TArray<float> Closest;
@@ -598,47 +878,165 @@ TArray<int32> UPhysicsEditorBPLibrary::AddClosestPointConstraints(USkeletalMeshC
 				}
 			}
 		}
-		// for each of N closest points, create a constraint
-		if(bExtraBones)
-			N = ClosestBones.IsValidIndex(i) ? ClosestBones[i] : NumClosestPoints;
+		// for each of N closest points, add an edge
 		for(int m = 0; m < N; m++)
 		{
-			if(!ClosestIndex.IsValidIndex(m))
-				continue;
 			int32 PointIndex = ClosestIndex[m];
 			if(PointIndex == INDEX_NONE || AdjMatrix[i][PointIndex])
 				continue; 
-			if(TargetBodies.IsValidIndex(PointIndex))
+			AdjMatrix[i][PointIndex] = true;
+			if(bSameSet)
 			{
-				FConstraintParams Params = DefaultParams;
-				// Target body is the child. In case of extra bones, we're anchoring the point to a skeletal bone
-				Params.ConstraintBone1 = TargetBodies[PointIndex];
-				Params.ConstraintBone2 = SourceBodies[i];
-				FString Prefix = bExtraBones ? "pt_bone_" : "pt_pt_";
-				Params.JointName = FName(Prefix + Params.ConstraintBone1.ToString() + "__" + Params.ConstraintBone2.ToString());
-				int32 NewIndex = MakeNewConstraint(PhysicsAsset, Params);
-				if(NewIndex != INDEX_NONE)
-				{
-					LG("      Created Constraint: %s", *Params.JointName.ToString())
-					NewConstraintIndexes.Add(NewIndex);
-					AdjMatrix[i][PointIndex] = AdjMatrix[i][PointIndex] = true;
-				}
+				// Mark the symmetric entry so PointIndex doesn't pick i again
+				AdjMatrix[PointIndex][i] = true;
 			}
+			// Target body is the child. In case of extra bones, we're anchoring the point to a skeletal bone
+			Edges.Add(FConstraintEdge(PointIndex, i, DistMatrix[i][PointIndex], Rows));
 		}
 	}
-	return NewConstraintIndexes;
+
+	if(bSameSet && GraphOptions)
+	{
+		FConstraintGraphReport Report;
+		ConstraintGraph::FilterEdges(Edges, *GraphOptions, Report);
+		LogGraphReport(Report);
+		if(OutGraphReport)
+			ConstraintGraph::AppendReport(*OutGraphReport, Report);
+	}
 }
 
-inline FName MirrorBoneName(FName InName)
+static TArray<int32> AddClosestPointConstraintsInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose,
+                                                        const FConstraintParams& DefaultParams,
+                                                        const TArray<FName>& TargetBodies,
+                                                        const TArray<FName>& SourceBodies,
+                                                        int32 NumClosestPoints,
+                                                        bool bExtraBones,
+                                                        const TArray<int32>& ClosestBones,
+                                                        const FConstraintGraphOptions* GraphOptions,
+                                                        FConstraintGraphReport* OutGraphReport)
 {
-	if(InName.ToString().EndsWith("_l"))
-		return FName(InName.ToString().LeftChop(1) + "r");
-	if(InName.ToString().EndsWith("_r"))
-		return FName(InName.ToString().LeftChop(1) + "l");
-	return InName;
+	TArray<FConstraintEdge> Edges;
+	PlanClosestPointEdges(Pose, DefaultParams, TargetBodies, SourceBodies, NumClosestPoints, bExtraBones, ClosestBones,
+	                      GraphOptions, OutGraphReport, Edges);
+	return CreateEdgeConstraints(PhysicsAsset, DefaultParams, TargetBodies, SourceBodies.IsEmpty() ? TargetBodies : SourceBodies, Edges);
 }
 
-inline FString MirrorPatternString(FString InPatternString)
+/** Surface triangulation edges between the targets. Reads only the pose, so it also runs on worker threads. */
+static bool PlanTriangulatedEdges(const FBonePose& Pose,
+                                  const FConstraintParams& DefaultParams,
+                                  const TArray<FName>& TargetBodies,
+                                  float MaxEdgeRatio,
+                                  const FConstraintGraphOptions* GraphOptions,
+                                  FConstraintGraphReport* OutGraphReport,
+                                  TArray<FConstraintEdge>& Edges)
+{
+	TArray<FVector> Locations;
+	Locations.Reserve(TargetBodies.Num());
+	for(const FName& BodyName : TargetBodies)
+	{
+		Locations.Add(Pose.GetBoneLocation(BodyName));
+	}
+
+	Edges.Reset();
+	if(!ConstraintGraph::TriangulateSurfaceEdges(Locations, MaxEdgeRatio, ConstraintGraph::EstimateSolverRows(DefaultParams), Edges))
+		return false;
+	LG("      Triangulated %d points into %d edges (%.2f per point)", Locations.Num(), Edges.Num(),
+	   Locations.Num() > 0 ? float(Edges.Num()) / Locations.Num() : 0.f)
+
+	if(GraphOptions)
+	{
+		FConstraintGraphReport Report;
+		ConstraintGraph::FilterEdges(Edges, *GraphOptions, Report);
+		LogGraphReport(Report);
+		if(OutGraphReport)
+			ConstraintGraph::AppendReport(*OutGraphReport, Report);
+	}
+	return true;
+}
+
+TArray<int32> UPhysicsEditorBPLibrary::AddClosestPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
+                                                            const FConstraintParams& DefaultParams,
+                                                            const TArray<FName>& TargetBodies,
+                                                            const TArray<FName>& SourceBodies,
+                                                            int32 NumClosestPoints,
+                                                            bool bExtraBones,
+                                                            const TArray<int32>& ClosestBones,
+                                                            FConstraintGraphReport& OutGraphReport)
+{
+	// Symmetric pairs are always collapsed; pruning and budgets are opt-in through FAddPointConstraints
+	FConstraintGraphOptions GraphOptions;
+	OutGraphReport = FConstraintGraphReport();
+	return AddClosestPointConstraintsInternal(SkeletalMeshComponent->GetPhysicsAsset(), FBonePose::FromComponent(SkeletalMeshComponent),
+	                                          DefaultParams, TargetBodies, SourceBodies, NumClosestPoints, bExtraBones, ClosestBones,
+	                                          &GraphOptions, &OutGraphReport);
+}
+
+bool UPhysicsEditorBPLibrary::PruneConstraintGraph(USkeletalMeshComponent* SkeletalMeshComponent, const FString& JointPatternString,
+                                                   const FConstraintGraphOptions& Options, FConstraintGraphReport& OutReport)
+{
+	UPhysicsAsset* PhysicsAsset = SkeletalMeshComponent ? SkeletalMeshComponent->GetPhysicsAsset() : nullptr;
+	if(!PhysicsAsset)
+	{
+		LGE("Physics asset not found");
+		return false;
+	}
+
+	// Bodies of the matched constraints become the graph nodes
+	TArray<FName> NodeNames;
+	TMap<FName, int32> NodeIndexMap;
+	auto FindOrAddNode = [&](FName BoneName)
+	{
+		if(const int32* Found = NodeIndexMap.Find(BoneName))
+			return *Found;
+		NodeIndexMap.Add(BoneName, NodeNames.Num());
+		return NodeNames.Add(BoneName);
+	};
+
+	TArray<FConstraintEdge> Edges;
+	const FRegexPattern Pattern = FRegexPattern(JointPatternString);
+	for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+	{
+		const UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[i];
+		if(!Template || !RegexMatch(Pattern, Template->DefaultInstance.JointName.ToString()))
+			continue;
+		const FConstraintInstance& Constraint = Template->DefaultInstance;
+		const FVector Pos1 = SkeletalMeshComponent->GetBoneLocation(Constraint.ConstraintBone1);
+		const FVector Pos2 = SkeletalMeshComponent->GetBoneLocation(Constraint.ConstraintBone2);
+		FConstraintEdge& Edge = Edges.Add_GetRef(FConstraintEdge(FindOrAddNode(Constraint.ConstraintBone1),
+		                                                         FindOrAddNode(Constraint.ConstraintBone2),
+		                                                         FVector::Dist(Pos1, Pos2),
+		                                                         ConstraintGraph::EstimateSolverRows(Constraint)));
+		Edge.Payload = i;
+	}
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "PruneConstraintGraph", "Prune Constraint Graph"));
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+	OutReport = FConstraintGraphReport();
+	TSet<int32> Kept;
+	ConstraintGraph::FilterEdges(Edges, Options, OutReport);
+	for(const FConstraintEdge& Edge : Edges)
+		Kept.Add(Edge.Payload);
+
+	// Colliders of a removed pair still overlap, so collision stays disabled between them
+	int32 NumDestroyed = 0;
+	for(int32 i = PhysicsAsset->ConstraintSetup.Num() - 1; i >= 0; i--)
+	{
+		const UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[i];
+		if(Template && !Kept.Contains(i) && RegexMatch(Pattern, Template->DefaultInstance.JointName.ToString()))
+		{
+			FPhysicsAssetUtils::DestroyConstraint(PhysicsAsset, i);
+			NumDestroyed++;
+		}
+	}
+	LG("Pruned %d of %d constraints matching %s, solver rows %d -> %d (-%.1f%%)", NumDestroyed, OutReport.NumBefore,
+	   *JointPatternString, OutReport.SolverRowsBefore, OutReport.SolverRowsAfter, OutReport.SolverCostReduction * 100.f)
+
+	PhysicsAsset->MarkPackageDirty();
+	PhysicsAsset->RefreshPhysicsAssetChange();
+	return true;
+}
+
+inline FString MirrorPatternString(const FString& InPatternString)
 {
 	if(InPatternString.EndsWith("_l"))
 		return InPatternString.LeftChop(1) + "r";
@@ -647,41 +1045,171 @@ inline FString MirrorPatternString(FString InPatternString)
 	return InPatternString;
 }
 
-TArray<int32> UPhysicsEditorBPLibrary::AddPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
-                                                            FAddPointConstraints Options)
+/** Copies the generated side of a point group onto the other side in one pass, in place of a second generation */
+static TArray<int32> MirrorPointGroup(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose, const FAddPointConstraints& Options,
+                                      const TArray<FName>& SourceBodies, const TArray<int32>& SourceConstraints)
+{
+	FBilateralSymmetryMap SymmetryMap;
+	if(!SymmetryMap.Build(PhysicsAsset))
+		return TArray<int32>();
+	const FReferenceSkeleton& RefSkeleton = *Pose.RefSkeleton;
+
+	TArray<int32> BodyIndexes;
+	TArray<FName> MirrorBodyNames;
+	TArray<int32> Constraints = SourceConstraints;
+	for(const FName& BodyName : SourceBodies)
+	{
+		const int32* BodyIndex = PhysicsAsset->BodySetupIndexMap.Find(BodyName);
+		if(!BodyIndex)
+			continue;
+		BodyIndexes.Add(*BodyIndex);
+		const int32 MirrorIndex = SymmetryMap.BodyMirror[*BodyIndex];
+		if(MirrorIndex != INDEX_NONE && MirrorIndex != *BodyIndex)
+			MirrorBodyNames.Add(PhysicsAsset->SkeletalBodySetups[MirrorIndex]->BoneName);
+		// Adjusted constraints are named after their child body
+		if(Options.bAdjustConstraints)
+		{
+			if(const int32* ConstraintIndex = SymmetryMap.ConstraintIndexMap.Find(BodyName))
+				Constraints.AddUnique(*ConstraintIndex);
+		}
+	}
+
+	if(Options.CollisionMode == ETissueCollisionMode::GroupChannel)
+		UPhysicsEditorBPLibrary::SetTissueCollisionGroup(PhysicsAsset, MirrorBodyNames, Options.TissueCollisionChannel, true);
+	if(Options.SolverIterations > 0)
+		DriveTuner::SetSolverIterations(PhysicsAsset, MirrorBodyNames, Options.SolverIterations);
+	if(Options.bAdjustBodies)
+	{
+		const int32 NumBodies = SymmetryMap.MirrorBodies(PhysicsAsset, RefSkeleton, Pose.ComponentSpace, BodyIndexes, Options.MirrorAxis);
+		LG("      Mirrored %d bodies", NumBodies)
+	}
+	TArray<int32> MirrorIndexes = SymmetryMap.MirrorConstraints(PhysicsAsset, RefSkeleton, Pose.ComponentSpace, Constraints, Options.MirrorAxis);
+	LG("      Mirrored %d of %d constraints", MirrorIndexes.Num(), Constraints.Num())
+	return MirrorIndexes;
+}
+
+/** Edges of one pass of a point group, planned for the bodies in TargetBodies. Only used while they still match. */
+struct FPointPassPlan
+{
+	TArray<FName> TargetBodies;
+	TArray<FConstraintEdge> PointEdges;
+	TArray<FName> ExtraSourceBodies;
+	TArray<FConstraintEdge> ExtraEdges;
+	/** What filtering PointEdges saved */
+	FConstraintGraphReport GraphReport;
+};
+
+/** The second pass generates the mirror side */
+static int32 GetNumPointPasses(const FAddPointConstraints& Options)
+{
+	return (Options.bAddMirrorConstraints && !Options.bMirrorByCopy) ? 2 : 1;
+}
+
+static void PlanPointPass(const FBonePose& Pose, const FAddPointConstraints& Options, const TArray<FName>& TargetBodies, bool bMirror,
+                          FPointPassPlan& OutPlan)
 {
+	OutPlan.TargetBodies = TargetBodies;
+	if(Options.bAddPointToPointConstraints)
+	{
+		if(Options.PointToPointTopology == EPointTopology::SurfaceTriangulation)
+			PlanTriangulatedEdges(Pose, Options.PointToPointConstraintParams, TargetBodies, Options.MaxTriangulationEdgeRatio,
+			                      &Options.PointToPointGraphOptions, &OutPlan.GraphReport, OutPlan.PointEdges);
+		else
+			PlanClosestPointEdges(Pose, Options.PointToPointConstraintParams, TargetBodies, TArray<FName>(), Options.NumClosestPoints,
+			                      false, TArray<int32>(), &Options.PointToPointGraphOptions, &OutPlan.GraphReport, OutPlan.PointEdges);
+	}
+	if(!Options.ExtraBonesToClosestPoints.IsEmpty())
+	{
+		TArray<int32> ClosestPoints;
+		Options.ExtraBonesToClosestPoints.GetKeys(OutPlan.ExtraSourceBodies);
+		ClosestPoints.Reserve(OutPlan.ExtraSourceBodies.Num());
+		for(FName& BodyName : OutPlan.ExtraSourceBodies)
+		{
+			// Counts are keyed by the source side bone, so look them up before mirroring
+			const int32* NumClosest = Options.ExtraBonesToClosestPoints.Find(BodyName);
+			ClosestPoints.Add(NumClosest ? *NumClosest : 3);
+			if(bMirror)
+				BodyName = FBilateralSymmetryMap::MirrorName(BodyName);
+		}
+		FConstraintGraphOptions GraphOptions;
+		PlanClosestPointEdges(Pose, Options.ExtraBonesConstraintParams, TargetBodies, OutPlan.ExtraSourceBodies, Options.NumClosestPoints,
+		                      true, ClosestPoints, &GraphOptions, nullptr, OutPlan.ExtraEdges);
+	}
+}
+
+/** Plans every pass of the group from a snapshot of the body names. Reads no UObjects, so it runs on worker threads. */
+static void PlanPointGroup(const FBonePose& Pose, const TArray<FName>& BodyNames, const FAddPointConstraints& Options,
+                           TArray<FPointPassPlan>& OutPlans)
+{
+	OutPlans.SetNum(GetNumPointPasses(Options));
+	for(int32 i = 0; i < OutPlans.Num(); i++)
+	{
+		const FString PatternString = (i == 0) ? Options.PointPatternString : MirrorPatternString(Options.PointPatternString);
+		PlanPointPass(Pose, Options, UPhysicsEditorBPLibrary::FilterNames(BodyNames, PatternString), i == 1, OutPlans[i]);
+	}
+}
+
+/**
+ * Plans, if given, come from PlanPointGroup; passes whose bodies changed since are planned again here.
+ * The graph reports of the point to point passes are added to OutGraphReport.
+ */
+static TArray<int32> AddPointConstraintsInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose, const FAddPointConstraints& Options,
+                                                 FConstraintGraphReport& OutGraphReport, const TArray<FPointPassPlan>* Plans = nullptr)
+{
+	if(!PhysicsAsset || !Pose.IsValid()) {
+		LGE("Physics asset or skeletal mesh not found")
+		return TArray<int32>(); }
 	
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "AddPointConstraints", "Add Point Constraints"));
+	FScopedPackageSave SaveScope;
 	TArray<FName> BodyNames, TargetBodies;
-	UPhysicsAsset* PhysicsAsset = SkeletalMeshComponent->GetPhysicsAsset();
 	PhysicsAsset->BodySetupIndexMap.GetKeys(BodyNames);
 	TArray<int32> ConstraintIndexes, TempConstraintIndexes;
-	for(int i = 0; i < Options.bAddMirrorConstraints + 1; i++)
+	const bool bMirrorByCopy = Options.bAddMirrorConstraints && Options.bMirrorByCopy;
+	const int32 NumPasses = GetNumPointPasses(Options);
+	for(int i = 0; i < NumPasses; i++)
 	{
-		FString PatternString = (i == 0) ? Options.PointPatternString : MirrorPatternString(Options.PointPatternString);
-		TargetBodies = FilterNames(BodyNames, PatternString);
+		const FString PatternString = (i == 0) ? Options.PointPatternString : MirrorPatternString(Options.PointPatternString);
+		TargetBodies = UPhysicsEditorBPLibrary::FilterNames(BodyNames, PatternString);
+		FPointPassPlan LocalPlan;
+		const FPointPassPlan* Plan = (Plans && Plans->IsValidIndex(i) && (*Plans)[i].TargetBodies == TargetBodies) ? &(*Plans)[i] : nullptr;
+		if(!Plan)
+		{
+			PlanPointPass(Pose, Options, TargetBodies, i == 1, LocalPlan);
+			Plan = &LocalPlan;
+		}
+		if (Options.CollisionMode == ETissueCollisionMode::GroupChannel)
+		{
+			LG("  Setting collision group for pattern: %s", *PatternString)
+			UPhysicsEditorBPLibrary::SetTissueCollisionGroup(PhysicsAsset, TargetBodies, Options.TissueCollisionChannel, true);
+		}
+		if (Options.SolverIterations > 0)
+			DriveTuner::SetSolverIterations(PhysicsAsset, TargetBodies, Options.SolverIterations);
 		if (Options.bAdjustBodies)
 		{
 			LG("  Adjusting Bodies for pattern: %s", *Options.PointPatternString)	
-			AdjustBodies(SkeletalMeshComponent, Options.AdjustBodiesOptions, TargetBodies);
+			AdjustBodiesInternal(PhysicsAsset, Pose, Options.AdjustBodiesOptions, TargetBodies);
 		}
 		if (Options.bAdjustConstraints)
 		{
 			LG("  Adjusting Constraints for pattern: %s", *Options.PointPatternString)	
-			AdjustConstraints(SkeletalMeshComponent, Options.AdjustConstraintsOptions, TargetBodies);
+			AdjustConstraintsInternal(PhysicsAsset, Pose, Options.AdjustConstraintsOptions, TargetBodies);
 		}
 		if (Options.bAddPointToPointConstraints)
 		{
 			// Point to Point constraints
-			LG("  Add Closest Point to Point Constraints for pattern: %s", *Options.PointPatternString)	
-			TempConstraintIndexes = AddClosestPointConstraints(SkeletalMeshComponent, Options.PointToPointConstraintParams,
-			                                                   TargetBodies, TArray<FName>(), Options.NumClosestPoints);
+			LG("  Add %s Point to Point Constraints for pattern: %s",
+			   Options.PointToPointTopology == EPointTopology::SurfaceTriangulation ? TEXT("Triangulated") : TEXT("Closest"), *Options.PointPatternString)
+			TempConstraintIndexes = CreateEdgeConstraints(PhysicsAsset, Options.PointToPointConstraintParams, TargetBodies, TargetBodies,
+			                                              Plan->PointEdges);
 			ConstraintIndexes.Append(TempConstraintIndexes);
+			ConstraintGraph::AppendReport(OutGraphReport, Plan->GraphReport);
 		}
 		if (Options.bAddPointToParentConstraints)
 		{
 			// Point to Parent constraints
 			LG("  Add Closest Point to Parent Constraints for pattern: %s", *Options.PointPatternString)	
-			TempConstraintIndexes = AddPointToParentConstraints(SkeletalMeshComponent, Options, TargetBodies);
+			TempConstraintIndexes = AddPointToParentConstraintsInternal(PhysicsAsset, Pose, Options, TargetBodies);
 			ConstraintIndexes.Append(TempConstraintIndexes);
 		}
 
@@ -689,54 +1217,178 @@ TArray<int32> UPhysicsEditorBPLibrary::AddPointConstraints(USkeletalMeshComponen
 		{
 			LG("  Add closest points to other body Constraints for pattern: %s", *Options.PointPatternString)	
 			// Point to Bone Constraints
-			TArray<FName> SourceBodies;
-			TArray<int32> ClosestPoints;
-			Options.ExtraBonesToClosestPoints.GetKeys(SourceBodies);
-			int j = 0;
-			for(auto BodyName : SourceBodies)
-			{
-				if(i == 1)
-				{
-					BodyName = MirrorBoneName(BodyName);
-					SourceBodies[j++] = BodyName;
-				}
-				ClosestPoints.Add(Options.ExtraBonesToClosestPoints.FindOrAdd(BodyName, 3));
-			}
-			TempConstraintIndexes = AddClosestPointConstraints(SkeletalMeshComponent, Options.ExtraBonesConstraintParams,
-			                                                   TargetBodies, SourceBodies,
-			                                                   Options.NumClosestPoints, true, ClosestPoints);
+			TempConstraintIndexes = CreateEdgeConstraints(PhysicsAsset, Options.ExtraBonesConstraintParams, TargetBodies,
+			                                              Plan->ExtraSourceBodies, Plan->ExtraEdges);
 			ConstraintIndexes.Append(TempConstraintIndexes);
 		}
 	}
+	if(bMirrorByCopy)
+	{
+		LG("  Mirroring bodies and constraints for pattern: %s", *Options.PointPatternString)
+		ConstraintIndexes.Append(MirrorPointGroup(PhysicsAsset, Pose, Options, TargetBodies, ConstraintIndexes));
+	}
 	LG("Added or modified %d constraints.", ConstraintIndexes.Num())
 	return ConstraintIndexes;
 }
 
-TArray<int32> UPhysicsEditorBPLibrary::AddPhatConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
-	FPhatConstraintOptions Options)
+static bool NeedsSkinSurface(const FAddPointConstraints& Options)
 {
-	UPhysicsAsset* PhysicsAsset = SkeletalMeshComponent->GetPhysicsAsset();
-	TArray<int32> NewConstraintIndexes;
+	return Options.bAdjustBodies && Options.AdjustBodiesOptions.FitMode == EBodyFitMode::SkinSurface;
+}
+
+TArray<int32> UPhysicsEditorBPLibrary::AddPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
+                                                            const FAddPointConstraints& Options, FConstraintGraphReport& OutGraphReport)
+{
+	OutGraphReport = FConstraintGraphReport();
+	return AddPointConstraintsInternal(SkeletalMeshComponent ? SkeletalMeshComponent->GetPhysicsAsset() : nullptr,
+	                                   FBonePose::FromComponent(SkeletalMeshComponent, NeedsSkinSurface(Options)), Options, OutGraphReport);
+}
+
+TArray<int32> UPhysicsEditorBPLibrary::AddPointConstraintsFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+                                                                       const FAddPointConstraints& Options, FConstraintGraphReport& OutGraphReport)
+{
+	OutGraphReport = FConstraintGraphReport();
+	return AddPointConstraintsInternal(PhysicsAsset, FBonePose::FromRefPose(SkeletalMesh, NeedsSkinSurface(Options)), Options, OutGraphReport);
+}
+
+/** The enabled point groups of Options in generation order */
+static TArray<const FAddPointConstraints*, TInlineAllocator<6>> GetEnabledPointGroups(const FPhatConstraintOptions& Options)
+{
+	TArray<const FAddPointConstraints*, TInlineAllocator<6>> Groups;
 	if(Options.bAddGluteCores)
-		NewConstraintIndexes += AddPointConstraints(SkeletalMeshComponent, Options.GluteCores);
+		Groups.Add(&Options.GluteCores);
 	if(Options.bAddGluteSpokes)
-		NewConstraintIndexes += AddPointConstraints(SkeletalMeshComponent, Options.GluteSpokes);
+		Groups.Add(&Options.GluteSpokes);
 	if(Options.bAddGlutePoints)
-		NewConstraintIndexes += AddPointConstraints(SkeletalMeshComponent, Options.GlutePoints);
+		Groups.Add(&Options.GlutePoints);
 	if(Options.bAddBreastCores)
-		NewConstraintIndexes += AddPointConstraints(SkeletalMeshComponent, Options.BreastCores);
+		Groups.Add(&Options.BreastCores);
 	if(Options.bAddBreastSpokes)
-		NewConstraintIndexes += AddPointConstraints(SkeletalMeshComponent, Options.BreastSpokes);
+		Groups.Add(&Options.BreastSpokes);
 	if(Options.bAddBreastPoints)
-		NewConstraintIndexes += AddPointConstraints(SkeletalMeshComponent, Options.BreastPoints);
+		Groups.Add(&Options.BreastPoints);
+	return Groups;
+}
+
+static bool NeedsSkinSurface(const FPhatConstraintOptions& Options)
+{
+	for(const FAddPointConstraints* Group : GetEnabledPointGroups(Options))
+	{
+		if(NeedsSkinSurface(*Group))
+			return true;
+	}
+	return false;
+}
+
+/** GroupPlans, if given, hold the PlanPointGroup results of the enabled groups in order */
+static TArray<int32> AddPhatConstraintsInternal(UPhysicsAsset* PhysicsAsset, const FBonePose& Pose, const FPhatConstraintOptions& Options,
+                                                FConstraintGraphReport& OutGraphReport, const TArray<TArray<FPointPassPlan>>* GroupPlans = nullptr)
+{
+	OutGraphReport = FConstraintGraphReport();
+	if(!PhysicsAsset || !Pose.IsValid()) {
+		LGE("Physics asset or skeletal mesh not found")
+		return TArray<int32>(); }
+	
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "AddPhatConstraints", "Add Phat Constraints"));
+	FScopedPackageSave SaveScope;
+	FMassRebalanceReport MassReport;
+	if(Options.bRebalanceMass)
+		MassHierarchy::Rebalance(PhysicsAsset, *Pose.RefSkeleton, Options, Options.MassRebalance, MassReport);
+	TArray<int32> NewConstraintIndexes;
+	const TArray<const FAddPointConstraints*, TInlineAllocator<6>> Groups = GetEnabledPointGroups(Options);
+	for(int32 i = 0; i < Groups.Num(); i++)
+	{
+		const TArray<FPointPassPlan>* Plans = (GroupPlans && GroupPlans->IsValidIndex(i)) ? &(*GroupPlans)[i] : nullptr;
+		NewConstraintIndexes += AddPointConstraintsInternal(PhysicsAsset, Pose, *Groups[i], OutGraphReport, Plans);
+	}
+	LG("Point to point constraints of all groups:")
+	LogGraphReport(OutGraphReport);
+
+	if(Options.bWriteConstraintProfiles && !NewConstraintIndexes.IsEmpty())
+		UPhysicsEditorBPLibrary::WriteConstraintProfiles(PhysicsAsset, Options.ConstraintProfiles, NewConstraintIndexes);
 
 	PhysicsAsset->MarkPackageDirty();
 	PhysicsAsset->RefreshPhysicsAssetChange();
 	return NewConstraintIndexes;
 }
 
+TArray<int32> UPhysicsEditorBPLibrary::AddPhatConstraints(USkeletalMeshComponent* SkeletalMeshComponent,
+	const FPhatConstraintOptions& Options, FConstraintGraphReport& OutGraphReport)
+{
+	return AddPhatConstraintsInternal(SkeletalMeshComponent ? SkeletalMeshComponent->GetPhysicsAsset() : nullptr,
+	                                  FBonePose::FromComponent(SkeletalMeshComponent, NeedsSkinSurface(Options)), Options, OutGraphReport);
+}
+
+TArray<int32> UPhysicsEditorBPLibrary::AddPhatConstraintsFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+	const FPhatConstraintOptions& Options, FConstraintGraphReport& OutGraphReport)
+{
+	return AddPhatConstraintsInternal(PhysicsAsset, FBonePose::FromRefPose(SkeletalMesh, NeedsSkinSurface(Options)), Options, OutGraphReport);
+}
+
+TArray<int32> UPhysicsEditorBPLibrary::AddPhatConstraintsFromMorphVariant(UPcActorDataAsset* DataAsset, FConstraintGraphReport& OutGraphReport)
+{
+	OutGraphReport = FConstraintGraphReport();
+	const TSharedPtr<const FMorphVariant> Variant = MorphVariantCache::FindOrEvaluate(DataAsset);
+	if(!Variant)
+		return TArray<int32>();
+	const FPhatConstraintOptions& Options = DataAsset->PhatConstraintOptions;
+	return AddPhatConstraintsInternal(DataAsset->GetTargetPhysicsAsset(),
+	                                  FBonePose::FromMorphVariant(DataAsset->GetSourceSkeletalMesh(), *Variant, NeedsSkinSurface(Options)), Options,
+	                                  OutGraphReport);
+}
+
+bool UPhysicsEditorBPLibrary::AddPhatConstraintsInBackground(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+	const FPhatConstraintOptions& Options)
+{
+	if(!PhysicsAsset || !SkeletalMesh) {
+		LGE("Physics asset or skeletal mesh not found")
+		return false; }
+
+	// The worker gets its own copies of the options, skeleton and body names
+	struct FPhatJob
+	{
+		FPhatConstraintOptions Options;
+		FReferenceSkeleton RefSkeleton;
+		FBonePose Pose;
+		TArray<FName> BodyNames;
+		TArray<TArray<FPointPassPlan>> GroupPlans;
+	};
+	TSharedRef<FPhatJob> Job = MakeShared<FPhatJob>();
+	Job->Options = Options;
+	Job->Pose = FBonePose::FromRefPose(SkeletalMesh, NeedsSkinSurface(Options));
+	Job->RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	Job->Pose.RefSkeleton = &Job->RefSkeleton;
+	if(!Job->Pose.IsValid()) {
+		LGE("No reference pose for %s", *SkeletalMesh->GetName())
+		return false; }
+	PhysicsAsset->BodySetupIndexMap.GetKeys(Job->BodyNames);
+
+	return FPcBackgroundOperation::Launch(NSLOCTEXT("PhysicsEditorBPLibrary", "AddPhatConstraintsBackground", "Generating constraints"),
+		{PhysicsAsset, SkeletalMesh},
+		[Job](FPcBackgroundOperation& Operation)
+		{
+			const TArray<const FAddPointConstraints*, TInlineAllocator<6>> Groups = GetEnabledPointGroups(Job->Options);
+			Job->GroupPlans.SetNum(Groups.Num());
+			for(int32 i = 0; i < Groups.Num() && !Operation.IsCancelled(); i++)
+			{
+				Operation.SetProgress(float(i) / Groups.Num(), Groups[i]->PointPatternString);
+				PlanPointGroup(Job->Pose, Job->BodyNames, *Groups[i], Job->GroupPlans[i]);
+			}
+			Operation.SetProgress(1.f, TEXT("Creating constraints"));
+			return true;
+		},
+		[PhysicsAsset, Job]()
+		{
+			// The inputs were checked before launching and are kept loaded. A rerun that finds every constraint in place
+			// adds none, which is still a success.
+			FConstraintGraphReport GraphReport;
+			AddPhatConstraintsInternal(PhysicsAsset, Job->Pose, Job->Options, GraphReport, &Job->GroupPlans);
+			return true;
+		}).IsValid();
+}
+
 int32 UPhysicsEditorBPLibrary::MakeNewConstraint(UPhysicsAsset* PhysicsAsset,
-                                                 FConstraintParams Params)
+                                                 const FConstraintParams& Params)
 {
 	FName ConstraintBone1 = Params.ConstraintBone1;
 	FName ConstraintBone2 = Params.ConstraintBone2;
@@ -754,8 +1406,10 @@ int32 UPhysicsEditorBPLibrary::MakeNewConstraint(UPhysicsAsset* PhysicsAsset,
 	}
 	
 	if(JointName == FName())
-		JointName = FName(ConstraintBone1.ToString() + "__" + ConstraintBone2.ToString());
+		JointName = JointNames::MakePairName(ConstraintBone1, ConstraintBone2);
 	
+	// The asset snapshot covers the new template and the collision table entry
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
 	ConstraintIndex = FPhysicsAssetUtils::CreateNewConstraint(PhysicsAsset, JointName);
 	if (ConstraintIndex != INDEX_NONE)
 	{
@@ -764,7 +1418,8 @@ int32 UPhysicsEditorBPLibrary::MakeNewConstraint(UPhysicsAsset* PhysicsAsset,
 		ConstraintSetup->DefaultInstance.ConstraintBone2 = ConstraintBone2;
 		ApplyConstraintParams(PhysicsAsset, Params);
 		ConstraintSetup->DefaultInstance.SnapTransformsToDefault(EConstraintTransformComponentFlags::All, PhysicsAsset);
-		PhysicsAsset->DisableCollision(ChildIndex, ParentIndex);
+		if(!BodiesIgnoreEachOther(PhysicsAsset, ChildIndex, ParentIndex))
+			PhysicsAsset->DisableCollision(ChildIndex, ParentIndex);
 		
 		return ConstraintIndex;
 	}
@@ -772,8 +1427,157 @@ int32 UPhysicsEditorBPLibrary::MakeNewConstraint(UPhysicsAsset* PhysicsAsset,
 	return INDEX_NONE;
 }
 
+FConstraintProfileProperties UPhysicsEditorBPLibrary::MakeProfileProperties(const FConstraintProfileProperties& Default, const FConstraintProfilePreset& Preset)
+{
+	FConstraintProfileProperties Props = Default;
+	const float LinearDamping = Preset.LinearStrengthScale * Preset.DampingScale;
+	const float AngularDamping = Preset.AngularStrengthScale * Preset.DampingScale;
+
+	for(FConstraintDrive* Drive : {&Props.LinearDrive.XDrive, &Props.LinearDrive.YDrive, &Props.LinearDrive.ZDrive})
+	{
+		Drive->Stiffness *= Preset.LinearStrengthScale;
+		Drive->Damping *= LinearDamping;
+	}
+	for(FConstraintDrive* Drive : {&Props.AngularDrive.SwingDrive, &Props.AngularDrive.TwistDrive, &Props.AngularDrive.SlerpDrive})
+	{
+		Drive->Stiffness *= Preset.AngularStrengthScale;
+		Drive->Damping *= AngularDamping;
+	}
+	Props.LinearLimit.Limit *= Preset.LinearLimitScale;
 
-bool UPhysicsEditorBPLibrary::RegexMatch(FRegexPattern Pattern, FString Str)
+	if(Preset.bDisableAngularDrive)
+	{
+		Props.AngularDrive.SetOrientationDriveTwistAndSwing(false, false);
+		Props.AngularDrive.SetOrientationDriveSLERP(false);
+		Props.AngularDrive.SetAngularVelocityDriveTwistAndSwing(false, false);
+		Props.AngularDrive.SetAngularVelocityDriveSLERP(false);
+	}
+	return Props;
+}
+
+bool UPhysicsEditorBPLibrary::WriteConstraintProfiles(UPhysicsAsset* PhysicsAsset, const TArray<FConstraintProfilePreset>& Presets,
+                                                      const TArray<int32>& ConstraintIndexes)
+{
+	if(!PhysicsAsset || Presets.IsEmpty())
+		return false;
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "WriteConstraintProfiles", "Write Constraint Profiles"));
+	TArray<FName>* AssetProfileNames = GetPropertyValuePtr<TArray<FName>>(PhysicsAsset, TEXT("ConstraintProfiles"));
+	if(!AssetProfileNames) {
+		LGE("ConstraintProfiles not found on %s", *PhysicsAsset->GetClass()->GetName())
+		return false; }
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+	for(const FConstraintProfilePreset& Preset : Presets)
+	{
+		if(Preset.ProfileName != NAME_None)
+			AssetProfileNames->AddUnique(Preset.ProfileName);
+	}
+
+	TArray<int32> Indexes = ConstraintIndexes;
+	if(Indexes.IsEmpty())
+	{
+		for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+			Indexes.Add(i);
+	}
+
+	int32 NumWritten = 0;
+	for(int32 Index : Indexes)
+	{
+		if(!PhysicsAsset->ConstraintSetup.IsValidIndex(Index) || !PhysicsAsset->ConstraintSetup[Index])
+			continue;
+		UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[Index];
+		TArray<FPhysicsConstraintProfileHandle>* Handles = GetPropertyValuePtr<TArray<FPhysicsConstraintProfileHandle>>(Template, TEXT("ProfileHandles"));
+		if(!Handles) {
+			LGE("ProfileHandles not found on %s", *Template->GetClass()->GetName())
+			return false; }
+		FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, Index);
+
+		const FConstraintProfileProperties& Default = Template->DefaultInstance.ProfileInstance;
+		for(const FConstraintProfilePreset& Preset : Presets)
+		{
+			if(Preset.ProfileName == NAME_None)
+				continue;
+			FPhysicsConstraintProfileHandle* Handle = Handles->FindByPredicate([&Preset](const FPhysicsConstraintProfileHandle& H)
+			{
+				return H.ProfileName == Preset.ProfileName;
+			});
+			if(!Handle)
+			{
+				Handle = &Handles->AddDefaulted_GetRef();
+				Handle->ProfileName = Preset.ProfileName;
+			}
+			Handle->ProfileProperties = MakeProfileProperties(Default, Preset);
+		}
+		NumWritten++;
+	}
+	LG("Wrote %d constraint profiles to %d constraints", Presets.Num(), NumWritten)
+	PhysicsAsset->MarkPackageDirty();
+	return NumWritten > 0;
+}
+
+
+bool UPhysicsEditorBPLibrary::BodiesIgnoreEachOther(const UPhysicsAsset* PhysicsAsset, int32 BodyIndex1, int32 BodyIndex2)
+{
+	const USkeletalBodySetup* Body1 = PhysicsAsset->SkeletalBodySetups[BodyIndex1];
+	const USkeletalBodySetup* Body2 = PhysicsAsset->SkeletalBodySetups[BodyIndex2];
+	if(!Body1 || !Body2)
+		return false;
+	const ECollisionChannel Channel = Body1->DefaultInstance.GetObjectType();
+	return Body2->DefaultInstance.GetObjectType() == Channel
+		&& Body1->DefaultInstance.GetResponseToChannel(Channel) == ECR_Ignore
+		&& Body2->DefaultInstance.GetResponseToChannel(Channel) == ECR_Ignore;
+}
+
+int32 UPhysicsEditorBPLibrary::SetTissueCollisionGroup(UPhysicsAsset* PhysicsAsset, const TArray<FName>& BodyNames,
+                                                       TEnumAsByte<ECollisionChannel> Channel, bool bRemovePairwiseEntries)
+{
+	if(!PhysicsAsset)
+		return 0;
+	if(Channel == ECC_MAX) {
+		LGW("No tissue collision channel picked, collision of %d bodies left unchanged", BodyNames.Num())
+		return 0; }
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsEditorBPLibrary", "SetTissueCollisionGroup", "Set Tissue Collision Group"));
+	TSet<int32> GroupIndexes;
+	GroupIndexes.Reserve(BodyNames.Num());
+	for(const FName& BodyName : BodyNames)
+	{
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
+		if(BodyIndex == INDEX_NONE || !PhysicsAsset->SkeletalBodySetups[BodyIndex])
+		{
+			LGW("Body %s not found in physics asset", *BodyName.ToString())
+			continue;
+		}
+		FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, BodyIndex);
+		FBodyInstance& BodyInstance = PhysicsAsset->SkeletalBodySetups[BodyIndex]->DefaultInstance;
+		BodyInstance.SetCollisionProfileName(UCollisionProfile::CustomCollisionProfileName);
+		BodyInstance.SetObjectType(Channel);
+		BodyInstance.SetResponseToChannel(Channel, ECR_Ignore);
+		GroupIndexes.Add(BodyIndex);
+	}
+
+	int32 NumRemoved = 0;
+	if(bRemovePairwiseEntries)
+	{
+		TArray<FRigidBodyIndexPair> PairsToRemove;
+		for(const TPair<FRigidBodyIndexPair, bool>& Entry : PhysicsAsset->CollisionDisableTable)
+		{
+			if(GroupIndexes.Contains(Entry.Key.Indices[0]) && GroupIndexes.Contains(Entry.Key.Indices[1]))
+				PairsToRemove.Add(Entry.Key);
+		}
+		if(!PairsToRemove.IsEmpty())
+			FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+		for(const FRigidBodyIndexPair& Pair : PairsToRemove)
+			PhysicsAsset->CollisionDisableTable.Remove(Pair);
+		NumRemoved = PairsToRemove.Num();
+	}
+	LG("Moved %d bodies to collision channel %d, removed %d pairwise entries (%d left)", GroupIndexes.Num(), int32(Channel.GetValue()),
+	   NumRemoved, PhysicsAsset->CollisionDisableTable.Num())
+	PhysicsAsset->MarkPackageDirty();
+	return GroupIndexes.Num();
+}
+
+bool UPhysicsEditorBPLibrary::RegexMatch(const FRegexPattern& Pattern, const FString& Str)
 {
 	FRegexMatcher Matcher = FRegexMatcher(Pattern, Str);
 	if (Matcher.FindNext())
@@ -781,11 +1585,11 @@ bool UPhysicsEditorBPLibrary::RegexMatch(FRegexPattern Pattern, FString Str)
 	return false;
 }
 
-TArray<FName> UPhysicsEditorBPLibrary::FilterNames(TArray<FName> Names, FString PatternString)
+TArray<FName> UPhysicsEditorBPLibrary::FilterNames(const TArray<FName>& Names, const FString& PatternString)
 {
 	TArray<FName> OutNames;
-	FRegexPattern Pattern = FRegexPattern(PatternString);
-	for(FName Name : Names)
+	const FRegexPattern Pattern(PatternString);
+	for(const FName& Name : Names)
 	{
 		if(RegexMatch(Pattern, Name.ToString()))
 			OutNames.Add(Name);
@@ -793,24 +1597,26 @@ TArray<FName> UPhysicsEditorBPLibrary::FilterNames(TArray<FName> Names, FString
 	return OutNames;
 }
 
-void UPhysicsEditorBPLibrary::SaveAsset(FString AssetPath, bool& bOutSuccess, FString& OutInfoMessage)
+void UPhysicsEditorBPLibrary::SaveAsset(const FString& AssetPath, bool& bOutSuccess, FString& OutInfoMessage)
 {
-	// Load the asset
-	UObject* Asset = StaticLoadObject(UObject::StaticClass(), nullptr, *AssetPath);
+	// Only load the asset if it isn't in memory already
+	UObject* Asset = StaticFindObject(UObject::StaticClass(), nullptr, *AssetPath);
+	if (Asset == nullptr)
+		Asset = StaticLoadObject(UObject::StaticClass(), nullptr, *AssetPath);
 	if (Asset == nullptr)
 	{
 		bOutSuccess = false;
 		OutInfoMessage = FString::Printf(TEXT("Save Asset Failed – Asset is not valid '%s'"), *AssetPath);
 		return;
 	}
-	// Get the package from the asset
-	UPackage* Package = Asset->GetPackage();
-	if (Package == nullptr)
-	{
-		bOutSuccess = false;
-		OutInfoMessage = FString::Printf(TEXT("Save Asset Failed Package is not valid '%s'"), *AssetPath); return;
-	}
-	// Save the package
-	bOutSuccess = UEditorLoadingAndSavingUtils::SavePackages({ Package }, false);
-	OutInfoMessage = FString::Printf(TEXT("Save Asset %s - '%s'"), *FString(bOutSuccess? "Succeeded" : "Failed"), *AssetPath);
+	// Save the package now, or when the open save scope closes
+	bOutSuccess = FScopedPackageSave::RequestSave(Asset, true);
+	OutInfoMessage = FString::Printf(TEXT("Save Asset %s - '%s'"), *FString(bOutSuccess ? (FScopedPackageSave::IsOpen() ? "Deferred" : "Succeeded") : "Failed"), *AssetPath);
+}
+
+bool UPhysicsEditorBPLibrary::RunThenSave(const FPcSaveScopeBody& Body)
+{
+	FScopedPackageSave::Enter();
+	Body.ExecuteIfBound();
+	return FScopedPackageSave::Leave();
 }
@@ -0,0 +1,361 @@
+﻿#include "PhysicsLod.h"
+
+#include "BonePose.h"
+#include "CustomLogging.h"
+#include "EditorAssetLibrary.h"
+#include "JointNames.h"
+#include "MassHierarchy.h"
+#include "PackageSaveScope.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "Utils.h"
+#include "Internationalization/Regex.h"
+#include "Misc/PackageName.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+/** Constraints that end up between the same two kept bodies */
+struct FCollapsedPair
+{
+	TArray<int32> Members;
+	/** Member whose bodies were both kept, it stays where it is */
+	int32 Exact = INDEX_NONE;
+};
+
+static void AddDrives(FConstraintProfileProperties& Into, const FConstraintProfileProperties& From)
+{
+	const FConstraintDrive* FromLinear[] = {&From.LinearDrive.XDrive, &From.LinearDrive.YDrive, &From.LinearDrive.ZDrive};
+	FConstraintDrive* IntoLinear[] = {&Into.LinearDrive.XDrive, &Into.LinearDrive.YDrive, &Into.LinearDrive.ZDrive};
+	const FConstraintDrive* FromAngular[] = {&From.AngularDrive.SwingDrive, &From.AngularDrive.TwistDrive, &From.AngularDrive.SlerpDrive};
+	FConstraintDrive* IntoAngular[] = {&Into.AngularDrive.SwingDrive, &Into.AngularDrive.TwistDrive, &Into.AngularDrive.SlerpDrive};
+	for(int32 i = 0; i < 3; i++)
+	{
+		IntoLinear[i]->Stiffness += FromLinear[i]->Stiffness;
+		IntoLinear[i]->Damping += FromLinear[i]->Damping;
+		IntoAngular[i]->Stiffness += FromAngular[i]->Stiffness;
+		IntoAngular[i]->Damping += FromAngular[i]->Damping;
+	}
+}
+
+static void ScaleDrives(UPhysicsConstraintTemplate* Template, float Scale)
+{
+	if(Scale == 1.f)
+		return;
+	FConstraintProfilePreset Preset;
+	Preset.LinearStrengthScale = Preset.AngularStrengthScale = Scale;
+	Template->DefaultInstance.ProfileInstance = UPhysicsEditorBPLibrary::MakeProfileProperties(Template->DefaultInstance.ProfileInstance, Preset);
+	for(FPhysicsConstraintProfileHandle& Handle : GetProfileHandles(Template))
+		Handle.ProfileProperties = UPhysicsEditorBPLibrary::MakeProfileProperties(Handle.ProfileProperties, Preset);
+}
+
+/** Adds Member's default drives and named profiles to Base. Drives are summed per axis, whatever the frames of the two. */
+static void AddConstraintDrives(UPhysicsConstraintTemplate* Base, const UPhysicsConstraintTemplate* Member)
+{
+	AddDrives(Base->DefaultInstance.ProfileInstance, Member->DefaultInstance.ProfileInstance);
+	for(FPhysicsConstraintProfileHandle& Handle : GetProfileHandles(Base))
+	{
+		const FPhysicsConstraintProfileHandle* MemberHandle = GetProfileHandles(Member).FindByPredicate(
+			[&Handle](const FPhysicsConstraintProfileHandle& H) { return H.ProfileName == Handle.ProfileName; });
+		AddDrives(Handle.ProfileProperties, MemberHandle ? MemberHandle->ProfileProperties : Member->DefaultInstance.ProfileInstance);
+	}
+}
+
+/** Moves Body's shapes into Into's bone space and appends them */
+static void AppendShapes(const FKAggregateGeom& Geom, const FTransform& BodyToInto, FKAggregateGeom& Into)
+{
+	for(const FKSphereElem& Elem : Geom.SphereElems)
+	{
+		FKSphereElem& Copy = Into.SphereElems.Add_GetRef(Elem);
+		Copy.SetTransform(Elem.GetTransform() * BodyToInto);
+	}
+	for(const FKBoxElem& Elem : Geom.BoxElems)
+	{
+		FKBoxElem& Copy = Into.BoxElems.Add_GetRef(Elem);
+		Copy.SetTransform(Elem.GetTransform() * BodyToInto);
+	}
+	for(const FKSphylElem& Elem : Geom.SphylElems)
+	{
+		FKSphylElem& Copy = Into.SphylElems.Add_GetRef(Elem);
+		Copy.SetTransform(Elem.GetTransform() * BodyToInto);
+	}
+	for(const FKTaperedCapsuleElem& Elem : Geom.TaperedCapsuleElems)
+	{
+		FKTaperedCapsuleElem& Copy = Into.TaperedCapsuleElems.Add_GetRef(Elem);
+		Copy.SetTransform(Elem.GetTransform() * BodyToInto);
+	}
+	for(const FKConvexElem& Elem : Geom.ConvexElems)
+	{
+		FKConvexElem& Copy = Into.ConvexElems.Add_GetRef(Elem);
+		Copy.SetTransform(Elem.GetTransform() * BodyToInto);
+	}
+}
+
+/** Replaces the setups of an existing LOD with copies of the source's, keeping the asset object itself */
+static void CopySetups(UPhysicsAsset* PhysicsAsset, const UPhysicsAsset* SourcePhysicsAsset)
+{
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+	PhysicsAsset->SkeletalBodySetups.Reset(SourcePhysicsAsset->SkeletalBodySetups.Num());
+	for(USkeletalBodySetup* BodySetup : SourcePhysicsAsset->SkeletalBodySetups)
+		PhysicsAsset->SkeletalBodySetups.Add(DuplicateObject<USkeletalBodySetup>(BodySetup, PhysicsAsset));
+	PhysicsAsset->ConstraintSetup.Reset(SourcePhysicsAsset->ConstraintSetup.Num());
+	for(UPhysicsConstraintTemplate* Template : SourcePhysicsAsset->ConstraintSetup)
+		PhysicsAsset->ConstraintSetup.Add(DuplicateObject<UPhysicsConstraintTemplate>(Template, PhysicsAsset));
+	PhysicsAsset->CollisionDisableTable = SourcePhysicsAsset->CollisionDisableTable;
+	// Profile names are only exposed to the PhAt editor
+	TArray<FName>* ProfileNames = GetPropertyValuePtr<TArray<FName>>(PhysicsAsset, TEXT("ConstraintProfiles"));
+	if(ProfileNames)
+		*ProfileNames = SourcePhysicsAsset->GetConstraintProfileNames();
+	else
+		LGE("ConstraintProfiles not found on %s, profile names not copied", *PhysicsAsset->GetClass()->GetName())
+	PhysicsAsset->UpdateBodySetupIndexMap();
+	PhysicsAsset->UpdateBoundsBodiesArray();
+}
+
+bool PhysicsLod::Reduce(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& PhatOptions,
+                        const FPhysicsLodOptions& Options, FPhysicsLodReport& OutReport)
+{
+	const FBonePose Pose = FBonePose::FromRefPose(SkeletalMesh);
+	if(!PhysicsAsset || !Pose.IsValid()) {
+		LGE("Physics asset or skeletal mesh not found")
+		return false; }
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsLod", "ReducePhysicsAsset", "Reduce Physics Asset"));
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+	const FReferenceSkeleton& RefSkeleton = *Pose.RefSkeleton;
+	const ETissueLevel DeepestKept = Options.Level == EPhysicsLodLevel::Lod1 ? ETissueLevel::Spoke : ETissueLevel::Core;
+	TArray<FRegexPattern> DropPatterns;
+	for(const FString& Pattern : Options.DropBodyPatterns)
+		DropPatterns.Emplace(Pattern);
+
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	OutReport.NumSourceBodies = NumBodies;
+	OutReport.NumSourceConstraints = PhysicsAsset->ConstraintSetup.Num();
+	TArray<int32> BodyByBone, BoneByBody;
+	BodyByBone.Init(INDEX_NONE, RefSkeleton.GetNum());
+	BoneByBody.Init(INDEX_NONE, NumBodies);
+	TArray<bool> bKeep, bDropped;
+	bKeep.Init(false, NumBodies);
+	bDropped.Init(false, NumBodies);
+	TArray<float> Masses;
+	Masses.SetNumZeroed(NumBodies);
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		// Null entries are dropped like matched bodies, see PhysicsAssetValidation
+		const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[i];
+		if(!BodySetup)
+		{
+			bDropped[i] = true;
+			continue;
+		}
+		const FString Name = BodySetup->BoneName.ToString();
+		for(const FRegexPattern& Pattern : DropPatterns)
+		{
+			FRegexMatcher Matcher(Pattern, Name);
+			if(Matcher.FindNext())
+			{
+				bDropped[i] = true;
+				break;
+			}
+		}
+		bKeep[i] = !bDropped[i] && MassHierarchy::GetTissueLevel(PhatOptions, BodySetup->BoneName) <= DeepestKept;
+		Masses[i] = BodySetup->CalculateMass();
+		BoneByBody[i] = RefSkeleton.FindBoneIndex(BodySetup->BoneName);
+		if(BoneByBody[i] != INDEX_NONE)
+			BodyByBone[BoneByBody[i]] = i;
+	}
+
+	// Every body maps to itself or its closest kept ancestor
+	TArray<int32> Survivor;
+	Survivor.Init(INDEX_NONE, NumBodies);
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		if(bKeep[i])
+		{
+			Survivor[i] = i;
+			continue;
+		}
+		if(!PhysicsAsset->SkeletalBodySetups[i])
+			continue;
+		for(int32 Bone = BoneByBody[i] != INDEX_NONE ? RefSkeleton.GetParentIndex(BoneByBody[i]) : INDEX_NONE; Bone != INDEX_NONE;
+		    Bone = RefSkeleton.GetParentIndex(Bone))
+		{
+			if(BodyByBone[Bone] != INDEX_NONE && bKeep[BodyByBone[Bone]])
+			{
+				Survivor[i] = BodyByBone[Bone];
+				break;
+			}
+		}
+		const int32 Into = Survivor[i];
+		OutReport.BodyMap.Add(PhysicsAsset->SkeletalBodySetups[i]->BoneName,
+		                      Into != INDEX_NONE ? PhysicsAsset->SkeletalBodySetups[Into]->BoneName : NAME_None);
+	}
+
+	// Merge mass and shapes
+	TArray<float> SummedMasses = Masses;
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		const int32 Into = Survivor[i];
+		if(Into == i || Into == INDEX_NONE || bDropped[i])
+			continue;
+		if(Options.bSumMergedMass)
+			SummedMasses[Into] += Masses[i];
+		if(Options.bKeepMergedShapes && BoneByBody[i] != INDEX_NONE && BoneByBody[Into] != INDEX_NONE)
+		{
+			const FTransform BodyToInto = Pose.ComponentSpace[BoneByBody[i]].GetRelativeTransform(Pose.ComponentSpace[BoneByBody[Into]]);
+			AppendShapes(PhysicsAsset->SkeletalBodySetups[i]->AggGeom, BodyToInto, PhysicsAsset->SkeletalBodySetups[Into]->AggGeom);
+		}
+	}
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		if(!bKeep[i])
+			continue;
+		USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[i];
+		if(SummedMasses[i] != Masses[i])
+			BodySetup->DefaultInstance.SetMassOverride(SummedMasses[i]);
+		if(Options.bKeepMergedShapes)
+		{
+			BodySetup->InvalidatePhysicsData();
+			BodySetup->CreatePhysicsMeshes();
+		}
+	}
+
+	// Collapse constraints onto the kept bodies
+	TSet<int32> RemovedConstraints;
+	TMap<TPair<int32, int32>, FCollapsedPair> Pairs;
+	for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+	{
+		if(!PhysicsAsset->ConstraintSetup[i])
+		{
+			RemovedConstraints.Add(i);
+			continue;
+		}
+		const FConstraintInstance& Instance = PhysicsAsset->ConstraintSetup[i]->DefaultInstance;
+		const int32 Child = PhysicsAsset->FindBodyIndex(Instance.ConstraintBone1);
+		const int32 Parent = PhysicsAsset->FindBodyIndex(Instance.ConstraintBone2);
+		if(Child == INDEX_NONE || Parent == INDEX_NONE)
+			continue;
+		// A dropped body's own joint goes with it, joints of its children are re-routed to its closest kept ancestor like merged ones
+		const int32 ChildInto = Survivor[Child], ParentInto = Survivor[Parent];
+		if(ChildInto == INDEX_NONE || ParentInto == INDEX_NONE || ChildInto == ParentInto || bDropped[Child])
+		{
+			RemovedConstraints.Add(i);
+			continue;
+		}
+		FCollapsedPair& Pair = Pairs.FindOrAdd(TPair<int32, int32>(FMath::Min(ChildInto, ParentInto), FMath::Max(ChildInto, ParentInto)));
+		Pair.Members.Add(i);
+		if(ChildInto == Child && ParentInto == Parent)
+			Pair.Exact = i;
+	}
+	for(TPair<TPair<int32, int32>, FCollapsedPair>& Entry : Pairs)
+	{
+		FCollapsedPair& Pair = Entry.Value;
+		const int32 BaseIndex = Pair.Exact != INDEX_NONE ? Pair.Exact : Pair.Members[0];
+		UPhysicsConstraintTemplate* Base = PhysicsAsset->ConstraintSetup[BaseIndex];
+		if(Pair.Exact != INDEX_NONE)
+		{
+			const int32 Child = PhysicsAsset->FindBodyIndex(Base->DefaultInstance.ConstraintBone1);
+			if(Masses[Child] > 0.f)
+				ScaleDrives(Base, SummedMasses[Child] / Masses[Child]);
+		}
+		else
+		{
+			FConstraintInstance& Instance = Base->DefaultInstance;
+			Instance.ConstraintBone1 = PhysicsAsset->SkeletalBodySetups[Survivor[PhysicsAsset->FindBodyIndex(Instance.ConstraintBone1)]]->BoneName;
+			Instance.ConstraintBone2 = PhysicsAsset->SkeletalBodySetups[Survivor[PhysicsAsset->FindBodyIndex(Instance.ConstraintBone2)]]->BoneName;
+			const FName JointName = JointNames::MakePairName(Instance.ConstraintBone1, Instance.ConstraintBone2);
+			if(PhysicsAsset->FindConstraintIndex(JointName) == INDEX_NONE)
+				Instance.JointName = JointName;
+			Instance.SnapTransformsToDefault(EConstraintTransformComponentFlags::All, PhysicsAsset);
+		}
+		for(int32 Member : Pair.Members)
+		{
+			if(Member == BaseIndex)
+				continue;
+			AddConstraintDrives(Base, PhysicsAsset->ConstraintSetup[Member]);
+			RemovedConstraints.Add(Member);
+		}
+	}
+
+	// Collision pairs between kept bodies stay, by name since the indexes shift
+	TArray<TPair<FName, FName>> DisabledPairs;
+	for(const TPair<FRigidBodyIndexPair, bool>& Entry : PhysicsAsset->CollisionDisableTable)
+	{
+		const int32 A = Entry.Key.Indices[0], B = Entry.Key.Indices[1];
+		if(Survivor.IsValidIndex(A) && Survivor.IsValidIndex(B) && bKeep[A] && bKeep[B])
+			DisabledPairs.Emplace(PhysicsAsset->SkeletalBodySetups[A]->BoneName, PhysicsAsset->SkeletalBodySetups[B]->BoneName);
+	}
+
+	TArray<int32> RemovedSorted = RemovedConstraints.Array();
+	RemovedSorted.Sort(TGreater<int32>());
+	for(int32 Index : RemovedSorted)
+		PhysicsAsset->ConstraintSetup.RemoveAt(Index);
+	for(int32 i = NumBodies - 1; i >= 0; i--)
+	{
+		if(!bKeep[i])
+		{
+			if(const USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[i])
+				LGV("  Removing body %s", *BodySetup->BoneName.ToString())
+			PhysicsAsset->SkeletalBodySetups.RemoveAt(i);
+		}
+	}
+	PhysicsAsset->UpdateBodySetupIndexMap();
+	PhysicsAsset->UpdateBoundsBodiesArray();
+
+	PhysicsAsset->CollisionDisableTable.Reset();
+	for(const TPair<FName, FName>& Pair : DisabledPairs)
+		PhysicsAsset->DisableCollision(PhysicsAsset->FindBodyIndex(Pair.Key), PhysicsAsset->FindBodyIndex(Pair.Value));
+	for(const UPhysicsConstraintTemplate* Template : PhysicsAsset->ConstraintSetup)
+	{
+		const int32 Child = PhysicsAsset->FindBodyIndex(Template->DefaultInstance.ConstraintBone1);
+		const int32 Parent = PhysicsAsset->FindBodyIndex(Template->DefaultInstance.ConstraintBone2);
+		if(Child != INDEX_NONE && Parent != INDEX_NONE && !UPhysicsEditorBPLibrary::BodiesIgnoreEachOther(PhysicsAsset, Child, Parent))
+			PhysicsAsset->DisableCollision(Child, Parent);
+	}
+
+	OutReport.NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	OutReport.NumConstraints = PhysicsAsset->ConstraintSetup.Num();
+	LG("Physics LOD %d of %s: %d -> %d bodies, %d -> %d constraints", int32(Options.Level), *PhysicsAsset->GetName(),
+	   OutReport.NumSourceBodies, OutReport.NumBodies, OutReport.NumSourceConstraints, OutReport.NumConstraints)
+	PhysicsAsset->MarkPackageDirty();
+	PhysicsAsset->RefreshPhysicsAssetChange();
+	return true;
+}
+
+UPhysicsAsset* PhysicsLod::Generate(UPhysicsAsset* SourcePhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& PhatOptions,
+                                    const FPhysicsLodOptions& Options, FPhysicsLodReport& OutReport)
+{
+	OutReport = FPhysicsLodReport();
+	if(!SourcePhysicsAsset || !SkeletalMesh) {
+		LGE("Physics asset or skeletal mesh not found")
+		return nullptr; }
+
+	const FString TargetPath = MakeAssetPath(FPackageName::GetLongPackagePath(SourcePhysicsAsset->GetPathName()),
+	                                         SourcePhysicsAsset->GetName() + Options.AssetSuffix + FString::FromInt(int32(Options.Level)));
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsLod", "GeneratePhysicsLod", "Generate Physics LOD"));
+	UPhysicsAsset* PhysicsAsset = nullptr;
+	if(UEditorAssetLibrary::DoesAssetExist(TargetPath))
+	{
+		PhysicsAsset = Cast<UPhysicsAsset>(UEditorAssetLibrary::LoadAsset(TargetPath));
+		if(!PhysicsAsset) {
+			LGE("%s exists and isn't a physics asset", *TargetPath)
+			return nullptr; }
+		CopySetups(PhysicsAsset, SourcePhysicsAsset);
+	}
+	else
+	{
+		PhysicsAsset = Cast<UPhysicsAsset>(UEditorAssetLibrary::DuplicateLoadedAsset(SourcePhysicsAsset, TargetPath));
+		if(!PhysicsAsset) {
+			LGE("Physics asset not duplicated to %s", *TargetPath)
+			return nullptr; }
+	}
+
+	OutReport.AssetPath = PhysicsAsset->GetPathName();
+	if(!Reduce(PhysicsAsset, SkeletalMesh, PhatOptions, Options, OutReport))
+		return nullptr;
+	FScopedPackageSave::RequestSave(PhysicsAsset);
+	return PhysicsAsset;
+}
@@ -0,0 +1,263 @@
+﻿#include "PhysicsSoakBenchmark.h"
+
+#include "CustomLogging.h"
+#include "Utils.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/SkeletalMeshActor.h"
+#include "DataAssets/PcActorDataAsset.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "Internationalization/Regex.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+struct FSoakGroup
+{
+	TArray<int32> Bodies;
+	/** Constraint index, body index 1, body index 2 */
+	TArray<FIntVector> Constraints;
+	double JitterSquaredSum = 0.0;
+	int32 NumJitterSamples = 0;
+};
+
+static UWorld* CreateSoakWorld()
+{
+	UWorld::InitializationValues IVS;
+	IVS.InitializeScenes(false)
+	   .AllowAudioPlayback(false)
+	   .RequiresHitProxies(false)
+	   .CreatePhysicsScene(true)
+	   .CreateNavigation(false)
+	   .CreateAISystem(false)
+	   .ShouldSimulatePhysics(true)
+	   .EnableTraceCollision(false)
+	   .SetTransactional(false)
+	   .CreateFXSystem(false);
+	const FName WorldName = MakeUniqueObjectName(GetTransientPackage(), UWorld::StaticClass(), TEXT("PhysicsSoak"));
+	return UWorld::CreateWorld(EWorldType::GamePreview, false, WorldName, GetTransientPackage(), true, ERHIFeatureLevel::Num, &IVS);
+}
+
+/** Distance between the world space joint frames of the two bodies */
+static float GetJointSeparation(const FConstraintInstance& Constraint, const FBodyInstance* Body1, const FBodyInstance* Body2)
+{
+	const FVector Pos1 = Body1->GetUnrealWorldTransform().TransformPosition(Constraint.GetRefFrame(EConstraintFrame::Frame1).GetLocation());
+	const FVector Pos2 = Body2->GetUnrealWorldTransform().TransformPosition(Constraint.GetRefFrame(EConstraintFrame::Frame2).GetLocation());
+	return FVector::Dist(Pos1, Pos2);
+}
+
+bool PhysicsSoakBenchmark::Run(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, const FPhysicsSoakOptions& Options, FPhysicsSoakResult& OutResult)
+{
+	OutResult = FPhysicsSoakResult();
+	if(!SkeletalMesh || !PhysicsAsset) {
+		LGE("Skeletal mesh or physics asset not found")
+		return false; }
+	OutResult.AssetPath = PhysicsAsset->GetPathName();
+
+	UWorld* World = CreateSoakWorld();
+	FPhysScene* PhysScene = World ? World->GetPhysicsScene() : nullptr;
+	if(!PhysScene) {
+		LGE("Unable to create a physics world")
+		if(World)
+		{
+			World->DestroyWorld(false);
+			World->RemoveFromRoot();
+		}
+		return false; }
+	
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags = RF_Transient;
+	ASkeletalMeshActor* MeshActor = World->SpawnActor<ASkeletalMeshActor>(SpawnParams);
+	USkeletalMeshComponent* SkelMeshComp = MeshActor ? MeshActor->GetSkeletalMeshComponent() : nullptr;
+	if(!SkelMeshComp) {
+		LGE("SkeletalMeshActor unable to be created.")
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+		return false; }
+	SkelMeshComp->SetCollisionProfileName(UCollisionProfile::PhysicsActor_ProfileName);
+	SkelMeshComp->SetSkeletalMesh(SkeletalMesh);
+	SkelMeshComp->SetPhysicsAsset(PhysicsAsset, true);
+	if(Options.Animation)
+	{
+		SkelMeshComp->SetAnimationMode(EAnimationMode::AnimationSingleNode);
+		SkelMeshComp->SetAnimation(Options.Animation);
+		SkelMeshComp->Play(true);
+	}
+	SkelMeshComp->RefreshBoneTransforms();
+
+	// Tissue groups simulate, the rest of the body follows the pose
+	TArray<FRegexPattern> Patterns;
+	for(const FString& PatternString : Options.GroupPatterns)
+		Patterns.Emplace(PatternString);
+	TArray<FSoakGroup> Groups;
+	Groups.SetNum(Patterns.Num());
+	TArray<int32> BodyGroup;
+	BodyGroup.Init(INDEX_NONE, SkelMeshComp->Bodies.Num());
+	for(int32 i = 0; i < SkelMeshComp->Bodies.Num() && i < PhysicsAsset->SkeletalBodySetups.Num(); i++)
+	{
+		if(!PhysicsAsset->SkeletalBodySetups[i] || !SkelMeshComp->Bodies[i])
+			continue;
+		const FString BodyName = PhysicsAsset->SkeletalBodySetups[i]->BoneName.ToString();
+		for(int32 g = 0; g < Patterns.Num(); g++)
+		{
+			FRegexMatcher Matcher(Patterns[g], BodyName);
+			if(Matcher.FindNext())
+			{
+				BodyGroup[i] = g;
+				Groups[g].Bodies.Add(i);
+				SkelMeshComp->Bodies[i]->SetInstanceSimulatePhysics(true);
+				break;
+			}
+		}
+	}
+	for(int32 i = 0; i < PhysicsAsset->ConstraintSetup.Num(); i++)
+	{
+		if(!PhysicsAsset->ConstraintSetup[i])
+			continue;
+		const FConstraintInstance& Constraint = PhysicsAsset->ConstraintSetup[i]->DefaultInstance;
+		const int32 BodyIndex1 = PhysicsAsset->FindBodyIndex(Constraint.ConstraintBone1);
+		const int32 BodyIndex2 = PhysicsAsset->FindBodyIndex(Constraint.ConstraintBone2);
+		// Grouped bodies are non-null, the other end of the joint may not be
+		if(!BodyGroup.IsValidIndex(BodyIndex1) || !BodyGroup.IsValidIndex(BodyIndex2)
+			|| !SkelMeshComp->Bodies[BodyIndex1] || !SkelMeshComp->Bodies[BodyIndex2])
+			continue;
+		const int32 Group = BodyGroup[BodyIndex1] != INDEX_NONE ? BodyGroup[BodyIndex1] : BodyGroup[BodyIndex2];
+		if(Group != INDEX_NONE)
+			Groups[Group].Constraints.Add(FIntVector(i, BodyIndex1, BodyIndex2));
+	}
+
+	OutResult.Groups.SetNum(Groups.Num());
+	for(int32 g = 0; g < Groups.Num(); g++)
+	{
+		OutResult.Groups[g].Group = Options.GroupPatterns[g];
+		OutResult.Groups[g].NumBodies = Groups[g].Bodies.Num();
+		OutResult.Groups[g].NumConstraints = Groups[g].Constraints.Num();
+	}
+
+	// Velocities relative to the root body, so the root motion and animation of the kinematic body don't count as jitter
+	const FBodyInstance* RootBody = SkelMeshComp->GetBodyInstance();
+	TArray<FVector> PrevVelocities;
+	PrevVelocities.Init(FVector::ZeroVector, SkelMeshComp->Bodies.Num());
+	const FVector Gravity(0.f, 0.f, World->GetGravityZ());
+	const FVector StartLocation = SkelMeshComp->GetComponentLocation();
+	const float DeltaTime = Options.DeltaTime;
+	double StepSecondsSum = 0.0;
+	for(int32 Frame = 0; Frame < Options.WarmupFrames + Options.NumFrames && OutResult.bStable; Frame++)
+	{
+		const float Time = Frame * DeltaTime;
+		const FVector Offset = Options.RootMotionAmplitude * FMath::Sin(UE_TWO_PI * Options.RootMotionFrequency * Time);
+		SkelMeshComp->SetWorldLocation(StartLocation + Offset, false, nullptr, ETeleportType::None);
+		if(Options.Animation)
+		{
+			SkelMeshComp->TickAnimation(DeltaTime, false);
+			SkelMeshComp->RefreshBoneTransforms();
+		}
+		SkelMeshComp->UpdateKinematicBonesToAnim(SkelMeshComp->GetComponentSpaceTransforms(), ETeleportType::None, false);
+
+		const double StepStart = FPlatformTime::Seconds();
+		PhysScene->SetUpForFrame(&Gravity, DeltaTime, 0.f, DeltaTime, DeltaTime, 1, false);
+		PhysScene->StartFrame();
+		PhysScene->WaitPhysScenes();
+		PhysScene->EndFrame();
+		const double StepSeconds = FPlatformTime::Seconds() - StepStart;
+
+		const bool bMeasure = Frame >= Options.WarmupFrames;
+		const FVector RootVelocity = RootBody ? RootBody->GetUnrealWorldVelocity() : FVector::ZeroVector;
+		if(bMeasure)
+		{
+			StepSecondsSum += StepSeconds;
+			OutResult.MaxStepMs = FMath::Max(OutResult.MaxStepMs, float(StepSeconds * 1000.0));
+		}
+		for(int32 g = 0; g < Groups.Num(); g++)
+		{
+			FSoakGroup& Group = Groups[g];
+			FPhysicsSoakGroupResult& GroupResult = OutResult.Groups[g];
+			for(const int32 BodyIndex : Group.Bodies)
+			{
+				const FVector Velocity = SkelMeshComp->Bodies[BodyIndex]->GetUnrealWorldVelocity();
+				const float Speed = Velocity.Size();
+				if(!FMath::IsFinite(Speed) || Speed > Options.MaxStableSpeed)
+				{
+					LGW("Body %s unstable at frame %d (%.0f cm/s)", *PhysicsAsset->SkeletalBodySetups[BodyIndex]->BoneName.ToString(), Frame, Speed)
+					OutResult.bStable = false;
+				}
+				const FVector RelativeVelocity = Velocity - RootVelocity;
+				if(bMeasure)
+				{
+					// The first frame has no previous velocity to compare with
+					if(Frame > 0)
+					{
+						Group.JitterSquaredSum += FVector::DistSquared(RelativeVelocity, PrevVelocities[BodyIndex]);
+						Group.NumJitterSamples++;
+					}
+					GroupResult.MaxSpeed = FMath::Max(GroupResult.MaxSpeed, Speed);
+				}
+				PrevVelocities[BodyIndex] = RelativeVelocity;
+			}
+			if(!bMeasure)
+				continue;
+			for(const FIntVector& Constraint : Group.Constraints)
+			{
+				const float Separation = GetJointSeparation(PhysicsAsset->ConstraintSetup[Constraint.X]->DefaultInstance,
+				                                            SkelMeshComp->Bodies[Constraint.Y], SkelMeshComp->Bodies[Constraint.Z]);
+				GroupResult.MaxJointSeparation = FMath::Max(GroupResult.MaxJointSeparation, Separation);
+			}
+		}
+		if(bMeasure)
+			OutResult.NumFrames++;
+	}
+
+	double JitterSquaredSum = 0.0;
+	int32 NumJitterSamples = 0;
+	for(int32 g = 0; g < Groups.Num(); g++)
+	{
+		FPhysicsSoakGroupResult& GroupResult = OutResult.Groups[g];
+		GroupResult.VelocityJitter = Groups[g].NumJitterSamples > 0 ? float(FMath::Sqrt(Groups[g].JitterSquaredSum / Groups[g].NumJitterSamples)) : 0.f;
+		JitterSquaredSum += Groups[g].JitterSquaredSum;
+		NumJitterSamples += Groups[g].NumJitterSamples;
+		OutResult.MaxJointSeparation = FMath::Max(OutResult.MaxJointSeparation, GroupResult.MaxJointSeparation);
+		LG("  %s: %d bodies, %d constraints, max separation %.3f cm, jitter %.2f cm/s, max speed %.0f cm/s", *GroupResult.Group,
+		   GroupResult.NumBodies, GroupResult.NumConstraints, GroupResult.MaxJointSeparation, GroupResult.VelocityJitter, GroupResult.MaxSpeed)
+	}
+	OutResult.VelocityJitter = NumJitterSamples > 0 ? float(FMath::Sqrt(JitterSquaredSum / NumJitterSamples)) : 0.f;
+	OutResult.AvgStepMs = OutResult.NumFrames > 0 ? float(StepSecondsSum * 1000.0 / OutResult.NumFrames) : 0.f;
+	OutResult.StabilityScore = OutResult.bStable ? 100.f / (1.f + OutResult.MaxJointSeparation + OutResult.VelocityJitter / 10.f) : 0.f;
+	LG("Soak %s: %d frames, step %.3f ms avg / %.3f ms max, score %.1f%s", *OutResult.AssetPath, OutResult.NumFrames,
+	   OutResult.AvgStepMs, OutResult.MaxStepMs, OutResult.StabilityScore, OutResult.bStable ? TEXT("") : TEXT(" (unstable)"))
+
+	MeshActor->Destroy();
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	return true;
+}
+
+USkeletalMesh* PhysicsSoakBenchmark::GetSoakMesh(const UPcActorDataAsset* DataAsset)
+{
+	if(!DataAsset)
+		return nullptr;
+	if(DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache) {
+		LGE("%s is in RefPoseCache mode, bake its morph variant to a skeletal mesh to soak it", *DataAsset->GetName())
+		return nullptr; }
+	return DataAsset->GetTargetSkeletalMesh();
+}
+
+FString PhysicsSoakBenchmark::ToCsv(const FPhysicsSoakResult& Result, const FString& Timestamp, bool bWithHeader)
+{
+	FString Csv;
+	if(bWithHeader)
+		Csv = TEXT("Timestamp,Asset,Group,Bodies,Constraints,Frames,AvgStepMs,MaxStepMs,MaxJointSeparation,VelocityJitter,MaxSpeed,Stable,Score\n");
+	for(const FPhysicsSoakGroupResult& Group : Result.Groups)
+	{
+		Csv += FString::Printf(TEXT("%s,%s,%s,%d,%d,%d,,,%f,%f,%f,,\n"), *Timestamp, *CsvField(Result.AssetPath), *CsvField(Group.Group),
+		                       Group.NumBodies, Group.NumConstraints, Result.NumFrames, Group.MaxJointSeparation, Group.VelocityJitter, Group.MaxSpeed);
+	}
+	Csv += FString::Printf(TEXT("%s,%s,,,,%d,%f,%f,%f,%f,,%d,%f\n"), *Timestamp, *CsvField(Result.AssetPath), Result.NumFrames,
+	                       Result.AvgStepMs, Result.MaxStepMs, Result.MaxJointSeparation, Result.VelocityJitter, Result.bStable ? 1 : 0,
+	                       Result.StabilityScore);
+	return Csv;
+}
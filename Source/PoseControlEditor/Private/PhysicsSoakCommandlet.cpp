@@ -0,0 +1,93 @@
+﻿#include "PhysicsSoakCommandlet.h"
+
+#include "CustomLogging.h"
+#include "PhysicsSoakBenchmark.h"
+#include "Animation/AnimSequence.h"
+#include "DataAssets/PcActorDataAsset.h"
+#include "Engine/SkeletalMesh.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+UPhysicsSoakCommandlet::UPhysicsSoakCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UPhysicsSoakCommandlet::Main(const FString& Params)
+{
+	FPhysicsSoakOptions Options;
+	FString Value;
+	if(FParse::Value(*Params, TEXT("Anim="), Value))
+	{
+		Options.Animation = LoadObject<UAnimSequence>(nullptr, *Value);
+		if(!Options.Animation)
+			LGW("Animation %s not found, using root motion only", *Value)
+	}
+	FParse::Value(*Params, TEXT("Frames="), Options.NumFrames);
+	FParse::Value(*Params, TEXT("Warmup="), Options.WarmupFrames);
+	FString CsvPath = FPaths::ProjectSavedDir() / TEXT("PhysicsSoak.csv");
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+
+	TArray<TPair<USkeletalMesh*, UPhysicsAsset*>> Targets;
+	TArray<FString> Paths;
+	if(FParse::Value(*Params, TEXT("DataAsset="), Value, false))
+	{
+		Value.ParseIntoArray(Paths, TEXT(","));
+		for(const FString& Path : Paths)
+		{
+			UPcActorDataAsset* DataAsset = LoadObject<UPcActorDataAsset>(nullptr, *Path);
+			if(!DataAsset) {
+				LGE("Data asset %s not found", *Path)
+				return 1; }
+			USkeletalMesh* SkeletalMesh = PhysicsSoakBenchmark::GetSoakMesh(DataAsset);
+			if(!SkeletalMesh)
+				return 1;
+			Targets.Emplace(SkeletalMesh, DataAsset->GetTargetPhysicsAsset());
+		}
+	}
+	else
+	{
+		// Paired by position, a single mesh is shared by every physics asset
+		TArray<FString> MeshPaths;
+		if(FParse::Value(*Params, TEXT("Mesh="), Value, false))
+			Value.ParseIntoArray(MeshPaths, TEXT(","));
+		if(FParse::Value(*Params, TEXT("PhysicsAsset="), Value, false))
+			Value.ParseIntoArray(Paths, TEXT(","));
+		if(MeshPaths.IsEmpty() || Paths.IsEmpty() || (MeshPaths.Num() != 1 && MeshPaths.Num() != Paths.Num())) {
+			LGE("Expected -Mesh= with one path or one per -PhysicsAsset= path, got %d meshes and %d physics assets", MeshPaths.Num(), Paths.Num())
+			return 1; }
+		for(int32 i = 0; i < Paths.Num(); i++)
+		{
+			const FString& MeshPath = MeshPaths[MeshPaths.Num() == 1 ? 0 : i];
+			Targets.Emplace(LoadObject<USkeletalMesh>(nullptr, *MeshPath), LoadObject<UPhysicsAsset>(nullptr, *Paths[i]));
+		}
+	}
+
+	const FString Timestamp = FDateTime::UtcNow().ToIso8601();
+	FString Csv;
+	int32 ReturnCode = 0;
+	for(const TPair<USkeletalMesh*, UPhysicsAsset*>& Target : Targets)
+	{
+		FPhysicsSoakResult Result;
+		if(!PhysicsSoakBenchmark::Run(Target.Key, Target.Value, Options, Result))
+		{
+			ReturnCode = 1;
+			continue;
+		}
+		if(!Result.bStable)
+			ReturnCode = 1;
+		Csv += PhysicsSoakBenchmark::ToCsv(Result, Timestamp, Csv.IsEmpty() && !FPaths::FileExists(CsvPath));
+	}
+	if(!Csv.IsEmpty() && !FFileHelper::SaveStringToFile(Csv, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append)) {
+		LGE("Unable to write %s", *CsvPath)
+		return 1; }
+	LG("Soak results appended to %s", *CsvPath)
+	return ReturnCode;
+}
@@ -3,10 +3,9 @@
 #include "PoseControlEditor.h"
 #include "PoseControlEditorStyle.h"
 #include "PoseControlEditorCommands.h"
+#include "SPoseControlDashboard.h"
 #include "LevelEditor.h"
 #include "Widgets/Docking/SDockTab.h"
-#include "Widgets/Layout/SBox.h"
-#include "Widgets/Text/STextBlock.h"
 #include "ToolMenus.h"
 #include "CustomLogging.h"
 
@@ -61,23 +60,10 @@ void FPoseControlEditorModule::ShutdownModule()
 
 TSharedRef<SDockTab> FPoseControlEditorModule::OnSpawnPluginTab(const FSpawnTabArgs& SpawnTabArgs)
 {
-	FText WidgetText = FText::Format(
-		LOCTEXT("WindowWidgetText", "Add code to {0} in {1} to override this window's contents"),
-		FText::FromString(TEXT("FPoseControlEditorModule::OnSpawnPluginTab")),
-		FText::FromString(TEXT("PoseControlEditor.cpp"))
-		);
-
 	return SNew(SDockTab)
 		.TabRole(ETabRole::NomadTab)
 		[
-			// Put your tab content here!
-			SNew(SBox)
-			.HAlign(HAlign_Center)
-			.VAlign(VAlign_Center)
-			[
-				SNew(STextBlock)
-				.Text(WidgetText)
-			]
+			SNew(SPoseControlDashboard)
 		];
 }
 
@@ -0,0 +1,357 @@
+﻿#include "SPoseControlDashboard.h"
+
+#include "CustomLogging.h"
+#include "PhysicsAssetCost.h"
+#include "PropertyCustomizationHelpers.h"
+#include "DataAssets/PcActorDataAsset.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "Widgets/Input/SButton.h"
+#include "Widgets/Input/SCheckBox.h"
+#include "Widgets/Layout/SScrollBox.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Widgets/Views/SHeaderRow.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+#define LOCTEXT_NAMESPACE "SPoseControlDashboard"
+
+TWeakObjectPtr<UPcActorDataAsset> SPoseControlDashboard::LastDataAsset;
+
+namespace DashboardColumns
+{
+	static const FName Stage("Stage");
+	static const FName Status("Status");
+	static const FName Seconds("Seconds");
+	static const FName Bodies("Bodies");
+	static const FName Constraints("Constraints");
+	static const FName CacheHits("CacheHits");
+	static const FName SessionSeconds("SessionSeconds");
+	static const FName Rerun("Rerun");
+	static const FName Group("Group");
+	static const FName SolverRows("SolverRows");
+	static const FName Shapes("Shapes");
+	static const FName AssetBytes("AssetBytes");
+	static const FName InstanceBytes("InstanceBytes");
+}
+
+static FText GetStageText(EPcPipelineStage Stage)
+{
+	return StaticEnum<EPcPipelineStage>()->GetDisplayNameTextByValue(int64(Stage));
+}
+
+static FText BytesText(int64 Bytes)
+{
+	return FText::AsMemory(Bytes, EMemoryUnitStandard::IEC);
+}
+
+/** The point group patterns of the constraint options, so the cost groups line up with what generated them */
+static TArray<FString> GetGroupPatterns(const FPhatConstraintOptions& Options)
+{
+	TArray<FString> Patterns;
+	for(const FAddPointConstraints* Group : {&Options.GluteCores, &Options.GluteSpokes, &Options.GlutePoints,
+	                                         &Options.BreastCores, &Options.BreastSpokes, &Options.BreastPoints})
+	{
+		if(!Group->PointPatternString.IsEmpty())
+			Patterns.AddUnique(Group->PointPatternString);
+	}
+	return Patterns;
+}
+
+class SPcStageRow : public SMultiColumnTableRow<SPoseControlDashboard::FStageRowPtr>
+{
+public:
+	SLATE_BEGIN_ARGS(SPcStageRow) {}
+		SLATE_EVENT(FOnClicked, OnRerun)
+		SLATE_ATTRIBUTE(bool, CanRerun)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& OwnerTable, SPoseControlDashboard::FStageRowPtr InRow)
+	{
+		Row = InRow;
+		OnRerun = InArgs._OnRerun;
+		CanRerun = InArgs._CanRerun;
+		SMultiColumnTableRow::Construct(FSuperRowType::FArguments(), OwnerTable);
+	}
+
+	virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& ColumnName) override
+	{
+		using namespace DashboardColumns;
+		const TOptional<FPcPipelineStageResult>& Result = Row->Result;
+		const FPcPipelineStageStats& Stats = Row->Stats;
+		if(ColumnName == Rerun)
+		{
+			return SNew(SButton)
+				.Text(LOCTEXT("Rerun", "Rerun"))
+				.ToolTipText(LOCTEXT("RerunTooltip", "Runs only this stage, ignoring its recorded hash. Later stages rerun on the next full run."))
+				.IsEnabled(CanRerun)
+				.OnClicked(OnRerun);
+		}
+		FText Text;
+		if(ColumnName == Stage)
+			Text = GetStageText(Row->Stage);
+		else if(ColumnName == CacheHits)
+			Text = Stats.NumLookups > 0
+				? FText::Format(LOCTEXT("CacheHitsFormat", "{0} / {1} ({2})"), Stats.NumHits, Stats.NumLookups, FText::AsPercent(Stats.GetHitRate()))
+				: LOCTEXT("NoLookups", "-");
+		else if(ColumnName == SessionSeconds)
+			Text = FText::AsNumber(Stats.TotalSeconds, &FNumberFormattingOptions::DefaultNoGrouping());
+		else if(!Result.IsSet())
+			Text = LOCTEXT("NotRun", "-");
+		else if(ColumnName == Status)
+			Text = Result->bSkipped ? LOCTEXT("Skipped", "Cached") : Result->bSuccess ? LOCTEXT("Ran", "Ran") : LOCTEXT("Failed", "Failed");
+		else if(ColumnName == Seconds)
+			Text = Result->bSkipped ? LOCTEXT("NoSeconds", "-") : FText::AsNumber(Result->Seconds, &FNumberFormattingOptions::DefaultNoGrouping());
+		else if(ColumnName == Bodies)
+			Text = FText::AsNumber(Result->NumBodies);
+		else if(ColumnName == Constraints)
+			Text = FText::AsNumber(Result->NumConstraints);
+		return SNew(STextBlock).Text(Text);
+	}
+
+private:
+	SPoseControlDashboard::FStageRowPtr Row;
+	FOnClicked OnRerun;
+	TAttribute<bool> CanRerun;
+};
+
+class SPcGroupRow : public SMultiColumnTableRow<SPoseControlDashboard::FGroupRowPtr>
+{
+public:
+	SLATE_BEGIN_ARGS(SPcGroupRow) {}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& OwnerTable, SPoseControlDashboard::FGroupRowPtr InRow)
+	{
+		Row = InRow;
+		SMultiColumnTableRow::Construct(FSuperRowType::FArguments(), OwnerTable);
+	}
+
+	virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& ColumnName) override
+	{
+		using namespace DashboardColumns;
+		FText Text;
+		if(ColumnName == Group)
+			Text = FText::FromName(Row->Group);
+		else if(ColumnName == Bodies)
+			Text = FText::AsNumber(Row->NumBodies);
+		else if(ColumnName == Constraints)
+			Text = FText::AsNumber(Row->NumConstraints);
+		else if(ColumnName == SolverRows)
+			Text = FText::AsNumber(Row->SolverRows);
+		else if(ColumnName == Shapes)
+			Text = FText::AsNumber(Row->GetNumShapes());
+		else if(ColumnName == AssetBytes)
+			Text = BytesText(Row->AssetBytes);
+		else if(ColumnName == InstanceBytes)
+			Text = BytesText(Row->InstanceBytes);
+		return SNew(STextBlock).Text(Text);
+	}
+
+private:
+	SPoseControlDashboard::FGroupRowPtr Row;
+};
+
+SPoseControlDashboard::~SPoseControlDashboard()
+{
+	UPcCharacterPipeline::OnAnyPipelineFinished().Remove(PipelineFinishedHandle);
+}
+
+void SPoseControlDashboard::Construct(const FArguments& InArgs)
+{
+	using namespace DashboardColumns;
+	DataAsset = LastDataAsset;
+	PipelineFinishedHandle = UPcCharacterPipeline::OnAnyPipelineFinished().AddSP(this, &SPoseControlDashboard::OnPipelineFinished);
+
+	ChildSlot
+	[
+		SNew(SScrollBox)
+		+ SScrollBox::Slot()
+		.Padding(4.f)
+		[
+			SNew(SHorizontalBox)
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.f)
+			[
+				SNew(SObjectPropertyEntryBox)
+				.AllowedClass(UPcActorDataAsset::StaticClass())
+				.ObjectPath_Lambda([this]() { return DataAsset.IsValid() ? DataAsset->GetPathName() : FString(); })
+				.OnObjectChanged(this, &SPoseControlDashboard::OnDataAssetChanged)
+				.AllowClear(true)
+				.DisplayThumbnail(false)
+			]
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(8.f, 0.f)
+			.VAlign(VAlign_Center)
+			[
+				SNew(SCheckBox)
+				.IsChecked_Lambda([this]() { return BakeOptions.bForceRebuild ? ECheckBoxState::Checked : ECheckBoxState::Unchecked; })
+				.OnCheckStateChanged_Lambda([this](ECheckBoxState State) { BakeOptions.bForceRebuild = State == ECheckBoxState::Checked; })
+				[
+					SNew(STextBlock).Text(LOCTEXT("ForceRebuild", "Force Rebuild"))
+				]
+			]
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			[
+				SNew(SButton)
+				.Text(LOCTEXT("RunPipeline", "Run Pipeline"))
+				.IsEnabled(this, &SPoseControlDashboard::CanRun)
+				.OnClicked(this, &SPoseControlDashboard::RunPipeline)
+			]
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(4.f, 0.f, 0.f, 0.f)
+			[
+				SNew(SButton)
+				.Text(LOCTEXT("Refresh", "Refresh"))
+				.OnClicked_Lambda([this]() { Refresh(); return FReply::Handled(); })
+			]
+		]
+		+ SScrollBox::Slot()
+		.Padding(4.f)
+		[
+			SAssignNew(StageList, SListView<FStageRowPtr>)
+			.ListItemsSource(&StageRows)
+			.SelectionMode(ESelectionMode::None)
+			.OnGenerateRow(this, &SPoseControlDashboard::MakeStageRow)
+			.HeaderRow
+			(
+				SNew(SHeaderRow)
+				+ SHeaderRow::Column(Stage).DefaultLabel(LOCTEXT("StageColumn", "Stage")).FillWidth(2.f)
+				+ SHeaderRow::Column(Status).DefaultLabel(LOCTEXT("StatusColumn", "Last Run"))
+				+ SHeaderRow::Column(Seconds).DefaultLabel(LOCTEXT("SecondsColumn", "Seconds"))
+				+ SHeaderRow::Column(Bodies).DefaultLabel(LOCTEXT("BodiesColumn", "Bodies"))
+				+ SHeaderRow::Column(Constraints).DefaultLabel(LOCTEXT("ConstraintsColumn", "Constraints"))
+				+ SHeaderRow::Column(CacheHits).DefaultLabel(LOCTEXT("CacheHitsColumn", "Session Cache Hits")).FillWidth(1.5f)
+				+ SHeaderRow::Column(SessionSeconds).DefaultLabel(LOCTEXT("SessionSecondsColumn", "Session Seconds"))
+				+ SHeaderRow::Column(Rerun).DefaultLabel(FText::GetEmpty()).FixedWidth(64.f)
+			)
+		]
+		+ SScrollBox::Slot()
+		.Padding(4.f)
+		[
+			SNew(STextBlock)
+			.Text(this, &SPoseControlDashboard::GetSummaryText)
+		]
+		+ SScrollBox::Slot()
+		.Padding(4.f)
+		[
+			SAssignNew(GroupList, SListView<FGroupRowPtr>)
+			.ListItemsSource(&GroupRows)
+			.SelectionMode(ESelectionMode::None)
+			.OnGenerateRow(this, &SPoseControlDashboard::MakeGroupRow)
+			.HeaderRow
+			(
+				SNew(SHeaderRow)
+				+ SHeaderRow::Column(Group).DefaultLabel(LOCTEXT("GroupColumn", "Group")).FillWidth(2.f)
+				+ SHeaderRow::Column(Bodies).DefaultLabel(LOCTEXT("GroupBodiesColumn", "Bodies"))
+				+ SHeaderRow::Column(Constraints).DefaultLabel(LOCTEXT("GroupConstraintsColumn", "Constraints"))
+				+ SHeaderRow::Column(SolverRows).DefaultLabel(LOCTEXT("SolverRowsColumn", "Solver Rows"))
+				+ SHeaderRow::Column(Shapes).DefaultLabel(LOCTEXT("ShapesColumn", "Shapes"))
+				+ SHeaderRow::Column(AssetBytes).DefaultLabel(LOCTEXT("AssetBytesColumn", "Asset Memory"))
+				+ SHeaderRow::Column(InstanceBytes).DefaultLabel(LOCTEXT("InstanceBytesColumn", "Per Instance"))
+			)
+		]
+	];
+
+	Refresh();
+}
+
+void SPoseControlDashboard::Refresh()
+{
+	StageRows.Reset();
+	GroupRows.Reset();
+	bHasCostReport = false;
+
+	const UPcActorDataAsset* Asset = DataAsset.Get();
+	const TArray<FPcPipelineStageResult>* Results = UPcCharacterPipeline::GetLastResults(Asset);
+	for(const FPcPipelineStageStats& Stats : UPcCharacterPipeline::GetSessionStats())
+	{
+		FStageRowPtr Row = MakeShared<FStageRow>();
+		Row->Stage = Stats.Stage;
+		Row->Stats = Stats;
+		if(Results)
+		{
+			if(const FPcPipelineStageResult* Result = Results->FindByPredicate([&Stats](const FPcPipelineStageResult& R) { return R.Stage == Stats.Stage; }))
+				Row->Result = *Result;
+		}
+		StageRows.Add(Row);
+	}
+
+	// Don't load the target just to report on it
+	const UPhysicsAsset* PhysicsAsset = Asset ? Asset->TargetPhysicsAsset.Get() : nullptr;
+	if(PhysicsAsset)
+	{
+		bHasCostReport = PhysicsAssetCost::BuildReport(PhysicsAsset, GetGroupPatterns(Asset->PhatConstraintOptions), CostReport);
+		if(bHasCostReport)
+		{
+			for(const FPhysicsGroupCost& Group : CostReport.Groups)
+				GroupRows.Add(MakeShared<FPhysicsGroupCost>(Group));
+			GroupRows.Sort([](const FGroupRowPtr& A, const FGroupRowPtr& B) { return A->InstanceBytes > B->InstanceBytes; });
+		}
+	}
+
+	if(StageList)
+		StageList->RequestListRefresh();
+	if(GroupList)
+		GroupList->RequestListRefresh();
+}
+
+void SPoseControlDashboard::OnPipelineFinished(UPcActorDataAsset* InDataAsset, bool bSuccess)
+{
+	// Session stats cover every data asset, so any pipeline changes them
+	Refresh();
+}
+
+void SPoseControlDashboard::OnDataAssetChanged(const FAssetData& AssetData)
+{
+	DataAsset = Cast<UPcActorDataAsset>(AssetData.GetAsset());
+	LastDataAsset = DataAsset;
+	Refresh();
+}
+
+bool SPoseControlDashboard::CanRun() const
+{
+	return DataAsset.IsValid() && !(ActivePipeline.IsValid() && ActivePipeline->IsRunning());
+}
+
+FReply SPoseControlDashboard::RunPipeline()
+{
+	ActivePipeline = UPcCharacterPipeline::RunCharacterPipeline(DataAsset.Get(), BakeOptions);
+	return FReply::Handled();
+}
+
+FReply SPoseControlDashboard::RunStage(EPcPipelineStage Stage)
+{
+	ActivePipeline = UPcCharacterPipeline::RunCharacterPipelineStage(DataAsset.Get(), BakeOptions, Stage);
+	return FReply::Handled();
+}
+
+TSharedRef<ITableRow> SPoseControlDashboard::MakeStageRow(FStageRowPtr Row, const TSharedRef<STableViewBase>& OwnerTable)
+{
+	return SNew(SPcStageRow, OwnerTable, Row)
+		.OnRerun(this, &SPoseControlDashboard::RunStage, Row->Stage)
+		.CanRerun(this, &SPoseControlDashboard::CanRun);
+}
+
+TSharedRef<ITableRow> SPoseControlDashboard::MakeGroupRow(FGroupRowPtr Row, const TSharedRef<STableViewBase>& OwnerTable)
+{
+	return SNew(SPcGroupRow, OwnerTable, Row);
+}
+
+FText SPoseControlDashboard::GetSummaryText() const
+{
+	if(!DataAsset.IsValid())
+		return LOCTEXT("NoDataAsset", "Pick a character data asset.");
+	if(!bHasCostReport)
+		return LOCTEXT("NoTarget", "Target physics asset isn't loaded. Run the pipeline or open it, then refresh.");
+	const FPhysicsCostTotals& Totals = CostReport.Totals;
+	return FText::Format(LOCTEXT("SummaryFormat",
+		"{0}: {1} bodies, {2} constraints, {3} solver rows, {4} collision disable pairs. Asset memory {5}, per instance {6}."),
+		FText::FromString(CostReport.AssetPath), CostReport.NumBodies, Totals.NumConstraints, Totals.SolverRows,
+		CostReport.NumCollisionDisablePairs, BytesText(Totals.AssetBytes), BytesText(Totals.InstanceBytes));
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,100 @@
+﻿#include "SkinSurface.h"
+
+#include "CustomLogging.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "ConversionUtils/SceneComponentToDynamicMesh.h"
+#include "Distance/DistPoint3Triangle3.h"
+#include "Engine/SkeletalMesh.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Rendering/SkeletalMeshModel.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+TSharedPtr<const FSkinSurface> FSkinSurface::FromComponent(const USkeletalMeshComponent* SkeletalMeshComponent)
+{
+	if(!SkeletalMeshComponent)
+		return nullptr;
+	TSharedPtr<FSkinSurface> Surface = MakeShared<FSkinSurface>();
+	FTransform LocalToWorld;
+	FText ErrorMessage;
+	// The conversion only reads the component
+	if(!UE::Conversion::SceneComponentToDynamicMesh(const_cast<USkeletalMeshComponent*>(SkeletalMeshComponent), UE::Conversion::FToMeshOptions(),
+	                                                true, Surface->Mesh, LocalToWorld, ErrorMessage)) {
+		LGE("Skin of %s not converted: %s", *SkeletalMeshComponent->GetName(), *ErrorMessage.ToString())
+		return nullptr; }
+	Surface->BuildTree();
+	return Surface;
+}
+
+TSharedPtr<const FSkinSurface> FSkinSurface::FromRefPose(const USkeletalMesh* SkeletalMesh)
+{
+	const FSkeletalMeshModel* Model = SkeletalMesh ? SkeletalMesh->GetImportedModel() : nullptr;
+	if(!Model || Model->LODModels.IsEmpty()) {
+		LGE("No imported model to build the skin from")
+		return nullptr; }
+
+	TSharedPtr<FSkinSurface> Surface = MakeShared<FSkinSurface>();
+	const FSkeletalMeshLODModel& LODModel = Model->LODModels[0];
+	// Section vertices are laid out back to back, in the order the index buffer refers to them
+	for(const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for(const FSoftSkinVertex& Vertex : Section.SoftVertices)
+			Surface->Mesh.AppendVertex(FVector3d(Vertex.Position));
+	}
+	Surface->AppendTriangles(LODModel);
+	Surface->BuildTree();
+	return Surface;
+}
+
+TSharedPtr<const FSkinSurface> FSkinSurface::FromVertices(const USkeletalMesh* SkeletalMesh, TConstArrayView<FVector3f> Positions)
+{
+	const FSkeletalMeshModel* Model = SkeletalMesh ? SkeletalMesh->GetImportedModel() : nullptr;
+	if(!Model || Model->LODModels.IsEmpty()) {
+		LGE("No imported model to build the skin from")
+		return nullptr; }
+	const FSkeletalMeshLODModel& LODModel = Model->LODModels[0];
+	if(Positions.Num() != int32(LODModel.NumVertices)) {
+		LGE("Skin of %s has %d vertices, %d positions given", *SkeletalMesh->GetName(), LODModel.NumVertices, Positions.Num())
+		return nullptr; }
+
+	TSharedPtr<FSkinSurface> Surface = MakeShared<FSkinSurface>();
+	for(const FVector3f& Position : Positions)
+		Surface->Mesh.AppendVertex(FVector3d(Position));
+	Surface->AppendTriangles(LODModel);
+	Surface->BuildTree();
+	return Surface;
+}
+
+void FSkinSurface::AppendTriangles(const FSkeletalMeshLODModel& LODModel)
+{
+	for(const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for(uint32 i = 0; i < Section.NumTriangles; i++)
+		{
+			const uint32 Base = Section.BaseIndex + i * 3;
+			Mesh.AppendTriangle(int32(LODModel.IndexBuffer[Base]), int32(LODModel.IndexBuffer[Base + 1]), int32(LODModel.IndexBuffer[Base + 2]));
+		}
+	}
+}
+
+void FSkinSurface::BuildTree()
+{
+	Tree = MakeUnique<UE::Geometry::FDynamicMeshAABBTree3>(&Mesh, true);
+	LGV("Skin surface: %d triangles", Mesh.TriangleCount())
+}
+
+bool FSkinSurface::FindNearest(const FVector& Point, FVector& OutSurfacePoint, FVector& OutNormal) const
+{
+	double DistanceSqr;
+	const int32 TriangleId = Tree ? Tree->FindNearestTriangle(Point, DistanceSqr) : IndexConstants::InvalidID;
+	if(TriangleId == IndexConstants::InvalidID)
+		return false;
+	FVector3d A, B, C;
+	Mesh.GetTriVertices(TriangleId, A, B, C);
+	UE::Geometry::FDistPoint3Triangle3d Distance(Point, UE::Geometry::FTriangle3d(A, B, C));
+	Distance.GetSquared();
+	OutSurfacePoint = Distance.ClosestTrianglePoint;
+	OutNormal = Mesh.GetTriNormal(TriangleId);
+	return true;
+}
@@ -0,0 +1,299 @@
+﻿#include "SolverOrdering.h"
+
+#include "CustomLogging.h"
+#include "MassHierarchy.h"
+#include "PhysicsAssetTransaction.h"
+#include "Algo/Reverse.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+/** Bodies as nodes, constraints as edges. Traversals stay inside the region of the body they start from. */
+struct FOrderingGraph
+{
+	TArray<TArray<int32>> Neighbors;
+	/** 0 for skeleton bodies (every body when not grouping), then one per tissue group */
+	TArray<int32> Regions;
+	/** Neighbors in the same region */
+	TArray<int32> Degrees;
+
+	/** Appends Root's component breadth first, neighbors by ascending degree. Returns the number of levels. */
+	int32 Traverse(int32 Root, TBitArray<>& Visited, TArray<int32>& OutOrder, int32* OutLastLevelStart = nullptr) const
+	{
+		int32 Head = OutOrder.Num(), NumLevels = 0;
+		OutOrder.Add(Root);
+		Visited[Root] = true;
+		while(Head < OutOrder.Num())
+		{
+			if(OutLastLevelStart)
+				*OutLastLevelStart = Head;
+			NumLevels++;
+			for(const int32 LevelEnd = OutOrder.Num(); Head < LevelEnd; Head++)
+			{
+				const int32 Node = OutOrder[Head];
+				for(const int32 Neighbor : Neighbors[Node])
+				{
+					if(!Visited[Neighbor] && Regions[Neighbor] == Regions[Node])
+					{
+						Visited[Neighbor] = true;
+						OutOrder.Add(Neighbor);
+					}
+				}
+			}
+		}
+		return NumLevels;
+	}
+
+	/** George-Liu: restarts from the lowest degree body of the last level for as long as that deepens the traversal */
+	int32 FindPeripheralNode(int32 Node) const
+	{
+		TArray<int32> Order;
+		int32 NumLevels = 0;
+		for(int32 Iteration = 0; Iteration < 8; Iteration++)
+		{
+			TBitArray<> Visited(false, Neighbors.Num());
+			int32 LastLevelStart = 0;
+			Order.Reset();
+			const int32 Levels = Traverse(Node, Visited, Order, &LastLevelStart);
+			if(Levels <= NumLevels)
+				break;
+			NumLevels = Levels;
+			for(int32 i = LastLevelStart; i < Order.Num(); i++)
+			{
+				if(i == LastLevelStart || Degrees[Order[i]] < Degrees[Node])
+					Node = Order[i];
+			}
+		}
+		return Node;
+	}
+};
+
+static void MeasureSpans(const TArray<TPair<int32, int32>>& Edges, const TArray<int32>& NewIndexes, int32& OutBandwidth, float& OutMeanSpan)
+{
+	int64 Sum = 0;
+	int32 Count = 0;
+	OutBandwidth = 0;
+	for(const TPair<int32, int32>& Edge : Edges)
+	{
+		if(Edge.Key == INDEX_NONE)
+			continue;
+		const int32 Span = FMath::Abs(NewIndexes[Edge.Key] - NewIndexes[Edge.Value]);
+		OutBandwidth = FMath::Max(OutBandwidth, Span);
+		Sum += Span;
+		Count++;
+	}
+	OutMeanSpan = Count > 0 ? float(double(Sum) / Count) : 0.f;
+}
+
+bool SolverOrdering::Reorder(UPhysicsAsset* PhysicsAsset, const FPhatConstraintOptions& PhatOptions, const FSolverOrderingOptions& Options,
+                             FSolverOrderingReport& OutReport)
+{
+	OutReport = FSolverOrderingReport();
+	if(!PhysicsAsset) {
+		LGE("Physics asset not found")
+		return false; }
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	const int32 NumConstraints = PhysicsAsset->ConstraintSetup.Num();
+
+	TMap<FName, int32> BodyIndexes;
+	BodyIndexes.Reserve(NumBodies);
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		const USkeletalBodySetup* Body = PhysicsAsset->SkeletalBodySetups[i];
+		if(!Body) {
+			LGE("Null body setup %d in %s, run FixPhysicsAsset first", i, *PhysicsAsset->GetName())
+			return false; }
+		BodyIndexes.Add(Body->BoneName, i);
+	}
+
+	// Body pair of each constraint, INDEX_NONE for broken ones, which go last
+	TArray<TPair<int32, int32>> ConstraintBodies;
+	ConstraintBodies.Init(TPair<int32, int32>(INDEX_NONE, INDEX_NONE), NumConstraints);
+	FOrderingGraph Graph;
+	Graph.Neighbors.SetNum(NumBodies);
+	Graph.Regions.Init(0, NumBodies);
+	Graph.Degrees.Init(0, NumBodies);
+	for(int32 c = 0; c < NumConstraints; c++)
+	{
+		const UPhysicsConstraintTemplate* Template = PhysicsAsset->ConstraintSetup[c];
+		const int32* Child = Template ? BodyIndexes.Find(Template->DefaultInstance.ConstraintBone1) : nullptr;
+		const int32* Parent = Template ? BodyIndexes.Find(Template->DefaultInstance.ConstraintBone2) : nullptr;
+		if(!Child || !Parent || *Child == *Parent)
+			continue;
+		ConstraintBodies[c] = TPair<int32, int32>(*Child, *Parent);
+		Graph.Neighbors[*Child].AddUnique(*Parent);
+		Graph.Neighbors[*Parent].AddUnique(*Child);
+	}
+
+	// Tissue groups are the components of the constraint graph over tissue bodies only
+	int32 NumRegions = 1;
+	if(Options.bGroupByTissueRegion)
+	{
+		for(int32 i = 0; i < NumBodies; i++)
+		{
+			const FName BodyName = PhysicsAsset->SkeletalBodySetups[i]->BoneName;
+			Graph.Regions[i] = MassHierarchy::GetTissueLevel(PhatOptions, BodyName) == ETissueLevel::Skeleton ? 0 : INDEX_NONE;
+		}
+		TArray<int32> Stack;
+		for(int32 i = 0; i < NumBodies; i++)
+		{
+			if(Graph.Regions[i] != INDEX_NONE)
+				continue;
+			Graph.Regions[i] = NumRegions;
+			Stack.Add(i);
+			while(Stack.Num() > 0)
+			{
+				for(const int32 Neighbor : Graph.Neighbors[Stack.Pop()])
+				{
+					if(Graph.Regions[Neighbor] == INDEX_NONE)
+					{
+						Graph.Regions[Neighbor] = NumRegions;
+						Stack.Add(Neighbor);
+					}
+				}
+			}
+			NumRegions++;
+		}
+	}
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		for(const int32 Neighbor : Graph.Neighbors[i])
+			Graph.Degrees[i] += Graph.Regions[Neighbor] == Graph.Regions[i] ? 1 : 0;
+	}
+	for(TArray<int32>& Neighbors : Graph.Neighbors)
+	{
+		Neighbors.Sort([&Graph](int32 A, int32 B)
+		{
+			return Graph.Degrees[A] != Graph.Degrees[B] ? Graph.Degrees[A] < Graph.Degrees[B] : A < B;
+		});
+	}
+
+	TBitArray<> Visited(false, NumBodies);
+	TArray<int32> SkeletonOrder;
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		if(Graph.Regions[i] == 0 && !Visited[i])
+			Graph.Traverse(Graph.FindPeripheralNode(i), Visited, SkeletonOrder);
+	}
+	// Only the skeleton is reversed, so each group still follows its anchor starting from the body constrained to it
+	if(Options.bReverse)
+		Algo::Reverse(SkeletonOrder);
+	TArray<int32> SkeletonPositions;
+	SkeletonPositions.Init(INDEX_NONE, NumBodies);
+	for(int32 k = 0; k < SkeletonOrder.Num(); k++)
+		SkeletonPositions[SkeletonOrder[k]] = k;
+
+	// A group hangs from the earliest skeleton body it's constrained to and is traversed from its body on that constraint
+	TArray<int32> Anchors, Starts;
+	Anchors.Init(INDEX_NONE, NumRegions);
+	Starts.Init(INDEX_NONE, NumRegions);
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		const int32 Region = Graph.Regions[i];
+		if(Region == 0)
+			continue;
+		if(Starts[Region] == INDEX_NONE)
+			Starts[Region] = i;
+		for(const int32 Neighbor : Graph.Neighbors[i])
+		{
+			if(Graph.Regions[Neighbor] == 0 && (Anchors[Region] == INDEX_NONE || SkeletonPositions[Neighbor] < SkeletonPositions[Anchors[Region]]))
+			{
+				Anchors[Region] = Neighbor;
+				Starts[Region] = i;
+			}
+		}
+	}
+	TArray<TArray<int32>> GroupsByAnchor;
+	TArray<int32> LooseGroups;
+	GroupsByAnchor.SetNum(NumBodies);
+	for(int32 Region = 1; Region < NumRegions; Region++)
+	{
+		if(Anchors[Region] != INDEX_NONE)
+			GroupsByAnchor[Anchors[Region]].Add(Region);
+		else
+		{
+			Starts[Region] = Graph.FindPeripheralNode(Starts[Region]);
+			LooseGroups.Add(Region);
+		}
+	}
+
+	TArray<int32> Order;
+	Order.Reserve(NumBodies);
+	for(const int32 Body : SkeletonOrder)
+	{
+		Order.Add(Body);
+		for(const int32 Region : GroupsByAnchor[Body])
+			Graph.Traverse(Starts[Region], Visited, Order);
+	}
+	for(const int32 Region : LooseGroups)
+		Graph.Traverse(Starts[Region], Visited, Order);
+	check(Order.Num() == NumBodies);
+
+	TArray<int32> Identity, NewIndexes;
+	Identity.SetNumUninitialized(NumBodies);
+	NewIndexes.SetNumUninitialized(NumBodies);
+	for(int32 k = 0; k < NumBodies; k++)
+	{
+		Identity[k] = k;
+		NewIndexes[Order[k]] = k;
+	}
+
+	// Constraints by their lower body, then their higher one, so the joints walk the bodies in order too
+	TArray<int32> ConstraintOrder;
+	ConstraintOrder.SetNumUninitialized(NumConstraints);
+	for(int32 c = 0; c < NumConstraints; c++)
+		ConstraintOrder[c] = c;
+	auto GetSortKey = [&ConstraintBodies, &NewIndexes](int32 c)
+	{
+		const TPair<int32, int32>& Bodies = ConstraintBodies[c];
+		if(Bodies.Key == INDEX_NONE)
+			return TTuple<int32, int32, int32>(MAX_int32, MAX_int32, c);
+		const int32 A = NewIndexes[Bodies.Key], B = NewIndexes[Bodies.Value];
+		return TTuple<int32, int32, int32>(FMath::Min(A, B), FMath::Max(A, B), c);
+	};
+	ConstraintOrder.Sort([&GetSortKey](int32 A, int32 B) { return GetSortKey(A) < GetSortKey(B); });
+
+	OutReport.NumRegions = NumRegions;
+	for(int32 i = 0; i < NumBodies; i++)
+		OutReport.NumBodiesMoved += NewIndexes[i] != i ? 1 : 0;
+	for(int32 c = 0; c < NumConstraints; c++)
+		OutReport.NumConstraintsMoved += ConstraintOrder[c] != c ? 1 : 0;
+	MeasureSpans(ConstraintBodies, Identity, OutReport.BandwidthBefore, OutReport.MeanSpanBefore);
+	MeasureSpans(ConstraintBodies, NewIndexes, OutReport.BandwidthAfter, OutReport.MeanSpanAfter);
+	LG("Reordered %s: %d regions, bandwidth %d -> %d, mean span %.1f -> %.1f, %d bodies and %d constraints moved", *PhysicsAsset->GetName(),
+	   NumRegions, OutReport.BandwidthBefore, OutReport.BandwidthAfter, OutReport.MeanSpanBefore, OutReport.MeanSpanAfter,
+	   OutReport.NumBodiesMoved, OutReport.NumConstraintsMoved)
+	if(OutReport.NumBodiesMoved == 0 && OutReport.NumConstraintsMoved == 0)
+		return true;
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("SolverOrdering", "Reorder", "Reorder Bodies and Constraints"));
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+	TArray<TObjectPtr<USkeletalBodySetup>> Bodies;
+	Bodies.SetNum(NumBodies);
+	for(int32 i = 0; i < NumBodies; i++)
+		Bodies[NewIndexes[i]] = PhysicsAsset->SkeletalBodySetups[i];
+	TArray<TObjectPtr<UPhysicsConstraintTemplate>> Constraints;
+	Constraints.Reserve(NumConstraints);
+	for(const int32 c : ConstraintOrder)
+		Constraints.Add(PhysicsAsset->ConstraintSetup[c]);
+	TMap<FRigidBodyIndexPair, bool> CollisionDisableTable;
+	CollisionDisableTable.Reserve(PhysicsAsset->CollisionDisableTable.Num());
+	for(const TPair<FRigidBodyIndexPair, bool>& Entry : PhysicsAsset->CollisionDisableTable)
+	{
+		const int32 A = Entry.Key.Indices[0], B = Entry.Key.Indices[1];
+		if(NewIndexes.IsValidIndex(A) && NewIndexes.IsValidIndex(B))
+			CollisionDisableTable.Add(FRigidBodyIndexPair(NewIndexes[A], NewIndexes[B]), Entry.Value);
+	}
+
+	PhysicsAsset->SkeletalBodySetups = MoveTemp(Bodies);
+	PhysicsAsset->ConstraintSetup = MoveTemp(Constraints);
+	PhysicsAsset->CollisionDisableTable = MoveTemp(CollisionDisableTable);
+	PhysicsAsset->UpdateBodySetupIndexMap();
+	PhysicsAsset->UpdateBoundsBodiesArray();
+	PhysicsAsset->RefreshPhysicsAssetChange();
+	PhysicsAsset->MarkPackageDirty();
+	return true;
+}
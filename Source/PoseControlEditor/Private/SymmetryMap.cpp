@@ -0,0 +1,317 @@
+﻿#include "SymmetryMap.h"
+
+#include "CustomLogging.h"
+#include "JointNames.h"
+#include "PhysicsAssetTransaction.h"
+#include "PhysicsEditorBPLibrary.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#undef LOG_CAT
+#define LOG_CAT LogPhysicsEditor
+
+static uint64 OrderedPairKey(int32 A, int32 B)
+{
+	return (uint64(uint32(A)) << 32) | uint64(uint32(B));
+}
+
+static bool GetBonePose(const FReferenceSkeleton& RefSkeleton, const TArray<FTransform>& Pose, FName BoneName, FTransform& OutTransform)
+{
+	const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+	if(!Pose.IsValidIndex(BoneIndex))
+	{
+		LGE("Bone %s not found in pose", *BoneName.ToString())
+		return false;
+	}
+	OutTransform = Pose[BoneIndex];
+	return true;
+}
+
+/** Shape transform in the source bone space -> mirrored shape transform in the mirror bone space */
+static FTransform MirrorLocalTransform(const FTransform& Local, const FTransform& SourceBone, const FTransform& MirrorBone, EAxis::Type MirrorAxis)
+{
+	FTransform Mirrored = FBilateralSymmetryMap::MirrorTransform(Local * SourceBone, MirrorAxis).GetRelativeTransform(MirrorBone);
+	Mirrored.SetScale3D(Local.GetScale3D());
+	return Mirrored;
+}
+
+template<typename ElemType>
+static void MirrorElems(TArray<ElemType>& Elems, const FTransform& SourceBone, const FTransform& MirrorBone, EAxis::Type MirrorAxis)
+{
+	for(ElemType& Elem : Elems)
+		Elem.SetTransform(MirrorLocalTransform(Elem.GetTransform(), SourceBone, MirrorBone, MirrorAxis));
+}
+
+bool FBilateralSymmetryMap::Build(const UPhysicsAsset* PhysicsAsset)
+{
+	if(!PhysicsAsset)
+		return false;
+
+	const int32 NumBodies = PhysicsAsset->SkeletalBodySetups.Num();
+	BodyMirror.Init(INDEX_NONE, NumBodies);
+	BodySide.Init(ESymmetrySide::Centre, NumBodies);
+	int32 NumBodyPairs = 0;
+	for(int32 i = 0; i < NumBodies; i++)
+	{
+		const USkeletalBodySetup* Body = PhysicsAsset->SkeletalBodySetups[i];
+		if(!Body)
+			continue;
+		BodySide[i] = GetSide(Body->BoneName);
+		if(BodySide[i] == ESymmetrySide::Centre)
+		{
+			BodyMirror[i] = i;
+		}
+		else if(const int32* MirrorIndex = PhysicsAsset->BodySetupIndexMap.Find(MirrorName(Body->BoneName)))
+		{
+			BodyMirror[i] = *MirrorIndex;
+			NumBodyPairs++;
+		}
+	}
+
+	const int32 NumConstraints = PhysicsAsset->ConstraintSetup.Num();
+	ConstraintMirror.Init(INDEX_NONE, NumConstraints);
+	ConstraintSide.Init(ESymmetrySide::Centre, NumConstraints);
+	ConstraintBodies.Init(TPair<int32, int32>(INDEX_NONE, INDEX_NONE), NumConstraints);
+	ConstraintIndexMap.Reset();
+	ConstraintIndexMap.Reserve(NumConstraints);
+	TMap<uint64, int32> PairToConstraint;
+	PairToConstraint.Reserve(NumConstraints);
+	for(int32 i = 0; i < NumConstraints; i++)
+	{
+		const UPhysicsConstraintTemplate* Setup = PhysicsAsset->ConstraintSetup[i];
+		if(!Setup)
+			continue;
+		const FConstraintInstance& Constraint = Setup->DefaultInstance;
+		ConstraintIndexMap.Add(Constraint.JointName, i);
+		const int32* Body1 = PhysicsAsset->BodySetupIndexMap.Find(Constraint.ConstraintBone1);
+		const int32* Body2 = PhysicsAsset->BodySetupIndexMap.Find(Constraint.ConstraintBone2);
+		if(!Body1 || !Body2)
+			continue;
+		ConstraintBodies[i] = TPair<int32, int32>(*Body1, *Body2);
+		ConstraintSide[i] = BodySide[*Body1] != ESymmetrySide::Centre ? BodySide[*Body1] : BodySide[*Body2];
+		PairToConstraint.Add(OrderedPairKey(*Body1, *Body2), i);
+	}
+
+	int32 NumConstraintPairs = 0;
+	for(int32 i = 0; i < NumConstraints; i++)
+	{
+		const TPair<int32, int32>& Bodies = ConstraintBodies[i];
+		if(Bodies.Key == INDEX_NONE || BodyMirror[Bodies.Key] == INDEX_NONE || BodyMirror[Bodies.Value] == INDEX_NONE)
+			continue;
+		if(const int32* MirrorIndex = PairToConstraint.Find(OrderedPairKey(BodyMirror[Bodies.Key], BodyMirror[Bodies.Value])))
+		{
+			ConstraintMirror[i] = *MirrorIndex;
+			NumConstraintPairs += *MirrorIndex != i;
+		}
+	}
+	LGV("Symmetry map of %s: %d body pairs, %d constraint pairs", *PhysicsAsset->GetName(), NumBodyPairs, NumConstraintPairs / 2)
+	return true;
+}
+
+int32 FBilateralSymmetryMap::MirrorBodies(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton,
+                                          const TArray<FTransform>& Pose, const TArray<int32>& Bodies, EAxis::Type MirrorAxis) const
+{
+	int32 NumMirrored = 0;
+	for(int32 BodyIndex : Bodies)
+	{
+		if(!BodyMirror.IsValidIndex(BodyIndex) || BodyMirror[BodyIndex] == INDEX_NONE || BodyMirror[BodyIndex] == BodyIndex)
+			continue;
+		const USkeletalBodySetup* Source = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		USkeletalBodySetup* Mirror = PhysicsAsset->SkeletalBodySetups[BodyMirror[BodyIndex]];
+		FTransform SourceBone, MirrorBone;
+		if(!Mirror || !GetBonePose(RefSkeleton, Pose, Source->BoneName, SourceBone) || !GetBonePose(RefSkeleton, Pose, Mirror->BoneName, MirrorBone))
+			continue;
+
+		FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, BodyMirror[BodyIndex]);
+		FKAggregateGeom Geom = Source->AggGeom;
+		MirrorElems(Geom.SphereElems, SourceBone, MirrorBone, MirrorAxis);
+		MirrorElems(Geom.SphylElems, SourceBone, MirrorBone, MirrorAxis);
+		MirrorElems(Geom.BoxElems, SourceBone, MirrorBone, MirrorAxis);
+		MirrorElems(Geom.TaperedCapsuleElems, SourceBone, MirrorBone, MirrorAxis);
+		if(!Geom.ConvexElems.IsEmpty())
+		{
+			// Reflected hulls need recooking, keep the mirror side's own convex shapes
+			LGW("Convex shapes of %s are not mirrored", *Source->BoneName.ToString())
+			Geom.ConvexElems = Mirror->AggGeom.ConvexElems;
+		}
+
+		Mirror->AggGeom = MoveTemp(Geom);
+		Mirror->PhysicsType = Source->PhysicsType;
+		Mirror->DefaultInstance.CopyBodyInstancePropertiesFrom(&Source->DefaultInstance);
+		Mirror->InvalidatePhysicsData();
+		Mirror->CreatePhysicsMeshes();
+		NumMirrored++;
+	}
+	return NumMirrored;
+}
+
+TArray<int32> FBilateralSymmetryMap::MirrorConstraints(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton,
+                                                       const TArray<FTransform>& Pose, const TArray<int32>& Constraints,
+                                                       EAxis::Type MirrorAxis)
+{
+	TArray<int32> MirrorIndexes;
+	MirrorIndexes.Reserve(Constraints.Num());
+	for(int32 ConstraintIndex : Constraints)
+	{
+		if(!ConstraintMirror.IsValidIndex(ConstraintIndex) || ConstraintMirror[ConstraintIndex] == ConstraintIndex)
+			continue;
+		const TPair<int32, int32> Bodies = ConstraintBodies[ConstraintIndex];
+		if(Bodies.Key == INDEX_NONE)
+			continue;
+
+		int32 MirrorIndex = ConstraintMirror[ConstraintIndex];
+		if(MirrorIndex == INDEX_NONE)
+		{
+			const int32 MirrorBody1 = BodyMirror[Bodies.Key];
+			const int32 MirrorBody2 = BodyMirror[Bodies.Value];
+			if(MirrorBody1 == INDEX_NONE || MirrorBody2 == INDEX_NONE)
+			{
+				LGW("No mirror bodies for constraint %s", *PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance.JointName.ToString())
+				continue;
+			}
+			FConstraintParams Params;
+			Params.ConstraintOverwrite = EConstraintOverwrite::None;
+			Params.ConstraintBone1 = PhysicsAsset->SkeletalBodySetups[MirrorBody1]->BoneName;
+			Params.ConstraintBone2 = PhysicsAsset->SkeletalBodySetups[MirrorBody2]->BoneName;
+			// Pair names are numbered after the parent, so the mirror is the pair name of the mirrored bodies
+			const FConstraintInstance& Source = PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance;
+			Params.JointName = Source.JointName == JointNames::MakePairName(Source.ConstraintBone1, Source.ConstraintBone2)
+				? JointNames::MakePairName(Params.ConstraintBone1, Params.ConstraintBone2) : MirrorName(Source.JointName);
+			// A taken name would make MakeNewConstraint return (and rebind) that constraint, which isn't on the mirror bodies
+			const int32 TakenIndex = PhysicsAsset->FindConstraintIndex(Params.JointName);
+			if(TakenIndex != INDEX_NONE)
+			{
+				LGW("Mirror of constraint %s not created, %s is taken by constraint %d on other bodies",
+				    *PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance.JointName.ToString(), *Params.JointName.ToString(), TakenIndex)
+				continue;
+			}
+			MirrorIndex = UPhysicsEditorBPLibrary::MakeNewConstraint(PhysicsAsset, Params);
+			if(MirrorIndex == INDEX_NONE)
+				continue;
+
+			// New constraints are appended, so the map stays valid by appending their entries
+			if(MirrorIndex != ConstraintMirror.Num())
+			{
+				LGW("Mirror constraint %s wasn't appended, skipping it", *Params.JointName.ToString())
+				continue;
+			}
+			ConstraintMirror.Add(ConstraintIndex);
+			ConstraintSide.Add(BodySide[MirrorBody1] != ESymmetrySide::Centre ? BodySide[MirrorBody1] : BodySide[MirrorBody2]);
+			ConstraintBodies.Add(TPair<int32, int32>(MirrorBody1, MirrorBody2));
+			ConstraintIndexMap.Add(Params.JointName, MirrorIndex);
+			ConstraintMirror[ConstraintIndex] = MirrorIndex;
+		}
+
+		FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, MirrorIndex);
+		const FConstraintInstance& Source = PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance;
+		FConstraintInstance& Mirror = PhysicsAsset->ConstraintSetup[MirrorIndex]->DefaultInstance;
+		Mirror.ProfileInstance = Source.ProfileInstance;
+
+		FTransform SourceBone1, SourceBone2, MirrorBone1, MirrorBone2;
+		if(GetBonePose(RefSkeleton, Pose, Source.ConstraintBone1, SourceBone1) && GetBonePose(RefSkeleton, Pose, Source.ConstraintBone2, SourceBone2)
+			&& GetBonePose(RefSkeleton, Pose, Mirror.ConstraintBone1, MirrorBone1) && GetBonePose(RefSkeleton, Pose, Mirror.ConstraintBone2, MirrorBone2))
+		{
+			Mirror.SetRefFrame(EConstraintFrame::Frame1, MirrorLocalTransform(Source.GetRefFrame(EConstraintFrame::Frame1), SourceBone1, MirrorBone1, MirrorAxis));
+			Mirror.SetRefFrame(EConstraintFrame::Frame2, MirrorLocalTransform(Source.GetRefFrame(EConstraintFrame::Frame2), SourceBone2, MirrorBone2, MirrorAxis));
+		}
+		MirrorIndexes.Add(MirrorIndex);
+	}
+	return MirrorIndexes;
+}
+
+bool FBilateralSymmetryMap::CopyConstraintProfile(UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex) const
+{
+	if(!ConstraintMirror.IsValidIndex(ConstraintIndex))
+		return false;
+	const int32 MirrorIndex = ConstraintMirror[ConstraintIndex];
+	if(MirrorIndex == INDEX_NONE || MirrorIndex == ConstraintIndex)
+		return false;
+	FScopedPhysicsAssetTransaction::ModifyConstraint(PhysicsAsset, MirrorIndex);
+	PhysicsAsset->ConstraintSetup[MirrorIndex]->DefaultInstance.ProfileInstance = PhysicsAsset->ConstraintSetup[ConstraintIndex]->DefaultInstance.ProfileInstance;
+	return true;
+}
+
+/** A single character after an underscore, ended by the string or a non alphanumeric character such as '_', '$' or ')' */
+static bool IsSideToken(const TCHAR* Name, int32 Len, int32 Index)
+{
+	return Index > 0 && Name[Index - 1] == TEXT('_') && (Index + 1 == Len || !FChar::IsAlnum(Name[Index + 1]));
+}
+
+static bool SwapSideTokens(TCHAR* Name, int32 Len)
+{
+	bool bChanged = false;
+	for(int32 i = 1; i < Len; i++)
+	{
+		if(!IsSideToken(Name, Len, i))
+			continue;
+		switch(Name[i])
+		{
+		case TEXT('l'): Name[i] = TEXT('r'); bChanged = true; break;
+		case TEXT('r'): Name[i] = TEXT('l'); bChanged = true; break;
+		case TEXT('L'): Name[i] = TEXT('R'); bChanged = true; break;
+		case TEXT('R'): Name[i] = TEXT('L'); bChanged = true; break;
+		default: break;
+		}
+	}
+	return bChanged;
+}
+
+FName FBilateralSymmetryMap::MirrorName(FName InName)
+{
+	// Stack buffer; the number suffix is part of the string, so numbered joint names keep their number
+	FNameBuilder Builder(InName);
+	return SwapSideTokens(Builder.GetData(), Builder.Len()) ? FName(Builder.ToView()) : InName;
+}
+
+FString FBilateralSymmetryMap::MirrorString(const FString& InString)
+{
+	FString Mirrored = InString;
+	SwapSideTokens(Mirrored.GetCharArray().GetData(), Mirrored.Len());
+	return Mirrored;
+}
+
+ESymmetrySide FBilateralSymmetryMap::GetSide(FName InName)
+{
+	const FNameBuilder Builder(InName);
+	const FStringView Name = Builder.ToView();
+	for(int32 i = 1; i < Name.Len(); i++)
+	{
+		if(!IsSideToken(Name.GetData(), Name.Len(), i))
+			continue;
+		const TCHAR Token = FChar::ToLower(Name[i]);
+		if(Token == TEXT('l'))
+			return ESymmetrySide::Left;
+		if(Token == TEXT('r'))
+			return ESymmetrySide::Right;
+	}
+	return ESymmetrySide::Centre;
+}
+
+FTransform FBilateralSymmetryMap::MirrorTransform(const FTransform& InTransform, EAxis::Type MirrorAxis)
+{
+	// Reflection S across the plane, rotation becomes S * R * S: the mirrored axis' quaternion component is kept
+	FVector Location = InTransform.GetLocation();
+	FQuat Rotation = InTransform.GetRotation();
+	switch(MirrorAxis)
+	{
+	case EAxis::X:
+		Location.X = -Location.X;
+		Rotation.Y = -Rotation.Y;
+		Rotation.Z = -Rotation.Z;
+		break;
+	case EAxis::Y:
+		Location.Y = -Location.Y;
+		Rotation.X = -Rotation.X;
+		Rotation.Z = -Rotation.Z;
+		break;
+	case EAxis::Z:
+		Location.Z = -Location.Z;
+		Rotation.X = -Rotation.X;
+		Rotation.Y = -Rotation.Y;
+		break;
+	default:
+		break;
+	}
+	return FTransform(Rotation, Location, InTransform.GetScale3D());
+}
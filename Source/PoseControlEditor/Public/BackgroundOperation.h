@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Tasks/Task.h"
+
+class SNotificationItem;
+
+DECLARE_DELEGATE_OneParam(FOnPcOperationFinished, bool /* bSuccess */);
+
+/**
+ * Runs the computational part of a tool operation as a UE::Tasks task so the editor stays responsive.
+ * Progress and a Cancel button go through a non-modal notification. Once the work is done, the commit step runs on the
+ * game thread and applies the results (transactions, asset changes); cancelling skips it.
+ * The assets passed to Launch are kept loaded and marked busy until the operation finishes, so the same asset
+ * can't be regenerated twice at once. The work may only read them.
+ */
+class FPcBackgroundOperation : public TSharedFromThis<FPcBackgroundOperation>
+{
+public:
+	/** Runs on a worker thread. Returns false on failure. */
+	using FWorkFunction = TFunction<bool(FPcBackgroundOperation& Operation)>;
+	/** Runs on the game thread after the work succeeded. Returns false on failure. */
+	using FCommitFunction = TFunction<bool()>;
+
+	/** Returns null if one of the assets is already busy */
+	static TSharedPtr<FPcBackgroundOperation> Launch(const FText& Title, const TArray<UObject*>& Assets, FWorkFunction Work,
+	                                                 FCommitFunction Commit, FOnPcOperationFinished OnFinished = FOnPcOperationFinished());
+
+	static bool IsBusy(const UObject* Asset);
+
+	/** Thread safe. Fraction in [0, 1]. */
+	void SetProgress(float Fraction, const FString& Status = FString());
+	bool IsCancelled() const { return bCancelled; }
+	void Cancel() { bCancelled = true; }
+
+private:
+	FPcBackgroundOperation(const FText& InTitle, FWorkFunction&& InWork, FCommitFunction&& InCommit, FOnPcOperationFinished&& InOnFinished);
+
+	bool Tick(float DeltaTime);
+	void Finish();
+
+	FText Title;
+	FWorkFunction Work;
+	FCommitFunction Commit;
+	FOnPcOperationFinished OnFinished;
+	TArray<TObjectKey<UObject>> Assets;
+	/** Assets this operation rooted, unrooted when it finishes */
+	TArray<TWeakObjectPtr<UObject>> RootedAssets;
+
+	UE::Tasks::TTask<bool> Task;
+	TSharedPtr<SNotificationItem> Notification;
+	FTSTicker::FDelegateHandle TickerHandle;
+	double StartTime = 0.0;
+
+	std::atomic<bool> bCancelled = false;
+	FCriticalSection ProgressLock;
+	float Progress = 0.f;
+	FString ProgressStatus;
+};
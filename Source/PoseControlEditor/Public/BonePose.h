@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class FSkinSurface;
+struct FMorphVariant;
+class USkeletalMesh;
+class USkeletalMeshComponent;
+struct FReferenceSkeleton;
+
+/**
+ * Flat snapshot of every bone's component space transform, indexed like the reference skeleton.
+ * Taken once from a live component or computed from a mesh's reference pose, so the generation passes can
+ * run without a component and look bones up by index instead of resolving each name through the component.
+ */
+struct FBonePose
+{
+	const FReferenceSkeleton* RefSkeleton = nullptr;
+	TArray<FTransform> ComponentSpace;
+	FTransform ComponentToWorld;
+	/** Skin in the same pose and space, only taken when asked for since it's built from every triangle */
+	TSharedPtr<const FSkinSurface> SkinSurface;
+
+	/** Current pose of the component, in its world placement */
+	static FBonePose FromComponent(const USkeletalMeshComponent* SkeletalMeshComponent, bool bWithSkin = false);
+	/** Reference pose of the mesh at the origin. Works headless. */
+	static FBonePose FromRefPose(const USkeletalMesh* SkeletalMesh, bool bWithSkin = false);
+	/** Reference pose of the source mesh with the variant's morphs applied, see MorphVariantCache */
+	static FBonePose FromMorphVariant(const USkeletalMesh* SourceMesh, const FMorphVariant& Variant, bool bWithSkin = false);
+
+	bool IsValid() const { return RefSkeleton != nullptr && ComponentSpace.Num() > 0; }
+	int32 GetBoneIndex(FName BoneName) const;
+	FName GetParentBone(FName BoneName) const;
+
+	/** World space, like USkeletalMeshComponent::GetBoneTransform. Identity if the bone is missing. */
+	FTransform GetBoneTransform(int32 BoneIndex) const;
+	FTransform GetBoneTransform(FName BoneName) const { return GetBoneTransform(GetBoneIndex(BoneName)); }
+	FVector GetBoneLocation(FName BoneName) const { return GetBoneTransform(BoneName).GetLocation(); }
+};
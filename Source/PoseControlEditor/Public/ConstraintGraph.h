@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FConstraintParams.h"
+
+struct FConstraintInstance;
+
+/** Undirected edge between two entries of a node array, e.g. the point bodies of one group. */
+struct FConstraintEdge
+{
+	FConstraintEdge(){}
+	FConstraintEdge(int32 InA, int32 InB, float InLength, int32 InRows = 0)
+		: A(InA), B(InB), Length(InLength), Rows(InRows) { }
+
+	/** In generated constraints, A is ConstraintBone1 (the child) */
+	int32 A = INDEX_NONE;
+	int32 B = INDEX_NONE;
+	float Length = 0.f;
+	/** Estimated solver rows of the constraint on this edge */
+	int32 Rows = 0;
+	/** Caller data, e.g. the constraint index the edge was read from */
+	int32 Payload = INDEX_NONE;
+};
+
+namespace ConstraintGraph
+{
+	/** Constrained axes + driven axes of a constraint built from these params */
+	int32 EstimateSolverRows(const FConstraintParams& Params);
+
+	/** Constrained axes + driven axes of an existing constraint */
+	int32 EstimateSolverRows(const FConstraintInstance& Constraint);
+
+	/**
+	 * Deduplicates symmetric pairs, prunes near-collinear edges and enforces the budget in Options.
+	 * Removed edges are dropped from Edges; counts are accumulated into OutReport.
+	 */
+	void FilterEdges(TArray<FConstraintEdge>& Edges, const FConstraintGraphOptions& Options, FConstraintGraphReport& OutReport);
+
+	/** Adds the counts of From into Into and recomputes the cost reduction */
+	void AppendReport(FConstraintGraphReport& Into, const FConstraintGraphReport& From);
+
+	/**
+	 * Projects Points onto their best-fit plane and returns one edge per Delaunay triangulation edge (O(n log n)).
+	 * Triangles that stand nearly edge-on to the plane are dropped, they bridge a fold of a curved patch.
+	 * Boundary edges longer than MaxEdgeRatio * median edge length are dropped unless that would isolate a point.
+	 */
+	bool TriangulateSurfaceEdges(const TArray<FVector>& Points, float MaxEdgeRatio, int32 Rows, TArray<FConstraintEdge>& OutEdges);
+}
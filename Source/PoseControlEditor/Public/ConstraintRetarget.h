@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FConstraintParams.h"
+
+class UPhysicsAsset;
+
+/**
+ * Copies constraints from a master asset to its variants. The source is read once with one mass per child body,
+ * each target is then matched on its own task: bone remap, body lookups, target child masses and the resolved
+ * drive strengths. Only the writes run on the game thread, all targets in one transaction and one save.
+ */
+namespace ConstraintRetarget
+{
+	bool Retarget(UPhysicsAsset* SourcePhysicsAsset, const TArray<UPhysicsAsset*>& TargetPhysicsAssets,
+	              const FConstraintRetargetOptions& Options, FConstraintRetargetReport& OutReport);
+}
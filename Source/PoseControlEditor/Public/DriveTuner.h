@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FConstraintParams.h"
+#include "Structs/FPhysicsSoakBenchmark.h"
+
+class UPhysicsAsset;
+class USkeletalMesh;
+
+/**
+ * Per-group drive tuning through short soak runs. For each tissue group of the options, solver iteration candidates are
+ * tried lowest first; at each count a coordinate search scales linear strength, angular strength and damping of the
+ * group's constraints until jitter and joint separation are under the targets. Other groups keep their current values.
+ * FPhatConstraintOptions::PositionVelocityRatio isn't searched: constraint generation doesn't read it, each drive's damping
+ * comes from its FConstraintParams damping ratio, which the damping scale already covers.
+ */
+namespace DriveTuner
+{
+	/**
+	 * Tunes the groups enabled in InOutOptions against PhysicsAsset, which must already have the generated constraints.
+	 * The winning scales are folded into each group's FConstraintParams and SolverIterations, and left applied on the asset.
+	 */
+	bool Tune(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions& InOutOptions,
+	          const FDriveTuningOptions& Options, FDriveTuningReport& OutReport);
+
+	/** Sets the position solver iteration count of the bodies' default instances */
+	void SetSolverIterations(UPhysicsAsset* PhysicsAsset, const TArray<FName>& BodyNames, int32 Iterations);
+}
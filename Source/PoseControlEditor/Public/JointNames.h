@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Names of generated constraints. An edge constraint reuses its child bone's FName with a number derived from the
+ * parent bone's name, displayed as child_<number>. The number is the same on every run, so regenerating finds the edge
+ * by name, and building it adds no name table entry per edge. The other side's name of a pair edge is the pair name of
+ * the mirrored bodies, not the mirrored string.
+ */
+namespace JointNames
+{
+	/** Child bones that already carry a number (e.g. spine_01) are numbered on a spine_01_e base, one entry per bone */
+	FName MakePairName(FName ChildBone, FName ParentBone);
+
+	/**
+	 * Names older versions gave the pair's edge: pt_pt_child__parent, pt_bone_child__parent and child__parent.
+	 * Only looked up, so names that were never created aren't added to the name table.
+	 */
+	void FindLegacyPairNames(FName ChildBone, FName ParentBone, TArray<FName, TInlineAllocator<3>>& OutNames);
+
+	/** Prefix with zero padded numbers and a side suffix, e.g. ("breast_pt", {1, 2}, 0) -> breast_pt_01_02_l */
+	FName MakeSidedName(const TCHAR* Prefix, std::initializer_list<int32> Numbers, int32 Side);
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FConstraintParams.h"
+
+class UPhysicsAsset;
+struct FReferenceSkeleton;
+
+/**
+ * Parent bodies should be heavier than their children. One top-down walk over the reference skeleton with cached
+ * masses finds each body's parent body, detects inversions and lightens children to their target ratio, so the fix of
+ * a parent is already in the cache when its children are checked.
+ */
+enum class ETissueLevel : uint8
+{
+	Skeleton,
+	Core,
+	Spoke,
+	Point
+};
+
+namespace MassHierarchy
+{
+	/** Level of a body by the point patterns of PhatOptions and their mirrors; bodies matching none are Skeleton */
+	ETissueLevel GetTissueLevel(const FPhatConstraintOptions& PhatOptions, FName BodyName);
+
+
+	/** Core/Spoke/Point levels come from the point patterns of PhatOptions (and their mirrors). */
+	bool Rebalance(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton, const FPhatConstraintOptions& PhatOptions,
+	               const FMassRebalanceOptions& Options, FMassRebalanceReport& OutReport);
+}
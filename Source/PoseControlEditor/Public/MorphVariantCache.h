@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "MeshUtilities.h"
+
+class UPcActorDataAsset;
+class USkeletalMesh;
+
+/** Reference pose and skin of the source mesh with one data asset's curves and morph targets applied */
+struct FMorphVariant
+{
+	FString Key;
+	/** Bone space, indexed like the source mesh's reference skeleton */
+	TArray<FTransform> RefPose;
+	TArray<FTransform> ComponentSpace;
+	/** Morphed and skinned, one per soft vertex of the imported model's LOD0 sections in order */
+	TArray<FVector3f> SkinVertices;
+	/** Like IMeshUtilities::CalcBoneVertInfos with bOnlyDominant, relative to the morphed bones */
+	TArray<FBoneVertInfo> Infos;
+};
+
+/**
+ * Morph and curve variants evaluated without baking a skeletal mesh asset. The bone pose comes from one synchronous
+ * update of the data asset's AnimBlueprint on a transient component, the morph deltas are applied to the imported
+ * model directly and skinned to that pose. Variants are kept for the editor session, keyed by a hash of the source
+ * mesh, the AnimBlueprint, CurveMap and MorphTargetMap, so data assets sharing a variant evaluate it once. The least
+ * recently used variants are evicted first.
+ */
+namespace MorphVariantCache
+{
+	FString MakeKey(const UPcActorDataAsset* DataAsset);
+
+	/** The cached variant of the data asset's maps, evaluated on a miss. Null if the source mesh is missing. */
+	TSharedPtr<const FMorphVariant> FindOrEvaluate(UPcActorDataAsset* DataAsset);
+
+	/** FindOrEvaluate, then writes the variant's pose to RefPoseTransforms and its key to MorphVariantKey */
+	bool Apply(UPcActorDataAsset* DataAsset);
+
+	/** The data asset is in RefPoseCache mode and RefPoseTransforms match its current maps */
+	bool IsApplied(const UPcActorDataAsset* DataAsset);
+
+	int32 GetNumLookups();
+	int32 GetNumHits();
+
+	void Reset();
+}
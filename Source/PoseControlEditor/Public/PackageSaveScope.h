@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UPackage;
+
+/**
+ * Coalesces package saves across library calls. While a scope is open, RequestSave only records the package,
+ * and the outermost scope writes every recorded package with a single SavePackages call when it closes.
+ * Without an open scope RequestSave saves right away.
+ */
+class FScopedPackageSave : public FNoncopyable
+{
+public:
+	FScopedPackageSave() { Enter(); }
+	~FScopedPackageSave() { Leave(); }
+
+	/** Non-RAII open/close, for scopes that span several frames. Every Enter needs a Leave on all paths. */
+	static void Enter();
+	static bool Leave();
+
+	/** bForce saves the package even if it isn't dirty */
+	static bool RequestSave(UObject* Asset, bool bForce = false);
+	static bool RequestSave(const TArray<UObject*>& Assets, bool bForce = false);
+
+	static bool IsOpen() { return Depth > 0; }
+
+private:
+	static bool Flush();
+
+	static int32 Depth;
+	static TArray<TWeakObjectPtr<UPackage>> PendingPackages;
+	static TSet<TWeakObjectPtr<UPackage>> ForcedPackages;
+};
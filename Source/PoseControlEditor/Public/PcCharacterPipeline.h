@@ -0,0 +1,167 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "PhysicsAssetTools.h"
+#include "PcCharacterPipeline.generated.h"
+
+class UPcActorDataAsset;
+class FSHA1;
+
+UENUM(BlueprintType)
+enum class EPcPipelineStage : uint8
+{
+	CopyPhysicsAsset,
+	BakeMorphedMesh,
+	CreateBodies,
+	CopyTwistShapes,
+	AlignCapsules,
+	FixConstraintScale,
+	AddConstraints
+};
+
+USTRUCT(BlueprintType)
+struct FPcPipelineStageResult
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly)
+	EPcPipelineStage Stage = EPcPipelineStage::CopyPhysicsAsset;
+
+	/** Inputs matched the recorded hash and the output exists */
+	UPROPERTY(BlueprintReadOnly)
+	bool bSkipped = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bSuccess = false;
+
+	UPROPERTY(BlueprintReadOnly)
+	float Seconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly)
+	FString InputHash;
+
+	/** Bodies and constraints of the target physics asset once the stage is done */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumBodies = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumConstraints = 0;
+};
+
+/** Totals of one stage over the editor session, across data assets */
+USTRUCT(BlueprintType)
+struct FPcPipelineStageStats
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY(BlueprintReadOnly)
+	EPcPipelineStage Stage = EPcPipelineStage::CopyPhysicsAsset;
+
+	/** Times the recorded hash was checked */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumLookups = 0;
+
+	/** Lookups that skipped the stage */
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumHits = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumRuns = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	float TotalSeconds = 0.f;
+
+	float GetHitRate() const { return NumLookups > 0 ? float(NumHits) / NumLookups : 0.f; }
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPcPipelineFinished, bool, bSuccess);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnPcAnyPipelineFinished, UPcActorDataAsset* /* DataAsset */, bool /* bSuccess */);
+
+/**
+ * Runs the character steps from the Readme in order, driven by a UPcActorDataAsset.
+ * Each stage hashes its inputs (assets, morph maps, data tables, option structs) together with the previous stage's hash
+ * and records it on the data asset. A stage whose hash matches its record is skipped, so a change only reruns
+ * the stages downstream of it. The bake stage waits on a timer, the pipeline resumes when it completes.
+ */
+UCLASS(MinimalAPI, BlueprintType)
+class UPcCharacterPipeline : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Starts the pipeline. Returns null if the data asset is missing; otherwise OnFinished fires when the last stage is done. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Run Character Pipeline", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static UPcCharacterPipeline* RunCharacterPipeline(UPcActorDataAsset* DataAsset, FMeshBakeOptions Options);
+
+	/**
+	 * Reruns one stage regardless of its recorded hash, chained on the record of the stage before it.
+	 * The records of the later stages are cleared, so the next full run rebuilds them.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Run Character Pipeline Stage", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static UPcCharacterPipeline* RunCharacterPipelineStage(UPcActorDataAsset* DataAsset, FMeshBakeOptions Options, EPcPipelineStage Stage);
+
+	/** Results of the last run for the data asset in this session. Single stage runs replace their stage's entry. */
+	static const TArray<FPcPipelineStageResult>* GetLastResults(const UPcActorDataAsset* DataAsset);
+
+	/** One entry per stage */
+	static const TArray<FPcPipelineStageStats>& GetSessionStats();
+
+	/** Fires on the game thread after any pipeline finishes */
+	static FOnPcAnyPipelineFinished& OnAnyPipelineFinished();
+
+	UFUNCTION(BlueprintCallable, Category = "PoseControlEditor")
+	bool IsRunning() const { return bRunning; }
+
+	/** Fails the running pipeline. A stage that completes later is ignored. */
+	UFUNCTION(BlueprintCallable, Category = "PoseControlEditor")
+	void Cancel();
+
+	UPROPERTY(BlueprintAssignable)
+	FOnPcPipelineFinished OnFinished;
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<FPcPipelineStageResult> Results;
+
+	UPROPERTY(BlueprintReadOnly)
+	TObjectPtr<UPcActorDataAsset> DataAsset;
+
+protected:
+	static UPcCharacterPipeline* Start(UPcActorDataAsset* DataAsset, const FMeshBakeOptions& Options, int32 FirstStage, int32 EndStage);
+
+	bool IsStageEnabled(EPcPipelineStage Stage) const;
+	void HashStageInputs(EPcPipelineStage Stage, FSHA1& Sha) const;
+	/** The target asset the stage writes, hashed the same way as the stage inputs */
+	FString HashStageOutput(EPcPipelineStage Stage) const;
+	/** The stage's target exists and still matches what the pipeline last produced */
+	bool HasStageOutput(EPcPipelineStage Stage, const FPcPipelineStageRecord& Record) const;
+	/** Returns false on failure. Sets bWaiting for stages that complete later through ResumeAfterStage. */
+	bool RunStage(EPcPipelineStage Stage);
+
+	void RunNextStages();
+	void ResumeAfterStage(bool bSuccess);
+	void FinishStage(bool bSuccess);
+	void Finish(bool bSuccess);
+
+	/** Cancels the pipeline if the preload or a waiting stage hasn't called back in time */
+	void ArmWaitTimeout();
+	void ClearWaitTimeout();
+
+	virtual void BeginDestroy() override;
+
+	FMeshBakeOptions Options;
+	int32 NextStage = 0;
+	int32 EndStage = 0;
+	bool bSingleStage = false;
+	FString PreviousHash;
+	FString CurrentHash;
+	double StageStartTime = 0.0;
+	bool bRunning = false;
+	bool bWaiting = false;
+	/** Once a stage reruns, every later stage reruns too */
+	bool bUpstreamRan = false;
+	FTSTicker::FDelegateHandle WaitTimeoutHandle;
+
+	UPROPERTY()
+	TObjectPtr<UPhysicsAssetTools> BakeHelper;
+};
@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FPhysicsAssetCostReport.h"
+
+class UPhysicsAsset;
+
+/**
+ * Static cost estimate of a physics asset, taken in one walk over its body setups and constraint templates.
+ * Byte counts are estimates: exact container sizes for the asset data, fixed per-object sizes for the solver state.
+ */
+namespace PhysicsAssetCost
+{
+	/**
+	 * Bodies are grouped by the first of GroupPatterns their name matches (the pattern is the group name),
+	 * otherwise by their name with digit runs replaced by '#', e.g. glute_#_#_#_pt_l.
+	 */
+	bool BuildReport(const UPhysicsAsset* PhysicsAsset, const TArray<FString>& GroupPatterns, FPhysicsAssetCostReport& OutReport);
+
+	/** One row per body, per group and for the asset, then one row per constraint configuration */
+	FString ToCsv(const FPhysicsAssetCostReport& Report);
+}
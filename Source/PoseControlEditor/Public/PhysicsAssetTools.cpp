@@ -1,9 +1,14 @@
 ﻿#include "PhysicsAssetTools.h"
 
+#include "BackgroundOperation.h"
 #include "CustomLogging.h"
 #include "EditorAssetLibrary.h"
 #include "MeshUtilities.h"
 #include "MeshUtilitiesCommon.h"
+#include "MorphVariantCache.h"
+#include "PackageSaveScope.h"
+#include "PhysicsAssetTransaction.h"
+#include "PcCharacterPipeline.h"
 #include "PhysicsEditorBPLibrary.h"
 #include "Animation/PcAnimInstance.h"
 #include "Animation/SkeletalMeshActor.h"
@@ -35,12 +40,13 @@ bool UPhysicsAssetTools::SetDataAsset(UPcActorDataAsset* DataAsset)
 		return false; }
 	
 	// if TargetPhysicsAsset doesn't exist, create it. 
-	TargetPhysicsAsset = DataAsset->TargetPhysicsAsset.LoadSynchronous();
+	TargetPhysicsAsset = DataAsset->GetTargetPhysicsAsset();
+	bPhysAssetHelperValid = TargetPhysicsAsset != nullptr;
 	if (!TargetPhysicsAsset)
 	{
-		if(CopyPhysicsAsset(PcActorDataAsset, false) && PcActorDataAsset->TargetPhysicsAsset.LoadSynchronous())
+		if(CopyPhysicsAsset(PcActorDataAsset, false) && PcActorDataAsset->GetTargetPhysicsAsset())
 		{
-			TargetPhysicsAsset = PcActorDataAsset->TargetPhysicsAsset.LoadSynchronous();
+			TargetPhysicsAsset = PcActorDataAsset->GetTargetPhysicsAsset();
 			bPhysAssetHelperValid = true;
 		}
 		else
@@ -74,6 +80,11 @@ bool UPhysicsAssetTools::ProcessCharacterDA(UPcActorDataAsset* DataAsset, FMeshB
 	return true;
 }
 
+UPcCharacterPipeline* UPhysicsAssetTools::ProcessCharacterPipeline(UPcActorDataAsset* DataAsset, FMeshBakeOptions Options)
+{
+	return UPcCharacterPipeline::RunCharacterPipeline(DataAsset, Options);
+}
+
 bool UPhysicsAssetTools::CopyPhysicsAsset(UPcActorDataAsset* DataAsset, bool bForceCopy = false)
 {
 	if (!DataAsset)
@@ -82,13 +93,11 @@ bool UPhysicsAssetTools::CopyPhysicsAsset(UPcActorDataAsset* DataAsset, bool bFo
 		return false;
 	}
 	
-	auto TargetPhysicsAssetPtr = DataAsset->TargetPhysicsAsset;
-	UPhysicsAsset* TargetPhysicsAsset = TargetPhysicsAssetPtr.LoadSynchronous();
+	UPhysicsAsset* TargetPhysicsAsset = DataAsset->GetTargetPhysicsAsset();
 	
 	if (!TargetPhysicsAsset || bForceCopy)
 	{
-		auto SourcePhysicsAssetPtr = DataAsset->SourcePhysicsAsset;
-		UPhysicsAsset* SourcePhysicsAsset = SourcePhysicsAssetPtr.LoadSynchronous();
+		UPhysicsAsset* SourcePhysicsAsset = DataAsset->GetSourcePhysicsAsset();
 		if(SourcePhysicsAsset)
 		{
 			const FString TargetPath = MakeAssetPath(DataAsset->NewAssetPath,
@@ -150,6 +159,14 @@ bool UPhysicsAssetTools::CreatePhysicsAssetAndMorphedSkm(UPcActorDataAsset* Data
 {
 	UPhysicsAssetTools* PhysAssetHelper = NewObject<UPhysicsAssetTools>();
 	PhysAssetHelper->SetDataAsset(DataAsset);
+	if (PhysAssetHelper->bPhysAssetHelperValid && DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+	{
+		// Nothing to bake, the variant's pose goes straight to the data asset
+		if(!MorphVariantCache::Apply(DataAsset))
+			return false;
+		FScopedPackageSave::RequestSave({PhysAssetHelper->TargetPhysicsAsset.Get(), DataAsset});
+		return true;
+	}
 	if (PhysAssetHelper->bPhysAssetHelperValid)
 	{
 		PhysAssetHelper->CreatePhysicsAssetInternal();
@@ -158,6 +175,16 @@ bool UPhysicsAssetTools::CreatePhysicsAssetAndMorphedSkm(UPcActorDataAsset* Data
 	return false;
 }
 
+UPhysicsAssetTools* UPhysicsAssetTools::StartBakeMorphedMesh(UPcActorDataAsset* DataAsset, FOnMorphedMeshBaked OnCompleted)
+{
+	UPhysicsAssetTools* PhysAssetHelper = NewObject<UPhysicsAssetTools>();
+	PhysAssetHelper->SetDataAsset(DataAsset);
+	PhysAssetHelper->OnBakeCompleted = OnCompleted;
+	if (PhysAssetHelper->bPhysAssetHelperValid && PhysAssetHelper->CreatePhysicsAssetInternal())
+		return PhysAssetHelper;
+	return nullptr;
+}
+
 bool UPhysicsAssetTools::CreatePhysicsAssetInternal()
 {
 	UUnrealEditorSubsystem* UnrealEditorSubsystem = GEditor->GetEditorSubsystem<UUnrealEditorSubsystem>();
@@ -178,7 +205,7 @@ bool UPhysicsAssetTools::CreatePhysicsAssetInternal()
 		LGE("SkeletalMeshComp unable to be created.")
 		return false; }
 
-	auto SourceSkeletalMesh = PcActorDataAsset->SourceSkeletalMesh.LoadSynchronous();
+	auto SourceSkeletalMesh = PcActorDataAsset->GetSourceSkeletalMesh();
 	if(!SourceSkeletalMesh) {
 		LGE("SourceSkeletalMesh unable to be created.")
 		return false; }
@@ -247,6 +274,8 @@ void UPhysicsAssetTools::CreatePhysicsAssetDelayed()
 	NewSkeletalMesh = CopyMeshWithMorphs(SkelMeshComp, PcActorDataAsset);
 	if(!NewSkeletalMesh) {
 		LGE("NewSkeletalMesh unable to be created.")
+		SkelMeshComp->DestroyComponent();
+		OnBakeCompleted.ExecuteIfBound(false);
 		return; }
 	PcActorDataAsset->TargetSkeletalMesh = NewSkeletalMesh;
 	const auto RefSkeleton = NewSkeletalMesh->GetRefSkeleton();
@@ -261,10 +290,12 @@ void UPhysicsAssetTools::CreatePhysicsAssetDelayed()
 	TargetPhysicsAsset->SetPreviewMesh(NewSkeletalMesh);
 	LG("Created New Skeletal Mesh")
 
-	LG("Saving Package")
-	UEditorAssetLibrary::SaveLoadedAssets({TargetPhysicsAsset, NewSkeletalMesh}, false);	
+	LG("Saving Packages")
+	PcActorDataAsset->MarkPackageDirty();
+	FScopedPackageSave::RequestSave({TargetPhysicsAsset, NewSkeletalMesh, PcActorDataAsset}, true);
 
 	SkelMeshComp->DestroyComponent();
+	OnBakeCompleted.ExecuteIfBound(true);
 	
 	// if (CreateBodiesFromDataTable(PcActorDataAsset->BodyParamsDataTable, PhysicsAsset, NewSkeletalMesh))
 	// {
@@ -314,12 +345,12 @@ USkeletalMesh* UPhysicsAssetTools::CopyMeshWithMorphs(USkeletalMeshComponent* Sk
 		const FPoseSnapshot* Snapshot = AnimInstance->GetPoseSnapshot(FName("MorphedPose"));
 		for(int i = 0; i < RefSkeleton.GetNum(); i++)
 		{
-			LG("Ori Transform %s: %s", *SkeletalMeshComponent->GetBoneName(i).ToString(), *RefSkeleton.GetRefBonePose()[i].ToString())
-			LG("New Transform %s: %s", *SkeletalMeshComponent->GetBoneName(i).ToString(), *SkeletalMeshComponent->GetBoneSpaceTransforms()[i].ToString())
+			LGV("Ori Transform %s: %s", *SkeletalMeshComponent->GetBoneName(i).ToString(), *RefSkeleton.GetRefBonePose()[i].ToString())
+			LGV("New Transform %s: %s", *SkeletalMeshComponent->GetBoneName(i).ToString(), *SkeletalMeshComponent->GetBoneSpaceTransforms()[i].ToString())
 			if(Snapshot)
 			{
 				RefSkelModifier.UpdateRefPoseTransform(i, Snapshot->LocalTransforms[i]);
-				LG("Sna Transform %s: %s", *SkeletalMeshComponent->GetBoneName(i).ToString(), *Snapshot->LocalTransforms[i].ToString())
+				LGV("Sna Transform %s: %s", *SkeletalMeshComponent->GetBoneName(i).ToString(), *Snapshot->LocalTransforms[i].ToString())
 			}
 			else
 				LGW("No snapshot.")
@@ -341,71 +372,270 @@ USkeletalMesh* UPhysicsAssetTools::CopyMeshWithMorphs(USkeletalMeshComponent* Sk
 	return Results.SkeletalMesh;
 }
 
-bool UPhysicsAssetTools::CreateBodiesFromDataTable(UPcActorDataAsset* DataAsset)
+/**
+ * The mesh bodies are fitted to: the baked target mesh, or in RefPoseCache mode the source mesh with the
+ * morph variant, whose bone vertices replace the mesh's own
+ */
+/** Dominant bone vertices of the mesh, after any pending compilation. Game thread only, it reads the imported model */
+static void GatherBoneVertInfos(USkeletalMesh* SkeletalMesh, TArray<FBoneVertInfo>& OutInfos)
+{
+	check(IsInGameThread());
+	SkeletalMesh->FinishCompilation();
+	IMeshUtilities& MeshUtilities = FModuleManager::Get().LoadModuleChecked<IMeshUtilities>("MeshUtilities");
+	MeshUtilities.CalcBoneVertInfos(SkeletalMesh, OutInfos, true);
+}
+
+/** True, with an error, if a background operation is still working on one of the assets */
+static bool IsAnyAssetBusy(const TArray<UObject*>& Assets)
+{
+	for(const UObject* Asset : Assets)
+	{
+		if(Asset && FPcBackgroundOperation::IsBusy(Asset)) {
+			LGE("ERROR: %s is used by a background operation. Aborting.", *Asset->GetName())
+			return true; }
+	}
+	return false;
+}
+
+static bool GetFitMesh(UPcActorDataAsset* DataAsset, USkeletalMesh*& OutSkeletalMesh, TSharedPtr<const FMorphVariant>& OutVariant)
+{
+	if(DataAsset->MorphVariantMode == EMorphVariantMode::RefPoseCache)
+	{
+		OutSkeletalMesh = DataAsset->GetSourceSkeletalMesh();
+		OutVariant = MorphVariantCache::FindOrEvaluate(DataAsset);
+		if(!OutVariant) {
+			LGE("ERROR: Morph variant not evaluated. Aborting.");
+			return false; }
+		return true;
+	}
+	OutSkeletalMesh = DataAsset->GetTargetSkeletalMesh();
+	if(!OutSkeletalMesh) {
+		LGE("ERROR: Target Skeletal Mesh not found. Aborting.");
+		return false; }
+	return true;
+}
+
+static bool GetBodyCreationInputs(UPcActorDataAsset* DataAsset, UDataTable*& OutDataTable, UPhysicsAsset*& OutPhysicsAsset,
+                                  USkeletalMesh*& OutSkeletalMesh, TSharedPtr<const FMorphVariant>& OutVariant)
 {
-	UDataTable* DataTable = DataAsset->BodyParamsDataTable.LoadSynchronous();
-	if(!DataTable) {
+	if(!DataAsset) {
+		LGE("ERROR: Data Asset not found. Aborting.");
+		return false; }
+	OutDataTable = DataAsset->GetBodyParamsDataTable();
+	if(!OutDataTable) {
 		LGE("ERROR: DataTable not found. Aborting.");
 		return false; }
 	
-	UPhysicsAsset* PhysicsAsset = DataAsset->TargetPhysicsAsset.LoadSynchronous();
-	if(!PhysicsAsset) {
+	OutPhysicsAsset = DataAsset->GetTargetPhysicsAsset();
+	if(!OutPhysicsAsset) {
 		LGE("ERROR: Target PhysicsAsset not found. Aborting.");
 		return false; }
 	
-	USkeletalMesh* SkeletalMesh = DataAsset->TargetSkeletalMesh.LoadSynchronous();
-	if(!SkeletalMesh) {
-		LGE("ERROR: Target Skeletal Mesh not found. Aborting.");
-		return false; }
-	PhysicsAsset->SetPreviewMesh(SkeletalMesh);
-	
-	TArray<FPhysAssetCreateParamsRow> Rows;
+	return GetFitMesh(DataAsset, OutSkeletalMesh, OutVariant);
+}
+
+/** One data table row, resolved on the game thread. The worker fills Geom from copies of the skeleton and vertices. */
+struct FBodyFitJob
+{
+	FName BodyName;
+	int32 BoneIndex = INDEX_NONE;
+	FPhysAssetCreateParams Params;
+	FKAggregateGeom Geom;
+	bool bFitted = false;
+};
+
+/** Rows of DataTable whose bone exists in RefSkeleton and has vertex infos */
+static void GatherBodyFitJobs(UDataTable* DataTable, const UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton,
+                              const TArray<FBoneVertInfo>& Infos, TArray<FBodyFitJob>& OutJobs)
+{
 	FString ContextString;
-	TArray<FName> RowNames = DataTable->GetRowNames();
+	for(const FName& BodyName : DataTable->GetRowNames())
+	{
+		const FPhysAssetCreateParamsRow* CreateParamsRow = DataTable->FindRow<FPhysAssetCreateParamsRow>(BodyName, ContextString);
+		if(!CreateParamsRow)
+			continue;
+		// New bodies are created for the bone of the row's name
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
+		const FName BoneName = BodyIndex != INDEX_NONE ? PhysicsAsset->SkeletalBodySetups[BodyIndex]->BoneName : BodyName;
+		const int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
+		if(BoneIndex == INDEX_NONE || !Infos.IsValidIndex(BoneIndex)) {
+			LGW("Bone %s not found on Skeleton. Skipping this body.", *BodyName.ToString());
+			continue; }
+		FBodyFitJob& Job = OutJobs.AddDefaulted_GetRef();
+		Job.BodyName = BodyName;
+		Job.BoneIndex = BoneIndex;
+		Job.Params = CreateParamsRow->GetCreateParams();
+	}
+}
 
-	IMeshUtilities& MeshUtilities = FModuleManager::Get().LoadModuleChecked<IMeshUtilities>("MeshUtilities");
-	TArray<FBoneVertInfo> Infos = TArray<FBoneVertInfo>();
-	MeshUtilities.CalcBoneVertInfos(SkeletalMesh, Infos, true);
+/**
+ * The box, sphere and capsule fit of FPhysicsAssetUtils::CreateCollisionFromBone, with RefPose as the bone space
+ * reference pose. Only reads its arguments, so it runs on worker threads. Returns false for hulls and level sets,
+ * which need the mesh and are left to CreateCollisionFromBone on the game thread.
+ */
+static bool FitBodyToBone(const FReferenceSkeleton& RefSkeleton, TConstArrayView<FTransform> RefPose, const FBoneVertInfo& Info,
+                          FBodyFitJob& Job)
+{
+	const EFitGeomType GeomType = Job.Params.GeomType;
+	if(GeomType != EFG_Box && GeomType != EFG_Sphere && GeomType != EFG_Sphyl)
+		return false;
+	
+	const float	MinPrimSize = 0.5f;
+	FMatrix ElemTM = FMatrix::Identity;
+	if(Job.Params.bAutoOrientToBone)
+	{
+		// Axis with the largest variance of the bone's vertices
+		const FMatrix CovarianceMatrix = ComputeCovarianceMatrix(Info);
+		FVector ZAxis = ComputeEigenVector(CovarianceMatrix);
+		FVector XAxis, YAxis;
+		ZAxis.FindBestAxisVectors(YAxis, XAxis);
+		ElemTM = FMatrix(XAxis, YAxis, ZAxis, FVector::ZeroVector);
+	}
+	FTransform ElemTransform(ElemTM);
 
-	FScopedSlowTask CreateBodiesTask = FScopedSlowTask(RowNames.Num(), NSLOCTEXT("CreateBodiesTask", "CreateBodies", "Adding Bodies..."));
-	CreateBodiesTask.MakeDialog(true, true);
+	FBox BoneBox(ForceInit);
+	for(const FVector3f& Position : Info.Positions)
+		BoneBox += ElemTransform.InverseTransformPosition(FVector(Position));
+
+	FVector BoxCenter(0, 0, 0), BoxExtent(0, 0, 0);
+	FBox TransformedBox = BoneBox;
+	if(BoneBox.IsValid)
+	{
+		// Scale of the composed reference pose applies to the size
+		FTransform ComposedTransform = FTransform::Identity;
+		for(int32 i = Job.BoneIndex; i != INDEX_NONE; i = RefSkeleton.GetParentIndex(i))
+			ComposedTransform = ComposedTransform * RefPose[i];
+		TransformedBox = BoneBox.TransformBy(ComposedTransform);
+		BoneBox.GetCenterAndExtents(BoxCenter, BoxExtent);
+	}
+	if(TransformedBox.GetExtent().GetMin() < MinPrimSize)
+		BoxExtent = FVector(MinPrimSize);
+	ElemTransform.SetTranslation(ElemTransform.TransformPosition(BoxCenter));
+
+	Job.Geom.EmptyElements();
+	if(GeomType == EFG_Box)
+	{
+		FKBoxElem BoxElem;
+		BoxElem.SetTransform(ElemTransform);
+		BoxElem.X = BoxExtent.X * 2.f * 1.01f;
+		BoxElem.Y = BoxExtent.Y * 2.f * 1.01f;
+		BoxElem.Z = BoxExtent.Z * 2.f * 1.01f;
+		Job.Geom.BoxElems.Add(BoxElem);
+	}
+	else if(GeomType == EFG_Sphere)
+	{
+		FKSphereElem SphereElem;
+		SphereElem.Center = ElemTransform.GetTranslation();
+		SphereElem.Radius = BoxExtent.GetMax() * 1.01f;
+		Job.Geom.SphereElems.Add(SphereElem);
+	}
+	else
+	{
+		// The capsule runs along the longest axis
+		FKSphylElem SphylElem;
+		if(BoxExtent.X > BoxExtent.Z && BoxExtent.X > BoxExtent.Y)
+		{
+			SphylElem.SetTransform(FTransform(FQuat(FVector(0, 1, 0), -UE_HALF_PI)) * ElemTransform);
+			SphylElem.Radius = FMath::Max(BoxExtent.Y, BoxExtent.Z) * 1.01f;
+			SphylElem.Length = BoxExtent.X * 1.01f;
+		}
+		else if(BoxExtent.Y > BoxExtent.Z && BoxExtent.Y > BoxExtent.X)
+		{
+			SphylElem.SetTransform(FTransform(FQuat(FVector(1, 0, 0), UE_HALF_PI)) * ElemTransform);
+			SphylElem.Radius = FMath::Max(BoxExtent.X, BoxExtent.Z) * 1.01f;
+			SphylElem.Length = BoxExtent.Y * 1.01f;
+		}
+		else
+		{
+			SphylElem.SetTransform(ElemTransform);
+			SphylElem.Radius = FMath::Max(BoxExtent.X, BoxExtent.Y) * 1.01f;
+			SphylElem.Length = BoxExtent.Z * 1.01f;
+		}
+		Job.Geom.SphylElems.Add(SphylElem);
+	}
+	Job.bFitted = true;
+	return true;
+}
+
+/** RefPose is the mesh's own reference pose, or a morph variant's that leaves every bone in place */
+static bool IsMeshRefPose(const FReferenceSkeleton& RefSkeleton, TConstArrayView<FTransform> RefPose)
+{
+	const TArray<FTransform>& MeshRefPose = RefSkeleton.GetRefBonePose();
+	if(RefPose.Num() != MeshRefPose.Num())
+		return false;
+	for(int32 i = 0; i < RefPose.Num(); i++)
+	{
+		if(!RefPose[i].Equals(MeshRefPose[i]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * The game thread part of CreateBodiesFromDataTable: creates missing bodies and applies the fitted shapes. Jobs the
+ * worker didn't fit are fitted here, with the mesh for hulls. Hulls take the mesh's own bones, so they're skipped for a
+ * morph variant that moves bones. bShowDialog is off inside a background operation's commit, which has its own notification.
+ */
+static bool ApplyBodyFitJobs(UPcActorDataAsset* DataAsset, UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
+                             TConstArrayView<FTransform> RefPose, const TArray<FBoneVertInfo>& Infos, TArray<FBodyFitJob>& Jobs,
+                             bool bShowDialog)
+{
+	PhysicsAsset->SetPreviewMesh(SkeletalMesh);
+
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("CreateBodiesTask", "CreateBodiesTransaction", "Create Bodies From Data Table"));
+	FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
+	FScopedSlowTask CreateBodiesTask = FScopedSlowTask(Jobs.Num(), NSLOCTEXT("CreateBodiesTask", "CreateBodies", "Adding Bodies..."));
+	if(bShowDialog)
+		CreateBodiesTask.MakeDialog(true, true);
+	const bool bMeshRefPose = IsMeshRefPose(SkeletalMesh->GetRefSkeleton(), RefPose);
 	
-	for ( auto& BodyName : RowNames )
+	for(FBodyFitJob& Job : Jobs)
 	{
+		if(CreateBodiesTask.ShouldCancel())
+			break;
+		const FName BodyName = Job.BodyName;
 		FText TaskText = FText::FromString(FString::Format(TEXT("Making body for bone {0}"), {BodyName.ToString()}));
 		CreateBodiesTask.EnterProgressFrame(1, TaskText);
+		const bool bFitted = Job.bFitted || FitBodyToBone(SkeletalMesh->GetRefSkeleton(), RefPose, Infos[Job.BoneIndex], Job);
+		if(!bFitted && !bMeshRefPose)
+		{
+			LGW("Body %s skipped, its geometry type can't be fitted to a morph variant that moves bones. Bake the variant instead.", *BodyName.ToString())
+			continue;
+		}
 
-		if ( FPhysAssetCreateParamsRow* CreateParamsRow = DataTable->FindRow<FPhysAssetCreateParamsRow>(BodyName, ContextString) )
+		int BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
+		if (BodyIndex == INDEX_NONE)
 		{
-			auto CreateParams = CreateParamsRow->GetCreateParams();
-			int BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
-			if (BodyIndex == INDEX_NONE)
-			{
-				LGW("Body %s not found on PhysicsAsset, trying to create it", *BodyName.ToString());
-				TObjectPtr<USkeletalBodySetup> BodySetup = NewObject<USkeletalBodySetup>();
-				BodySetup->BoneName = BodyName;
-				PhysicsAsset->SkeletalBodySetups.Add(BodySetup);
-				PhysicsAsset->UpdateBodySetupIndexMap();
-				// Ensure it was added
-				BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
-				if (BodyIndex == INDEX_NONE) { LGW("Body %s not able to be created on PhysicsAsset", *BodyName.ToString());
-					PhysicsAsset->SkeletalBodySetups.Pop();
-					continue; }
-			}
-			
-			USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
-			FName BoneName = BodySetup->BoneName;
-			int BoneIndex = SkeletalMesh->GetRefSkeleton().FindBoneIndex(BoneName);
-			if(BoneIndex == INDEX_NONE) { LGW("Bone %s not found on Skeleton. Skipping this body.", *BodyName.ToString());
-				continue;
-			}	
-			LG("Creating collision from bone %s", *BodyName.ToString());
-			FPhysicsAssetUtils::CreateCollisionFromBone(BodySetup, SkeletalMesh, BoneIndex, CreateParams, Infos[BoneIndex]);
-
-			if(CreateParams.GeomType == EFG_Sphyl)
-			{
-				DataAsset->CapsuleNames.Add(BodyName);	
-			}
+			LGW("Body %s not found on PhysicsAsset, trying to create it", *BodyName.ToString());
+			TObjectPtr<USkeletalBodySetup> BodySetup = NewObject<USkeletalBodySetup>(PhysicsAsset, NAME_None, RF_Transactional);
+			BodySetup->BoneName = BodyName;
+			PhysicsAsset->SkeletalBodySetups.Add(BodySetup);
+			PhysicsAsset->UpdateBodySetupIndexMap();
+			// Ensure it was added
+			BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
+			if (BodyIndex == INDEX_NONE) { LGW("Body %s not able to be created on PhysicsAsset", *BodyName.ToString());
+				PhysicsAsset->SkeletalBodySetups.Pop();
+				continue; }
+		}
+		
+		USkeletalBodySetup* BodySetup = PhysicsAsset->SkeletalBodySetups[BodyIndex];
+		LG("Creating collision from bone %s", *BodyName.ToString());
+		FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, BodyIndex);
+		if(bFitted)
+		{
+			BodySetup->RemoveSimpleCollision();
+			BodySetup->AddCollisionFrom(Job.Geom);
+			BodySetup->InvalidatePhysicsData();
+			BodySetup->CreatePhysicsMeshes();
+		}
+		else
+		{
+			FPhysicsAssetUtils::CreateCollisionFromBone(BodySetup, SkeletalMesh, Job.BoneIndex, Job.Params, Infos[Job.BoneIndex]);
+		}
+
+		if(Job.Params.GeomType == EFG_Sphyl)
+		{
+			DataAsset->CapsuleNames.AddUnique(BodyName);
 		}
 	}
 	
@@ -417,41 +647,122 @@ bool UPhysicsAssetTools::CreateBodiesFromDataTable(UPcActorDataAsset* DataAsset)
 	// UEditorAssetLibrary::SaveLoadedAsset(PhysicsAsset, false);
 	
 	return true;
-	
 }
 
+bool UPhysicsAssetTools::CreateBodiesFromDataTable(UPcActorDataAsset* DataAsset)
+{
+	UDataTable* DataTable = nullptr;
+	UPhysicsAsset* PhysicsAsset = nullptr;
+	USkeletalMesh* SkeletalMesh = nullptr;
+	TSharedPtr<const FMorphVariant> Variant;
+	if(!GetBodyCreationInputs(DataAsset, DataTable, PhysicsAsset, SkeletalMesh, Variant))
+		return false;
+	if(IsAnyAssetBusy({DataAsset, DataTable, PhysicsAsset, SkeletalMesh}))
+		return false;
 
+	TArray<FBoneVertInfo> Infos = TArray<FBoneVertInfo>();
+	if(Variant)
+		Infos = Variant->Infos;
+	else
+		GatherBoneVertInfos(SkeletalMesh, Infos);
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->GetRefSkeleton();
+	TArray<FBodyFitJob> Jobs;
+	GatherBodyFitJobs(DataTable, PhysicsAsset, RefSkeleton, Infos, Jobs);
+	return ApplyBodyFitJobs(DataAsset, PhysicsAsset, SkeletalMesh, Variant ? Variant->RefPose : RefSkeleton.GetRefBonePose(), Infos, Jobs, true);
+}
 
-bool UPhysicsAssetTools::AlignCapsulesToBones(UPcActorDataAsset* DataAsset)
+bool UPhysicsAssetTools::CreateBodiesFromDataTableInBackground(UPcActorDataAsset* DataAsset)
 {
-	LG("Aligning capsules to bones.")
+	UDataTable* DataTable = nullptr;
+	UPhysicsAsset* PhysicsAsset = nullptr;
+	USkeletalMesh* SkeletalMesh = nullptr;
+	TSharedPtr<const FMorphVariant> Variant;
+	if(!GetBodyCreationInputs(DataAsset, DataTable, PhysicsAsset, SkeletalMesh, Variant))
+		return false;
+	if(IsAnyAssetBusy({DataAsset, DataTable, PhysicsAsset, SkeletalMesh}))
+		return false;
+
+	// The mesh's imported model is only safe to read on the game thread, so the vertices are gathered and the skeleton
+	// copied before launching. The worker fits the shapes, the commit only creates bodies and applies them.
+	TSharedRef<TArray<FBoneVertInfo>> Infos = MakeShared<TArray<FBoneVertInfo>>();
+	if(Variant)
+		*Infos = Variant->Infos;
+	else
+		GatherBoneVertInfos(SkeletalMesh, *Infos);
+	TSharedRef<FReferenceSkeleton> RefSkeleton = MakeShared<FReferenceSkeleton>(SkeletalMesh->GetRefSkeleton());
+	TSharedRef<TArray<FTransform>> RefPose = MakeShared<TArray<FTransform>>(Variant ? Variant->RefPose : RefSkeleton->GetRefBonePose());
+	TSharedRef<TArray<FBodyFitJob>> Jobs = MakeShared<TArray<FBodyFitJob>>();
+	GatherBodyFitJobs(DataTable, PhysicsAsset, *RefSkeleton, *Infos, *Jobs);
 	
+	return FPcBackgroundOperation::Launch(NSLOCTEXT("CreateBodiesTask", "CreateBodiesBackground", "Creating bodies"),
+		{DataAsset, DataTable, PhysicsAsset, SkeletalMesh},
+		[RefSkeleton, RefPose, Infos, Jobs](FPcBackgroundOperation& Operation)
+		{
+			for(int32 i = 0; i < Jobs->Num() && !Operation.IsCancelled(); i++)
+			{
+				FBodyFitJob& Job = (*Jobs)[i];
+				Operation.SetProgress(float(i + 1) / Jobs->Num(), Job.BodyName.ToString());
+				FitBodyToBone(*RefSkeleton, *RefPose, (*Infos)[Job.BoneIndex], Job);
+			}
+			return true;
+		},
+		[DataAsset, PhysicsAsset, SkeletalMesh, RefPose, Infos, Jobs]()
+		{
+			return ApplyBodyFitJobs(DataAsset, PhysicsAsset, SkeletalMesh, *RefPose, *Infos, *Jobs, false);
+		}).IsValid();
+}
+
+/**
+ * Capsule along the bone fitted to its skinned vertices, with RefPose as the bone space reference pose.
+ * Only reads its arguments, so it also runs on worker threads given copies of the skeleton and infos.
+ */
+static bool FitCapsuleToBone(const FReferenceSkeleton& RefSkeleton, TConstArrayView<FTransform> RefPose, FName BodyName, FName BoneName,
+                             const TArray<FBoneVertInfo>& Infos, FKSphylElem& OutCapsule);
+static void ApplyCapsule(UPhysicsAsset* PhysicsAsset, int32 BodyIndex, const FKSphylElem& Capsule);
+
+static bool GetCapsuleAlignInputs(UPcActorDataAsset* DataAsset, UPhysicsAsset*& OutPhysicsAsset, USkeletalMesh*& OutSkeletalMesh,
+                                  TSharedPtr<const FMorphVariant>& OutVariant)
+{
 	if(!DataAsset) {
 		LGE("ERROR: Data Asset not found. Aborting.");
 		return false; }
 	
-	UPhysicsAsset* PhysicsAsset = DataAsset->TargetPhysicsAsset.LoadSynchronous();
-	if(!PhysicsAsset) {
+	OutPhysicsAsset = DataAsset->GetTargetPhysicsAsset();
+	if(!OutPhysicsAsset) {
 		LGE("ERROR: Target PhysicsAsset not found. Aborting.");
 		return false; }
 	
-	USkeletalMesh* SkeletalMesh = DataAsset->TargetSkeletalMesh.LoadSynchronous();
-	if(!SkeletalMesh) {
-		LGE("ERROR: Target SkeletalMesh not found. Aborting.");
-		return false; }
+	if(!GetFitMesh(DataAsset, OutSkeletalMesh, OutVariant))
+		return false;
 	
 	if(DataAsset->CapsuleNames.Num() == 0)
 	{
 		// TODO: find capsule bones from PhysicsAsset
 		LGE("ERROR: No Capsule Names found. Aborting.");
 	}
+	return true;
+}
+
+bool UPhysicsAssetTools::AlignCapsulesToBones(UPcActorDataAsset* DataAsset)
+{
+	LG("Aligning capsules to bones.")
+	UPhysicsAsset* PhysicsAsset = nullptr;
+	USkeletalMesh* SkeletalMesh = nullptr;
+	TSharedPtr<const FMorphVariant> Variant;
+	if(!GetCapsuleAlignInputs(DataAsset, PhysicsAsset, SkeletalMesh, Variant))
+		return false;
+	if(IsAnyAssetBusy({DataAsset, PhysicsAsset, SkeletalMesh}))
+		return false;
 	
 	TArray<FBoneVertInfo> Infos = TArray<FBoneVertInfo>();
-	IMeshUtilities& MeshUtilities = FModuleManager::Get().LoadModuleChecked<IMeshUtilities>("MeshUtilities");
-	MeshUtilities.CalcBoneVertInfos(SkeletalMesh, Infos, true);
-	for(const auto Name : DataAsset->CapsuleNames)
+	if(Variant)
+		Infos = Variant->Infos;
+	else
+		GatherBoneVertInfos(SkeletalMesh, Infos);
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsAssetTools", "AlignCapsules", "Align Capsules To Bones"));
+	for(const FName& Name : DataAsset->CapsuleNames)
 	{
-		AlignCapsule(PhysicsAsset, SkeletalMesh, Name, Infos);
+		AlignCapsule(PhysicsAsset, SkeletalMesh, Name, Infos, Variant ? TConstArrayView<FTransform>(Variant->RefPose) : TConstArrayView<FTransform>());
 	}
 	
 	PhysicsAsset->RefreshPhysicsAssetChange();
@@ -460,6 +771,71 @@ bool UPhysicsAssetTools::AlignCapsulesToBones(UPcActorDataAsset* DataAsset)
 	return true;
 }
 
+bool UPhysicsAssetTools::AlignCapsulesToBonesInBackground(UPcActorDataAsset* DataAsset)
+{
+	UPhysicsAsset* PhysicsAsset = nullptr;
+	USkeletalMesh* SkeletalMesh = nullptr;
+	TSharedPtr<const FMorphVariant> Variant;
+	if(!GetCapsuleAlignInputs(DataAsset, PhysicsAsset, SkeletalMesh, Variant))
+		return false;
+	if(IsAnyAssetBusy({DataAsset, PhysicsAsset, SkeletalMesh}))
+		return false;
+
+	// Bone names, vertices and the skeleton are read here, the worker only fits copies
+	struct FCapsuleJob
+	{
+		FName BodyName;
+		FName BoneName;
+		FKSphylElem Capsule;
+		bool bValid = false;
+	};
+	TSharedRef<TArray<FCapsuleJob>> Jobs = MakeShared<TArray<FCapsuleJob>>();
+	for(const FName& Name : DataAsset->CapsuleNames)
+	{
+		const int32 BodyIndex = PhysicsAsset->FindBodyIndex(Name);
+		if(BodyIndex == INDEX_NONE) {
+			LGW("BodyName %s can't be found in Physics Asset. Skipping.", *Name.ToString())
+			continue; }
+		Jobs->Add({Name, PhysicsAsset->SkeletalBodySetups[BodyIndex]->BoneName});
+	}
+
+	TSharedRef<TArray<FBoneVertInfo>> Infos = MakeShared<TArray<FBoneVertInfo>>();
+	if(!Variant)
+		GatherBoneVertInfos(SkeletalMesh, *Infos);
+	TSharedRef<FReferenceSkeleton> RefSkeleton = MakeShared<FReferenceSkeleton>(SkeletalMesh->GetRefSkeleton());
+	return FPcBackgroundOperation::Launch(NSLOCTEXT("PhysicsAssetTools", "AlignCapsulesBackground", "Aligning capsules"),
+		{DataAsset, PhysicsAsset, SkeletalMesh},
+		[RefSkeleton, Variant, Infos, Jobs](FPcBackgroundOperation& Operation)
+		{
+			const TArray<FBoneVertInfo>& FitInfos = Variant ? Variant->Infos : *Infos;
+			const TConstArrayView<FTransform> RefPose = Variant ? Variant->RefPose : RefSkeleton->GetRefBonePose();
+			for(int32 i = 0; i < Jobs->Num() && !Operation.IsCancelled(); i++)
+			{
+				FCapsuleJob& Job = (*Jobs)[i];
+				Operation.SetProgress(float(i + 1) / Jobs->Num(), Job.BodyName.ToString());
+				Job.bValid = FitCapsuleToBone(*RefSkeleton, RefPose, Job.BodyName, Job.BoneName, FitInfos, Job.Capsule);
+			}
+			return true;
+		},
+		[PhysicsAsset, Jobs]()
+		{
+			FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsAssetTools", "AlignCapsules", "Align Capsules To Bones"));
+			for(const FCapsuleJob& Job : *Jobs)
+			{
+				if(Job.bValid)
+					ApplyCapsule(PhysicsAsset, PhysicsAsset->FindBodyIndex(Job.BodyName), Job.Capsule);
+			}
+			PhysicsAsset->RefreshPhysicsAssetChange();
+			PhysicsAsset->MarkPackageDirty();
+			LogBodies(PhysicsAsset);
+			return true;
+		}).IsValid();
+}
+
+/** The twist body's convex shape copied onto its parent body, offset by RefBonePose, the bone space pose of RefSkeleton */
+static bool CopyTwistShape(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton, TConstArrayView<FTransform> RefBonePose,
+                           FName BodyName);
+
 bool UPhysicsAssetTools::CopyTwistShapesToParents(UPcActorDataAsset* DataAsset, bool bDeleteChildBodies = false)
 {
 	LG("Copying Twist bones to parents.")
@@ -468,24 +844,28 @@ bool UPhysicsAssetTools::CopyTwistShapesToParents(UPcActorDataAsset* DataAsset,
 		LGE("ERROR: Data Asset not found. Aborting.");
 		return false; }
 	
-	UPhysicsAsset* PhysicsAsset = DataAsset->TargetPhysicsAsset.LoadSynchronous();
+	UPhysicsAsset* PhysicsAsset = DataAsset->GetTargetPhysicsAsset();
 	if(!PhysicsAsset) {
 		LGE("ERROR: Target PhysicsAsset not found. Aborting.");
 		return false; }
 	
-	USkeletalMesh* SkeletalMesh = DataAsset->TargetSkeletalMesh.LoadSynchronous();
-	if(!SkeletalMesh) {
-		LGE("ERROR: Target Skeletal Mesh not found. Aborting.");
-		return false; }
+	USkeletalMesh* SkeletalMesh = nullptr;
+	TSharedPtr<const FMorphVariant> Variant;
+	if(!GetFitMesh(DataAsset, SkeletalMesh, Variant))
+		return false;
+	const TConstArrayView<FTransform> RefPose = Variant ? Variant->RefPose : SkeletalMesh->GetRefSkeleton().GetRefBonePose();
 	
 	if(DataAsset->TwistNames.Num() == 0)
 	{
 		DataAsset->TwistNames = TwistBoneNames;
 	}
+	FScopedPhysicsAssetTransaction Transaction(NSLOCTEXT("PhysicsAssetTools", "CopyTwistShapes", "Copy Twist Shapes To Parents"));
+	if(bDeleteChildBodies)
+		FScopedPhysicsAssetTransaction::ModifyAsset(PhysicsAsset);
 	for(FName BoneName : DataAsset->TwistNames)
 	{
 		LG("Copying twist shape from %s", *BoneName.ToString())
-		CopyTwistShapeToParent(PhysicsAsset, SkeletalMesh, BoneName, bDeleteChildBodies);
+		CopyTwistShape(PhysicsAsset, SkeletalMesh->GetRefSkeleton(), RefPose, BoneName);
 	}
 	if(bDeleteChildBodies)
 	{
@@ -509,8 +889,12 @@ bool UPhysicsAssetTools::CopyTwistShapesToParents(UPcActorDataAsset* DataAsset,
 bool UPhysicsAssetTools::CopyTwistShapeToParent(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh,
                                               FName BodyName, bool bDeleteChildBody = false)
 {
-	FReferenceSkeleton RefSkeleton = SkeletalMesh->GetRefSkeleton();
-	auto RefBonePose = RefSkeleton.GetRefBonePose();
+	return CopyTwistShape(PhysicsAsset, SkeletalMesh->GetRefSkeleton(), SkeletalMesh->GetRefSkeleton().GetRefBonePose(), BodyName);
+}
+
+static bool CopyTwistShape(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton, TConstArrayView<FTransform> RefBonePose,
+                           FName BodyName)
+{
 	int BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
 	if (BodyIndex == INDEX_NONE) {
 		LG("BodyName %s can't be found in Physics Asset. Aborting.", *BodyName.ToString());
@@ -538,6 +922,7 @@ bool UPhysicsAssetTools::CopyTwistShapeToParent(UPhysicsAsset* PhysicsAsset, USk
 	USkeletalBodySetup* Body = PhysicsAsset->SkeletalBodySetups[BodyIndex];
 	USkeletalBodySetup* ParentBody = PhysicsAsset->SkeletalBodySetups[ParentBodyIndex];
 
+	FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, ParentBodyIndex);
 	FKAggregateGeom* AggGeom = &Body->AggGeom;
 	FKAggregateGeom* ParentAggGeom = &ParentBody->AggGeom;
 	
@@ -575,32 +960,22 @@ bool UPhysicsAssetTools::AlignCapsuleToBone(UPhysicsAsset* PhysicsAsset, USkelet
 	return AlignCapsule(PhysicsAsset, SkeletalMesh, BodyName, Infos);
 }
 
-bool UPhysicsAssetTools::AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, FName BodyName,
-                                    TArray<FBoneVertInfo> Infos)
+static bool FitCapsuleToBone(const FReferenceSkeleton& RefSkeleton, TConstArrayView<FTransform> RefPose, FName BodyName, FName BoneName,
+                             const TArray<FBoneVertInfo>& Infos, FKSphylElem& OutCapsule)
 {
 	const float	MinPrimSize = 0.5f;
 	float Distance = 0.f;
-	FKSphylElem Capsule;
 	FTransform BoneTransform, OtherTransform;
 
-	FReferenceSkeleton RefSkeleton = SkeletalMesh->GetRefSkeleton();
-	int32 BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
-	if (BodyIndex == INDEX_NONE) {
-		LGW("BodyName %s can't be found in Physics Asset. Aborting.", *BodyName.ToString());
-		return false;
-	}
-	USkeletalBodySetup* Body = PhysicsAsset->SkeletalBodySetups[BodyIndex];
-
-	FName BoneName = Body->BoneName;
 	int32 BoneIndex = RefSkeleton.FindBoneIndex(BoneName);
-	if (BoneIndex == INDEX_NONE) {
+	if (BoneIndex == INDEX_NONE || !Infos.IsValidIndex(BoneIndex) || !RefPose.IsValidIndex(BoneIndex)) {
 		LGW("BodyName %s can't be found on skeletal mesh. Aborting.", *BodyName.ToString());
 		return false;
 	}
-	FBoneVertInfo Info = Infos[BoneIndex];
+	const FBoneVertInfo& Info = Infos[BoneIndex];
 
 	
-	BoneTransform = RefSkeleton.GetRefBonePose()[BoneIndex];
+	BoneTransform = RefPose[BoneIndex];
 	LGV("Body %s, Distance: %f", *BodyName.ToString(), Distance);
 
 
@@ -635,8 +1010,10 @@ bool UPhysicsAssetTools::AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh
 	if (BoneBox.IsValid)
 	{
 		// make sure to apply scale to the box size
-		FMatrix BoneMatrix = SkeletalMesh->GetComposedRefPoseMatrix(BoneIndex);
-		TransformedBox = BoneBox.TransformBy(FTransform(BoneMatrix));
+		FTransform ComposedTransform = FTransform::Identity;
+		for(int32 i = BoneIndex; i != INDEX_NONE; i = RefSkeleton.GetParentIndex(i))
+			ComposedTransform = ComposedTransform * RefPose[i];
+		TransformedBox = BoneBox.TransformBy(ComposedTransform);
 		BoneBox.GetCenterAndExtents(BoxCenter, BoxExtent);
 	}
 
@@ -660,22 +1037,22 @@ bool UPhysicsAssetTools::AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh
 
 	if (BoxExtent.X > BoxExtent.Z && BoxExtent.X > BoxExtent.Y) {
 		//X is the biggest so we must rotate X-axis into Z-axis
-		//Capsule.SetTransform(FTransform(FQuat(FVector(0, 1, 0), -PI * 0.5f)) * BoneTransform);
-		Capsule.Radius = FMath::Min(BoxExtent.Y, BoxExtent.Z) * 1.01f;
-		//Capsule.Length = Distance;// BoxExtent.X * 1.01f;
+		//OutCapsule.SetTransform(FTransform(FQuat(FVector(0, 1, 0), -PI * 0.5f)) * BoneTransform);
+		OutCapsule.Radius = FMath::Min(BoxExtent.Y, BoxExtent.Z) * 1.01f;
+		//OutCapsule.Length = Distance;// BoxExtent.X * 1.01f;
 
 	} else if (BoxExtent.Y > BoxExtent.Z && BoxExtent.Y > BoxExtent.X) {
 		//Y is the biggest so we must rotate Y-axis into Z-axis
-		//Capsule.SetTransform(FTransform(FQuat(FVector(1, 0, 0), PI * 0.5f)) * BoneTransform);
-		//Capsule.Radius = FMath::Max(BoxExtent.X, BoxExtent.Z) * 1.01f;
-		Capsule.Radius = FMath::Min(BoxExtent.X, BoxExtent.Z) * 1.01f;
-		//Capsule.Length = Distance;// BoxExtent.Y * 1.01f;
+		//OutCapsule.SetTransform(FTransform(FQuat(FVector(1, 0, 0), PI * 0.5f)) * BoneTransform);
+		//OutCapsule.Radius = FMath::Max(BoxExtent.X, BoxExtent.Z) * 1.01f;
+		OutCapsule.Radius = FMath::Min(BoxExtent.X, BoxExtent.Z) * 1.01f;
+		//OutCapsule.Length = Distance;// BoxExtent.Y * 1.01f;
 	} else {
 		//Z is the biggest so use transform as is
-		//Capsule.SetTransform(BoneTransform);
+		//OutCapsule.SetTransform(BoneTransform);
 
-		Capsule.Radius = FMath::Min(BoxExtent.X, BoxExtent.Y) * 1.01f;
-		//Capsule.Length =  Distance;//BoxExtent.Z * 1.01f;
+		OutCapsule.Radius = FMath::Min(BoxExtent.X, BoxExtent.Y) * 1.01f;
+		//OutCapsule.Length =  Distance;//BoxExtent.Z * 1.01f;
 	}
 
 
@@ -685,31 +1062,53 @@ bool UPhysicsAssetTools::AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh
 		//UE_LOGFMT(LogCore, Warning, "Body {name}, Location: {vector}", BodyName, BoneLocation.ToCompactString());
 		TArray<int32> ChildIndices = TArray<int32>();
 		if (RefSkeleton.GetDirectChildBones(BoneIndex, ChildIndices)) {
-			OtherTransform = RefSkeleton.GetRefBonePose()[ChildIndices[0]];
+			OtherTransform = RefPose[ChildIndices[0]];
 			Distance = FVector::Dist(BoneLocation, OtherTransform.GetTranslation());
 		}
 		else {
-			OtherTransform = RefSkeleton.GetRefBonePose()[RefSkeleton.GetParentIndex(BoneIndex)];
+			OtherTransform = RefPose[RefSkeleton.GetParentIndex(BoneIndex)];
 			//UE_LOGFMT(LogCore, Warning, "Other Transform, Location: {vector}", OtherTransform.GetTranslation().ToCompactString());
 			Distance = FVector::Dist(BoneLocation, OtherTransform.GetTranslation()) * 2 / 3;
 		}
-		Capsule.Length = Distance;
+		OutCapsule.Length = Distance;
 	}
 
-	Capsule.SetTransform(BoneTransform);
+	OutCapsule.SetTransform(BoneTransform);
 	float xDisplacement = BodyName.ToString().EndsWith("r") ? (-Distance / 2) : Distance / 2;
-	Capsule.Center = FVector(xDisplacement, 0, 0);
-	//Capsule.Radius = Distance *  .3;
-	Capsule.Rotation = FRotator(90, 0, 0);
+	OutCapsule.Center = FVector(xDisplacement, 0, 0);
+	//OutCapsule.Radius = Distance *  .3;
+	OutCapsule.Rotation = FRotator(90, 0, 0);
 
-	FKAggregateGeom* AggGeom = &Body->AggGeom;
-	if (AggGeom->SphylElems.IsValidIndex(0))\
+	return true;
+}
+
+static void ApplyCapsule(UPhysicsAsset* PhysicsAsset, int32 BodyIndex, const FKSphylElem& Capsule)
+{
+	if(!PhysicsAsset->SkeletalBodySetups.IsValidIndex(BodyIndex))
+		return;
+	FScopedPhysicsAssetTransaction::ModifyBody(PhysicsAsset, BodyIndex);
+	FKAggregateGeom* AggGeom = &PhysicsAsset->SkeletalBodySetups[BodyIndex]->AggGeom;
+	if (AggGeom->SphylElems.IsValidIndex(0))
 		AggGeom->SphylElems[0] = Capsule;
 	else {
 		AggGeom->SphylElems.Add(Capsule);
 	}
-	
+}
 
+bool UPhysicsAssetTools::AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, FName BodyName,
+                                    const TArray<FBoneVertInfo>& Infos, TConstArrayView<FTransform> RefPose)
+{
+	int32 BodyIndex = PhysicsAsset->FindBodyIndex(BodyName);
+	if (BodyIndex == INDEX_NONE) {
+		LGW("BodyName %s can't be found in Physics Asset. Aborting.", *BodyName.ToString());
+		return false;
+	}
+	FKSphylElem Capsule;
+	if(RefPose.IsEmpty())
+		RefPose = SkeletalMesh->GetRefSkeleton().GetRefBonePose();
+	if(!FitCapsuleToBone(SkeletalMesh->GetRefSkeleton(), RefPose, BodyName, PhysicsAsset->SkeletalBodySetups[BodyIndex]->BoneName, Infos, Capsule))
+		return false;
+	ApplyCapsule(PhysicsAsset, BodyIndex, Capsule);
 	return true;
 }
 
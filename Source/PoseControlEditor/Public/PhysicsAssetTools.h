@@ -7,17 +7,46 @@
 #include "PhysicsEngine/ConstraintInstance.h"
 #include "PhysicsAssetTools.generated.h"
  
+class UPcCharacterPipeline;
+
+DECLARE_DELEGATE_OneParam(FOnMorphedMeshBaked, bool /* bSuccess */);
+
 USTRUCT(BlueprintType)
 struct FMeshBakeOptions
 {
 	GENERATED_BODY()
 public:
-	bool bOverwritePhysicsAsset;
-	bool bOverwriteSkeletalMeshAsset;
-	bool bGeneratePhysicsBodies;
-	bool bCopyTwistBones;
-	bool bDeleteTwistBones;
-	bool bAlignCapsulesToBones;
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bOverwritePhysicsAsset = false;
+	
+	/** Rebakes the morphed SKM even if its inputs are unchanged */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bOverwriteSkeletalMeshAsset = false;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bBakeMorphedMesh = true;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bGeneratePhysicsBodies = true;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bCopyTwistBones = true;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bDeleteTwistBones = false;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bAlignCapsulesToBones = true;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bFixConstraintScale = true;
+	
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bAddConstraints = true;
+	
+	/** Runs every enabled stage, ignoring the recorded input hashes */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bForceRebuild = false;
 };
 
 UCLASS(MinimalAPI)
@@ -45,6 +74,8 @@ protected:
 	TObjectPtr<USkeletalMesh> NewSkeletalMesh; 
 
 	FTimerHandle TimerHandle;
+
+	FOnMorphedMeshBaked OnBakeCompleted;
 public:
 	
 	UPhysicsAssetTools();
@@ -53,6 +84,10 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Process Character", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool ProcessCharacterDA(UPcActorDataAsset* DataAsset, FMeshBakeOptions MeshBakeOptions);
 	
+	/** Runs every enabled step through the character pipeline, skipping the ones whose inputs are unchanged */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Process Character Pipeline", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static UPcCharacterPipeline* ProcessCharacterPipeline(UPcActorDataAsset* DataAsset, FMeshBakeOptions MeshBakeOptions);
+	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Copy Mesh With Morphs", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool CopyPhysicsAsset(UPcActorDataAsset* DataAsset, bool bForceCopy);
 
@@ -61,6 +96,9 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Create Physics Asset and Morphed SKM", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool CreatePhysicsAssetAndMorphedSkm(UPcActorDataAsset* DataAsset);
 	
+	/** Starts the morphed SKM bake; OnCompleted runs after the delayed copy. Returns the helper, keep it referenced until then. */
+	static UPhysicsAssetTools* StartBakeMorphedMesh(UPcActorDataAsset* DataAsset, FOnMorphedMeshBaked OnCompleted);
+	
 	bool CreatePhysicsAssetInternal();
 
 	UFUNCTION()
@@ -71,6 +109,14 @@ public:
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Create Bodies From Data Table", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool CreateBodiesFromDataTable(UPcActorDataAsset* DataAsset);
+
+	/**
+	 * CreateBodiesFromDataTable without blocking the editor on the fitting: bone vertices are gathered on the game thread,
+	 * box, sphere and capsule shapes are fitted on a worker thread, and the bodies are created and given their shapes on the
+	 * game thread when that's done. Hulls still fit on the game thread. Returns false if the operation couldn't start.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Create Bodies From Data Table In Background", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool CreateBodiesFromDataTableInBackground(UPcActorDataAsset* DataAsset);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Copy Twist Shape To Parent", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool CopyTwistShapeToParent(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, FName BodyName, bool bDeleteChildBody);
@@ -81,11 +127,20 @@ public:
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Align Capsules to Bones", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool AlignCapsulesToBones(UPcActorDataAsset* DataAsset);
+
+	/**
+	 * AlignCapsulesToBones with the capsule fitting on a worker thread. Bone vertices are gathered on the game thread
+	 * before it starts. Returns false if it couldn't start.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Align Capsules to Bones In Background", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool AlignCapsulesToBonesInBackground(UPcActorDataAsset* DataAsset);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Align Capsule to Bone", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool AlignCapsuleToBone(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, FName BodyName);
 	
-	static bool AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, FName BodyName, TArray<FBoneVertInfo> Infos);
+	/** RefPose is the bone space pose Infos are relative to, the mesh's reference pose if empty */
+	static bool AlignCapsule(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, FName BodyName, const TArray<FBoneVertInfo>& Infos,
+	                         TConstArrayView<FTransform> RefPose = TConstArrayView<FTransform>());
 
 };
 
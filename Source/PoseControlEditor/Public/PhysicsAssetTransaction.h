@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class FScopedTransaction;
+class UPhysicsAsset;
+
+/**
+ * Opens one undo transaction for the outermost bulk operation; nested scopes join it.
+ * The Modify* helpers record each object at most once per transaction, so undo only stores
+ * before/after snapshots of the body setups and constraint templates an operation touched.
+ * Without an open scope they just call Modify().
+ */
+class FScopedPhysicsAssetTransaction : public FNoncopyable
+{
+public:
+	explicit FScopedPhysicsAssetTransaction(const FText& Description);
+	~FScopedPhysicsAssetTransaction();
+
+	/** Records the asset itself (setup arrays, index map, collision table). Call before adding or removing entries. */
+	static void ModifyAsset(UPhysicsAsset* PhysicsAsset);
+	static void ModifyBody(UPhysicsAsset* PhysicsAsset, int32 BodyIndex);
+	static void ModifyConstraint(UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex);
+	static void ModifyObject(UObject* Object);
+
+	static bool IsOpen() { return Depth > 0; }
+
+private:
+	TUniquePtr<FScopedTransaction> Transaction;
+
+	static int32 Depth;
+	static TSet<const UObject*> ModifiedObjects;
+};
@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FPhysicsAssetValidation.h"
+
+class UPhysicsAsset;
+class USkeletalMesh;
+
+/**
+ * Consistency checks over a whole physics asset. Validate reads the asset in one parallel pass over the bodies and one
+ * over the constraints, then sweeps the bodies' reference pose bounds along X for overlaps. It never modifies the asset.
+ * ApplyFixes makes the fixes enabled in the options for the issues of a report in one transaction, ordered so the
+ * indexes recorded in the report stay valid: in-place fixes first, then removals from the back, then the index map.
+ */
+namespace PhysicsAssetValidation
+{
+	/** SkeletalMesh poses the overlap check, the asset's preview mesh if null */
+	bool Validate(const UPhysicsAsset* PhysicsAsset, const USkeletalMesh* SkeletalMesh, const FPhysicsAssetValidationOptions& Options,
+	              FPhysicsAssetValidationReport& OutReport);
+
+	/** Report must come from Validate on the unchanged asset. Marks the fixed issues and returns their count. */
+	int32 ApplyFixes(UPhysicsAsset* PhysicsAsset, const FPhysicsAssetValidationOptions& Options, FPhysicsAssetValidationReport& Report);
+}
@@ -9,6 +9,9 @@
 #include "PhysicsEngine/ConstraintInstance.h"
 #include "PcCommon/Public/DataAssets/PcActorDataAsset.h"
 #include "PcCommon/Public/Structs/FConstraintParams.h"
+#include "PcCommon/Public/Structs/FPhysicsAssetCostReport.h"
+#include "PcCommon/Public/Structs/FPhysicsAssetValidation.h"
+#include "PcCommon/Public/Structs/FPhysicsSoakBenchmark.h"
 #include "PhysicsEditorBPLibrary.generated.h"
 
 USTRUCT(BlueprintType)
@@ -28,6 +31,8 @@ public:
 	UE::AssetUtils::FSkeletalMeshAssetOptions Options;
 };
 
+DECLARE_DYNAMIC_DELEGATE(FPcSaveScopeBody);
+
 
 
 /**
@@ -43,78 +48,212 @@ public:
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Fix Constraint Scale", Keywords = "PhysicsAsset"), Category = "PhysicsAssetLibrary")
 	static bool FixConstraintScale(UPhysicsAsset* PhysicsAsset);
+
+	/** Checks the asset for broken or inconsistent data without modifying it, see PhysicsAssetValidation. SkeletalMesh may be null. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Validate Physics Asset", Keywords = "PhysicsAsset"), Category = "PhysicsAssetLibrary")
+	static bool ValidatePhysicsAsset(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhysicsAssetValidationOptions& Options,
+	                                 FPhysicsAssetValidationReport& OutReport);
+
+	/** Validates, then makes the fixes enabled in Options in one undo transaction. OutReport marks what was fixed. */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Fix Physics Asset", Keywords = "PhysicsAsset"), Category = "PhysicsAssetLibrary")
+	static bool FixPhysicsAsset(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhysicsAssetValidationOptions& Options,
+	                            FPhysicsAssetValidationReport& OutReport);
+
+	/**
+	 * Shape, constraint and memory estimate per body, per group and for the whole asset.
+	 * Bodies matching one of GroupPatterns are grouped under that pattern, the rest by their name with the numbers stripped.
+	 * Writes the report as CSV too if CsvFilePath is set.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Get Physics Asset Cost Report", Keywords = "PhysicsAsset"), Category = "PhysicsAssetLibrary")
+	static bool GetPhysicsAssetCostReport(UPhysicsAsset* PhysicsAsset, const TArray<FString>& GroupPatterns, const FString& CsvFilePath,
+	                                      FPhysicsAssetCostReport& OutReport);
+
+	/** Steps the data asset's target mesh and physics asset headless and scores tissue cost and stability, see PhysicsSoakBenchmark */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Run Physics Soak Benchmark", Keywords = "PhysicsAsset"), Category = "PhysicsAssetLibrary")
+	static bool RunPhysicsSoakBenchmark(UPcActorDataAsset* DataAsset, const FPhysicsSoakOptions& Options, FPhysicsSoakResult& OutResult);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Set Ref Pose Override", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool SetRefPoseOverride(USkeletalMeshComponent* SkeletalMeshComponent, TArray<FTransform> NewRefPoseTransforms);
+	static bool SetRefPoseOverride(USkeletalMeshComponent* SkeletalMeshComponent, const TArray<FTransform>& NewRefPoseTransforms);
 
 
 	static bool AlignConstraint(USkeletalMeshComponent* SkelMesh, int32 ConstraintIndex, float PositionBlend = 0.f, float OrientationBlend = 0.f);
+	/** Same as above, reading bones from SkeletalMesh's reference pose instead of a live component */
+	static bool AlignConstraint(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, int32 ConstraintIndex, float PositionBlend = 0.f, float OrientationBlend = 0.f);
 
 	static USkeletalMeshComponent* GetSkelMeshComponent(FPersonaAssetEditorToolkit* PhysicsAssetEditor);
 
 	 
+	/** Snapshots the pose once, computes the new ref frames in parallel and applies them in one pass */
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Adjust Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool AdjustConstraints(USkeletalMeshComponent* SkelMeshComp, FAdjustConstraintsOptions Options, TArray<FName> JointNames);
+	static bool AdjustConstraints(USkeletalMeshComponent* SkelMeshComp, const FAdjustConstraintsOptions& Options, const TArray<FName>& JointNames);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Adjust Constraints From Ref Pose", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool AdjustConstraintsFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FAdjustConstraintsOptions& Options, const TArray<FName>& JointNames);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Adjust Breast Point Body", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool AdjustPointBody(USkeletalMeshComponent* SkelMeshComp, FAdjustBodiesOptions Options, FName BodyName);
+	static bool AdjustPointBody(USkeletalMeshComponent* SkelMeshComp, const FAdjustBodiesOptions& Options, FName BodyName);
 
+	/**
+	 * Batch version of AdjustPointBody: snapshots the pose once, computes sphere centers and radii in parallel, applies them in one pass.
+	 * With FitMode SkinSurface the spheres are fitted under the skin instead, queried against one FSkinSurface built for the call.
+	 */
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Adjust Bodies", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool AdjustBodies(USkeletalMeshComponent* SkelMeshComp, FAdjustBodiesOptions Options, TArray<FName> BodyNames);
+	static bool AdjustBodies(USkeletalMeshComponent* SkelMeshComp, const FAdjustBodiesOptions& Options, const TArray<FName>& BodyNames);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Adjust Bodies From Ref Pose", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool AdjustBodiesFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FAdjustBodiesOptions& Options, const TArray<FName>& BodyNames);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Focus Or Open Physics Asset Editor", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static USkeletalMeshComponent* FocusOrOpenPhysAssetEditor(UPhysicsAsset* PhysicsAsset);
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Apply All Constraint Options", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool ApplyConstraintParams(UPhysicsAsset* PhysicsAsset, FConstraintParams Params);
+	static bool ApplyConstraintParams(UPhysicsAsset* PhysicsAsset, const FConstraintParams& Params);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Apply All Constraint Options", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool ApplyAllConstraintOptions(UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions Options);
+	static bool ApplyAllConstraintOptions(UPhysicsAsset* PhysicsAsset, const FPhatConstraintOptions& Options);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "GetConstraintParams", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool GetConstraintParams(UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex, FConstraintParams& OutParams);
+
+	/** GetConstraintParams with the child body mass already known, so callers reading many constraints can cache masses */
+	static void ReadConstraintParams(const FConstraintInstance& Instance, float ChildMass, FConstraintParams& OutParams);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Get All Constraint Params", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool GetAllConstraintParams(UPhysicsAsset* PhysicsAsset, TArray<FConstraintParams>& OutParams,
-	                                   TArray<FName> ConstraintNames);
+	                                   const TArray<FName>& ConstraintNames);
 
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "ScaleConstraintsByMass", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool ScaleConstraintsByMass(UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions& PhatConstraintOptions, TArray<FName> ConstraintNames, float
+	static bool ScaleConstraintsByMass(UPhysicsAsset* PhysicsAsset, FPhatConstraintOptions& PhatConstraintOptions, const TArray<FName>& ConstraintNames, float
 	                                   ScaleFactor);
 
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Mirror Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static bool MirrorConstraintOptions(UPhysicsAsset* PhysicsAsset, TArray<FName> ConstraintNames,
-                                                      FPhatConstraintOptions Options = FPhatConstraintOptions(),
+	static bool MirrorConstraintOptions(UPhysicsAsset* PhysicsAsset, const TArray<FName>& ConstraintNames,
+                                                      const FPhatConstraintOptions& Options = FPhatConstraintOptions(),
                                                       bool bRightToLeft = false);
 	
+	/**
+	 * Pushes constraints of one master asset to many variants in a single transaction and a single save. The source is read once,
+	 * the targets are matched in parallel and written on the game thread. See ConstraintRetarget.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Retarget Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool RetargetConstraints(UPhysicsAsset* SourcePhysicsAsset, const TArray<UPhysicsAsset*>& TargetPhysicsAssets,
+	                                const FConstraintRetargetOptions& Options, FConstraintRetargetReport& OutReport);
+	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Copy Constraint Options", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
 	static bool CopyConstraintOptions(UPhysicsAsset* PhysicsAsset, UPhysicsAsset* SourcePhysicsAsset,
-	                                     FPhatConstraintOptions Options);
+	                                     const FPhatConstraintOptions& Options);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Closest Point Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static TArray<int32> AddPointToParentConstraints(USkeletalMeshComponent* SkeletalMeshComponent, FAddPointConstraints Options, TArray<FName> ChildBodies);
+	static TArray<int32> AddPointToParentConstraints(USkeletalMeshComponent* SkeletalMeshComponent, const FAddPointConstraints& Options, const TArray<FName>& ChildBodies);
 		
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Closest Point Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static TArray<int32> AddClosestPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent, FConstraintParams DefaultParams, TArray<FName> TargetBodies, TArray<
-	                                                FName>
-	                                                SourceBodies, int32 NumClosestPoints, bool bExtraBones, TArray<int32> ClosestBones);
+	static TArray<int32> AddClosestPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent, const FConstraintParams& DefaultParams,
+	                                                const TArray<FName>& TargetBodies, const TArray<FName>& SourceBodies,
+	                                                int32 NumClosestPoints, bool bExtraBones, const TArray<int32>& ClosestBones,
+	                                                FConstraintGraphReport& OutGraphReport);
 	
+	/** Deduplicates, prunes and budgets the existing constraints matching JointPatternString as one graph */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Prune Constraint Graph", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool PruneConstraintGraph(USkeletalMeshComponent* SkeletalMeshComponent, const FString& JointPatternString,
+	                                 const FConstraintGraphOptions& Options, FConstraintGraphReport& OutReport);
+
+	/** OutGraphReport totals what filtering the point to point edges saved, see ConstraintGraph::FilterEdges */
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Point Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static TArray<int32> AddPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent, FAddPointConstraints Options);
+	static TArray<int32> AddPointConstraints(USkeletalMeshComponent* SkeletalMeshComponent, const FAddPointConstraints& Options,
+	                                         FConstraintGraphReport& OutGraphReport);
+
+	/** Headless AddPointConstraints: bone transforms come from SkeletalMesh's reference pose, no component or editor needed */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Point Constraints From Ref Pose", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static TArray<int32> AddPointConstraintsFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FAddPointConstraints& Options,
+	                                                    FConstraintGraphReport& OutGraphReport);
 	
+	/** OutGraphReport totals what filtering the point to point edges of every group saved */
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Phat Constraints", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static TArray<int32> AddPhatConstraints(USkeletalMeshComponent* SkeletalMeshComponent, FPhatConstraintOptions Options);
+	static TArray<int32> AddPhatConstraints(USkeletalMeshComponent* SkeletalMeshComponent, const FPhatConstraintOptions& Options,
+	                                        FConstraintGraphReport& OutGraphReport);
+
+	/** Headless AddPhatConstraints: the reference pose is computed once and shared by every group */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Phat Constraints From Ref Pose", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static TArray<int32> AddPhatConstraintsFromRefPose(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& Options,
+	                                                   FConstraintGraphReport& OutGraphReport);
+
+	/** AddPhatConstraintsFromRefPose on the data asset's target physics asset, posed by its cached morph variant instead of a baked mesh */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Phat Constraints From Morph Variant", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static TArray<int32> AddPhatConstraintsFromMorphVariant(UPcActorDataAsset* DataAsset, FConstraintGraphReport& OutGraphReport);
+
+	/**
+	 * AddPhatConstraintsFromRefPose without blocking the editor: the edges of every group are planned on a worker thread,
+	 * the constraints are created on the game thread when that's done. Returns false if the operation couldn't start.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Add Phat Constraints In Background", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool AddPhatConstraintsInBackground(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& Options);
 	
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Make New Constraint", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static int32 MakeNewConstraint(UPhysicsAsset* PhysicsAsset, FConstraintParams Params);
-	
+	static int32 MakeNewConstraint(UPhysicsAsset* PhysicsAsset, const FConstraintParams& Params);
+
+	/**
+	 * Writes one named constraint profile per preset into the given constraints (all constraints if empty),
+	 * scaled from each constraint's default profile. Profile names are registered on the asset.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Write Constraint Profiles", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool WriteConstraintProfiles(UPhysicsAsset* PhysicsAsset, const TArray<FConstraintProfilePreset>& Presets,
+	                                    const TArray<int32>& ConstraintIndexes);
+
+	/** Default scaled by Preset: drive stiffness by the strength scales, damping by strength * damping scale */
+	static FConstraintProfileProperties MakeProfileProperties(const FConstraintProfileProperties& Default, const FConstraintProfilePreset& Preset);
+
+	/**
+	 * Searches per-group drive scales and solver iterations with short soak runs of the data asset's target mesh,
+	 * then writes the winners into the data asset's PhatConstraintOptions and the physics asset. See DriveTuner.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Tune Constraint Drives", Keywords = "PhysicsAsset"), Category = "PhysicsAssetLibrary")
+	static bool TuneConstraintDrives(UPcActorDataAsset* DataAsset, const FDriveTuningOptions& Options, FDriveTuningReport& OutReport);
+
+	/**
+	 * Walks the bodies parents first and lightens any child heavier than its parent / the target ratio, then rescales
+	 * the drives of the affected constraints by the mass change. Inversions between skeleton bodies are only reported
+	 * unless Options.bFixSkeletonInversions is set. See MassHierarchy.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Rebalance Mass Hierarchy", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool RebalanceMassHierarchy(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& PhatOptions,
+	                                   const FMassRebalanceOptions& Options, FMassRebalanceReport& OutReport);
+
+	/**
+	 * Creates or regenerates a reduced copy of the physics asset next to it: Lod1 merges points into spokes, Lod2 points and
+	 * spokes into cores, twist and finger bodies are dropped. Tissue levels come from the point patterns of PhatOptions.
+	 * Returns the LOD asset. See PhysicsLod.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Generate Physics LOD", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static UPhysicsAsset* GeneratePhysicsLod(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& PhatOptions,
+	                                         const FPhysicsLodOptions& Options, FPhysicsLodReport& OutReport);
+
+	/**
+	 * Renumbers bodies and constraints in reverse Cuthill-McKee order over the constraint graph, with each tissue group
+	 * kept together next to the skeleton body it hangs from, so the solver walks connected bodies in memory order. See SolverOrdering.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Reorder Bodies For Solver", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static bool ReorderBodiesForSolver(UPhysicsAsset* PhysicsAsset, const FPhatConstraintOptions& PhatOptions, const FSolverOrderingOptions& Options,
+	                                   FSolverOrderingReport& OutReport);
+
 	
-	static bool RegexMatch(FRegexPattern Pattern, FString Str);
+	/**
+	 * Puts the bodies on an object channel that ignores itself, in one pass. Pairwise CollisionDisableTable
+	 * entries between bodies of the group are removed, and MakeNewConstraint no longer adds them.
+	 * ECC_MAX means no channel was picked and changes nothing.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Set Tissue Collision Group", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
+	static int32 SetTissueCollisionGroup(UPhysicsAsset* PhysicsAsset, const TArray<FName>& BodyNames,
+	                                     TEnumAsByte<ECollisionChannel> Channel, bool bRemovePairwiseEntries = true);
+
+	/** True if both bodies are on the same object channel and that channel ignores itself */
+	static bool BodiesIgnoreEachOther(const UPhysicsAsset* PhysicsAsset, int32 BodyIndex1, int32 BodyIndex2);
+
+	static bool RegexMatch(const FRegexPattern& Pattern, const FString& Str);
 	
 	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Filter Names", Keywords = "PhysicsAsset"), Category = "PoseControlEditor")
-	static TArray<FName> FilterNames(TArray<FName> Names, FString PatternString);
+	static TArray<FName> FilterNames(const TArray<FName>& Names, const FString& PatternString);
 	
 public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
@@ -145,9 +284,17 @@ public:
 	¦* Editor Only Will not work in packaged build.
 	*
 	* Saves an asset. Doesn't matter if the asset is modified or not.
+	* Inside a save scope the save is deferred until the scope closes.
 	*/
 	UFUNCTION(BlueprintCallable, Category = "Asset Helpers")
-	static void SaveAsset (FString AssetPath, bool& bOutSuccess, FString& OutInfoMessage);
+	static void SaveAsset (const FString& AssetPath, bool& bOutSuccess, FString& OutInfoMessage);
+
+	/**
+	 * Runs Body with package saves deferred, then writes each package it touched once. Calls nest.
+	 * The scope closes when Body returns, even if it stopped on a Blueprint error.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Asset Helpers")
+	static bool RunThenSave(const FPcSaveScopeBody& Body);
 	// /**
 	// * Editor Only - Will not work in packaged build.
 	// *
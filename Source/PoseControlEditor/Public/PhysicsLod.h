@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FConstraintParams.h"
+
+class UPhysicsAsset;
+class USkeletalMesh;
+
+/**
+ * Reduced physics assets for distant characters. A LOD is a copy of the full asset, next to it and named
+ * <Source><AssetSuffix><Level>, regenerated in place on later runs so meshes referencing it stay valid.
+ * Tissue bodies above the level's depth (see ETissueLevel) merge into their closest kept ancestor, dropped bodies are removed.
+ * Constraints are collapsed onto the kept bodies:
+ * - inside one merged cluster they're removed,
+ * - several between the same two kept bodies become one whose drives are the sum of theirs (springs in parallel),
+ * - a constraint kept as is has its drives scaled by its child's summed mass / original mass.
+ * So drive strength follows the mass that was summed into each body, and the cluster keeps its natural frequency.
+ */
+namespace PhysicsLod
+{
+	UPhysicsAsset* Generate(UPhysicsAsset* SourcePhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& PhatOptions,
+	                        const FPhysicsLodOptions& Options, FPhysicsLodReport& OutReport);
+
+	/** The reduction on its own, in place */
+	bool Reduce(UPhysicsAsset* PhysicsAsset, USkeletalMesh* SkeletalMesh, const FPhatConstraintOptions& PhatOptions,
+	            const FPhysicsLodOptions& Options, FPhysicsLodReport& OutReport);
+}
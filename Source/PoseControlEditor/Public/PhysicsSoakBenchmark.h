@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FPhysicsSoakBenchmark.h"
+
+class UPcActorDataAsset;
+class UPhysicsAsset;
+class USkeletalMesh;
+
+/**
+ * Steps a skeletal mesh with its physics asset in a transient world without rendering, so generated tissue can be
+ * checked for cost and stability without opening the PhAt editor. The physics scene is stepped directly, one
+ * fixed step per frame, so runs with the same options are repeatable.
+ */
+namespace PhysicsSoakBenchmark
+{
+	bool Run(USkeletalMesh* SkeletalMesh, UPhysicsAsset* PhysicsAsset, const FPhysicsSoakOptions& Options, FPhysicsSoakResult& OutResult);
+
+	/**
+	 * The data asset's target mesh to soak against. Null with an error in RefPoseCache mode: the morphed pose only lives
+	 * in the cache, and the source mesh would simulate the bodies off their bones.
+	 */
+	USkeletalMesh* GetSoakMesh(const UPcActorDataAsset* DataAsset);
+
+	/** One row per group and one for the whole asset, prefixed with Timestamp so runs can be appended to one file */
+	FString ToCsv(const FPhysicsSoakResult& Result, const FString& Timestamp, bool bWithHeader);
+}
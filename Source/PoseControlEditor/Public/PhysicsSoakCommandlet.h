@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PhysicsSoakCommandlet.generated.h"
+
+/**
+ * Headless soak benchmark for build machines, see PhysicsSoakBenchmark.
+ *
+ * UnrealEditor-Cmd <Project> -run=PhysicsSoak -DataAsset=/Game/Characters/DA_Char [-Anim=/Game/Anims/Run] [-Frames=600] [-Csv=Saved/Soak.csv]
+ * or -Mesh=<SkeletalMesh> -PhysicsAsset=<PhysicsAsset> instead of -DataAsset. Several assets can be given comma separated;
+ * meshes pair with physics assets by position, or one mesh is used for all of them.
+ * Data assets in RefPoseCache mode are rejected, see PhysicsSoakBenchmark::GetSoakMesh.
+ * Results are appended to the CSV. Returns 1 if any asset failed to run or went unstable.
+ */
+UCLASS()
+class UPhysicsSoakCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPhysicsSoakCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "PcCharacterPipeline.h"
+#include "Structs/FPhysicsAssetCostReport.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+
+class UPcActorDataAsset;
+
+/**
+ * Contents of the PoseControl tab for one character data asset: the last pipeline run per stage (time, skip, resulting
+ * body and constraint counts) next to the session's stage cache hit rates, and the cost report of the target physics
+ * asset grouped by the point group patterns. Each stage can be rerun on its own from here.
+ * Refreshes when any pipeline finishes.
+ */
+class SPoseControlDashboard : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SPoseControlDashboard) {}
+	SLATE_END_ARGS()
+
+	virtual ~SPoseControlDashboard() override;
+
+	void Construct(const FArguments& InArgs);
+
+	struct FStageRow
+	{
+		EPcPipelineStage Stage = EPcPipelineStage::CopyPhysicsAsset;
+		/** Unset if the stage didn't take part in the last run */
+		TOptional<FPcPipelineStageResult> Result;
+		FPcPipelineStageStats Stats;
+	};
+	using FStageRowPtr = TSharedPtr<FStageRow>;
+	using FGroupRowPtr = TSharedPtr<FPhysicsGroupCost>;
+
+private:
+	void Refresh();
+	void OnPipelineFinished(UPcActorDataAsset* InDataAsset, bool bSuccess);
+	void OnDataAssetChanged(const FAssetData& AssetData);
+
+	bool CanRun() const;
+	FReply RunPipeline();
+	FReply RunStage(EPcPipelineStage Stage);
+
+	TSharedRef<ITableRow> MakeStageRow(FStageRowPtr Row, const TSharedRef<STableViewBase>& OwnerTable);
+	TSharedRef<ITableRow> MakeGroupRow(FGroupRowPtr Row, const TSharedRef<STableViewBase>& OwnerTable);
+	FText GetSummaryText() const;
+
+	/** Remembered across tab respawns */
+	static TWeakObjectPtr<UPcActorDataAsset> LastDataAsset;
+
+	TWeakObjectPtr<UPcActorDataAsset> DataAsset;
+	TWeakObjectPtr<UPcCharacterPipeline> ActivePipeline;
+	FMeshBakeOptions BakeOptions;
+
+	TArray<FStageRowPtr> StageRows;
+	TArray<FGroupRowPtr> GroupRows;
+	FPhysicsAssetCostReport CostReport;
+	bool bHasCostReport = false;
+
+	TSharedPtr<SListView<FStageRowPtr>> StageList;
+	TSharedPtr<SListView<FGroupRowPtr>> GroupList;
+	FDelegateHandle PipelineFinishedHandle;
+};
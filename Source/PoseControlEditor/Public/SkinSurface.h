@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicMesh/DynamicMesh3.h"
+#include "DynamicMesh/DynamicMeshAABBTree3.h"
+
+class FSkeletalMeshLODModel;
+class USkeletalMesh;
+class USkeletalMeshComponent;
+
+/**
+ * Skin triangles of a character in one pose with an AABB tree over them, so nearest surface queries are logarithmic.
+ * Built once per operation on the game thread; queries are const and run from any thread.
+ */
+class FSkinSurface : public FNoncopyable
+{
+public:
+	/** Skinned and morphed, in world space like FBonePose::FromComponent */
+	static TSharedPtr<const FSkinSurface> FromComponent(const USkeletalMeshComponent* SkeletalMeshComponent);
+	/** LOD0 of the imported model in the reference pose, like FBonePose::FromRefPose */
+	static TSharedPtr<const FSkinSurface> FromRefPose(const USkeletalMesh* SkeletalMesh);
+	/** LOD0 triangles over the given positions, one per soft vertex of the imported model's sections in order */
+	static TSharedPtr<const FSkinSurface> FromVertices(const USkeletalMesh* SkeletalMesh, TConstArrayView<FVector3f> Positions);
+
+	/** Closest skin point and its triangle's normal, as wound by the mesh */
+	bool FindNearest(const FVector& Point, FVector& OutSurfacePoint, FVector& OutNormal) const;
+
+	int32 NumTriangles() const { return Mesh.TriangleCount(); }
+
+private:
+	void AppendTriangles(const FSkeletalMeshLODModel& LODModel);
+	void BuildTree();
+
+	UE::Geometry::FDynamicMesh3 Mesh;
+	TUniquePtr<UE::Geometry::FDynamicMeshAABBTree3> Tree;
+};
@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Structs/FConstraintParams.h"
+
+class UPhysicsAsset;
+
+/**
+ * Renumbers bodies and constraints so constrained bodies sit close together in the arrays Chaos builds its particles
+ * and joints from. Bodies are put in Cuthill-McKee order over the constraint graph: the skeleton first, each component
+ * from a pseudo-peripheral body, then each tissue group is traversed from its core and inserted right after the skeleton
+ * body it hangs from. Constraints follow their bodies. The index map, bounds bodies and collision table are remapped.
+ */
+namespace SolverOrdering
+{
+	/** Tissue groups come from the point patterns of PhatOptions. Fails on null bodies, see PhysicsAssetValidation. */
+	bool Reorder(UPhysicsAsset* PhysicsAsset, const FPhatConstraintOptions& PhatOptions, const FSolverOrderingOptions& Options,
+	             FSolverOrderingReport& OutReport);
+}
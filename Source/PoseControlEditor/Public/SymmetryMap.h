@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UPhysicsAsset;
+struct FReferenceSkeleton;
+
+enum class ESymmetrySide : uint8
+{
+	Centre,
+	Left,
+	Right
+};
+
+/**
+ * Left/right pairing of the bodies and constraints of one physics asset, built once from the "l"/"r" name tokens.
+ * Constraints are paired through their mirrored body pair, so the constraint names don't have to match.
+ * Poses passed to the mirror functions are component space transforms indexed like the reference skeleton.
+ */
+struct FBilateralSymmetryMap
+{
+	/** Mirror body per body index. Centre bodies map to themselves, unpaired sided bodies to INDEX_NONE. */
+	TArray<int32> BodyMirror;
+	TArray<ESymmetrySide> BodySide;
+
+	/** Mirror constraint per constraint index, INDEX_NONE if the mirrored body pair isn't constrained */
+	TArray<int32> ConstraintMirror;
+	TArray<ESymmetrySide> ConstraintSide;
+	/** Body indexes of ConstraintBone1 and ConstraintBone2 */
+	TArray<TPair<int32, int32>> ConstraintBodies;
+	TMap<FName, int32> ConstraintIndexMap;
+
+	bool Build(const UPhysicsAsset* PhysicsAsset);
+
+	/** Writes the mirrored shapes and body properties of Bodies onto their counterparts. Returns the number of bodies written. */
+	int32 MirrorBodies(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton, const TArray<FTransform>& Pose,
+	                   const TArray<int32>& Bodies, EAxis::Type MirrorAxis) const;
+
+	/**
+	 * Copies the profile and mirrored ref frames of Constraints onto their counterparts, creating the missing ones.
+	 * Returns the mirror constraint indexes.
+	 */
+	TArray<int32> MirrorConstraints(UPhysicsAsset* PhysicsAsset, const FReferenceSkeleton& RefSkeleton, const TArray<FTransform>& Pose,
+	                                const TArray<int32>& Constraints, EAxis::Type MirrorAxis);
+
+	/** Copies the profile (limits and drives) of the constraint onto its existing counterpart */
+	bool CopyConstraintProfile(UPhysicsAsset* PhysicsAsset, int32 ConstraintIndex) const;
+
+	/** Swaps every standalone "l"/"r" token without heap strings, e.g. breast_pt_01_02_l_1003 -> breast_pt_01_02_r_1003 */
+	static FName MirrorName(FName InName);
+	/** MirrorName for plain strings such as regex patterns, where a token can also end in syntax, e.g. ^breast_l$ -> ^breast_r$ */
+	static FString MirrorString(const FString& InString);
+	static ESymmetrySide GetSide(FName InName);
+	/** Reflects a component space transform across the plane normal to MirrorAxis, keeping a proper rotation */
+	static FTransform MirrorTransform(const FTransform& InTransform, EAxis::Type MirrorAxis);
+};
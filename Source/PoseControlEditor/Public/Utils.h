@@ -3,6 +3,7 @@
 #include "CoreMinimal.h"
 #include "MeshUtilitiesCommon.h"
 #include "PhysicsEngine/ConstraintInstance.h"
+#include "PhysicsEngine/PhysicsConstraintTemplate.h"
 #include "Utils.generated.h"
 
 
@@ -19,6 +20,48 @@ inline FString MakeAssetPath(FString Directory, FString Filename, FString Prefix
 	return Directory + Prefix + Filename;
 }
 
+/**
+ * For properties only exposed to the PhAt editor, e.g. ProfileHandles and ConstraintProfiles, which have no public setter.
+ * Null if the object or the property is missing; a missing property means the engine renamed it, so it ensures.
+ */
+template<typename T>
+T* GetPropertyValuePtr(UObject* Object, const TCHAR* PropertyName)
+{
+	if(!Object)
+		return nullptr;
+	const FProperty* Property = FindFProperty<FProperty>(Object->GetClass(), PropertyName);
+	if(!ensureMsgf(Property, TEXT("%s not found on %s"), PropertyName, *Object->GetClass()->GetName()))
+		return nullptr;
+	return Property->ContainerPtrToValuePtr<T>(Object);
+}
+
+template<typename T>
+const T* GetPropertyValuePtr(const UObject* Object, const TCHAR* PropertyName)
+{
+	return GetPropertyValuePtr<T>(const_cast<UObject*>(Object), PropertyName);
+}
+
+/** The template's named profiles, empty (after an ensure) if the property is missing */
+inline TArrayView<FPhysicsConstraintProfileHandle> GetProfileHandles(UPhysicsConstraintTemplate* Template)
+{
+	TArray<FPhysicsConstraintProfileHandle>* Handles = GetPropertyValuePtr<TArray<FPhysicsConstraintProfileHandle>>(Template, TEXT("ProfileHandles"));
+	return Handles ? TArrayView<FPhysicsConstraintProfileHandle>(*Handles) : TArrayView<FPhysicsConstraintProfileHandle>();
+}
+
+inline TConstArrayView<FPhysicsConstraintProfileHandle> GetProfileHandles(const UPhysicsConstraintTemplate* Template)
+{
+	const TArray<FPhysicsConstraintProfileHandle>* Handles = GetPropertyValuePtr<TArray<FPhysicsConstraintProfileHandle>>(Template, TEXT("ProfileHandles"));
+	return Handles ? TConstArrayView<FPhysicsConstraintProfileHandle>(*Handles) : TConstArrayView<FPhysicsConstraintProfileHandle>();
+}
+
+/** Quotes a CSV field if it contains a comma or a quote */
+inline FString CsvField(const FString& Value)
+{
+	if(!Value.Contains(TEXT(",")) && !Value.Contains(TEXT("\"")))
+		return Value;
+	return TEXT("\"") + Value.Replace(TEXT("\""), TEXT("\"\"")) + TEXT("\"");
+}
+
 static FMatrix ComputeCovarianceMatrix(const FBoneVertInfo& VertInfo)
 {
 	if (VertInfo.Positions.Num() == 0)